@@ -288,7 +288,12 @@ function build(settings)
 	tools = {}
 	for i,v in ipairs(tools_src) do
 		toolname = PathFilename(PathBase(v))
-		tools[i] = Link(settings, toolname, Compile(settings, v), engine, zlib, pnglite)
+		if toolname == "loadgen" then
+			-- the load generator decodes snapshots with the generated netobjects
+			tools[i] = Link(settings, toolname, Compile(settings, v), game_shared, engine, zlib, pnglite)
+		else
+			tools[i] = Link(settings, toolname, Compile(settings, v), engine, zlib, pnglite)
+		end
 	end
 
 	-- build client, server, version server and master server
@@ -333,14 +338,14 @@ debug_settings.config_name = "debug"
 debug_settings.config_ext = "_d"
 debug_settings.debug = 1
 debug_settings.optimize = 0
-debug_settings.cc.defines:Add("CONF_DEBUG")
+debug_settings.cc.defines:Add("CONF_DEBUG", "CONF_MEM_DEBUG")
 
 debug_sql_settings = NewSettings()
 debug_sql_settings.config_name = "sql_debug"
 debug_sql_settings.config_ext = "_sql_d"
 debug_sql_settings.debug = 1
 debug_sql_settings.optimize = 0
-debug_sql_settings.cc.defines:Add("CONF_DEBUG", "CONF_SQL")
+debug_sql_settings.cc.defines:Add("CONF_DEBUG", "CONF_MEM_DEBUG", "CONF_SQL")
 
 release_settings = NewSettings()
 release_settings.config_name = "release"
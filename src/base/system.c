@@ -15,6 +15,7 @@
 
 	/* unix net includes */
 	#include <sys/stat.h>
+	#include <sys/mman.h>
 	#include <sys/types.h>
 	#include <sys/socket.h>
 	#include <sys/ioctl.h>
@@ -64,15 +65,50 @@ static MEMSTATS memory_stats = {0};
 
 static NETSOCKET invalid_socket = {NETTYPE_INVALID, -1, -1};
 
+/* threaded logging: bounded multi producer, single consumer queue */
+enum
+{
+	LOG_QUEUE_SIZE = 512, /* must be a power of two */
+	LOG_LINE_SIZE = 1024*4 /* same as a dbg_msg line, so nothing gets cut off */
+};
+
+typedef struct
+{
+	volatile int sequence;
+	time_t timestamp;
+	char line[LOG_LINE_SIZE];
+} LOGENTRY;
+
+static LOGENTRY log_queue[LOG_QUEUE_SIZE];
+static volatile int log_queue_head = 0; /* next entry to be claimed by a producer */
+static int log_queue_tail = 0; /* next entry to be read by the logger thread */
+static volatile int log_dropped = 0;
+static volatile int log_threaded = 0;
+static volatile int log_stop = 0;
+static volatile int log_producers = 0; /* threads that are about to push into the queue */
+static void *log_thread = 0;
+static SEMAPHORE log_signal;
+#if defined(CONF_FAMILY_UNIX)
+static pthread_t log_thread_id;
+#elif defined(CONF_FAMILY_WINDOWS)
+static DWORD log_thread_id = 0;
+#endif
+
+static void log_disable_threaded();
+
 void dbg_logger(DBG_LOGGER logger)
 {
-	loggers[num_loggers++] = logger;
+	loggers[num_loggers] = logger;
+	sync_barrier();
+	num_loggers++;
 }
 
 void dbg_assert_imp(const char *filename, int line, int test, const char *msg)
 {
 	if(!test)
 	{
+		/* get everything out before we crash */
+		log_disable_threaded();
 		dbg_msg("assert", "%s(%d): %s", filename, line, msg);
 		dbg_break();
 	}
@@ -83,12 +119,161 @@ void dbg_break()
 	*((unsigned*)0) = 0x0;
 }
 
+static int log_queue_push(time_t timestamp, const char *line)
+{
+	int pos = log_queue_head;
+	while(1)
+	{
+		LOGENTRY *entry = &log_queue[pos&(LOG_QUEUE_SIZE-1)];
+		int diff = entry->sequence - pos;
+		if(diff == 0)
+		{
+			int prev = atomic_compare_swap(&log_queue_head, pos, pos+1);
+			if(prev == pos)
+			{
+				entry->timestamp = timestamp;
+				str_copy(entry->line, line, sizeof(entry->line));
+				sync_barrier();
+				entry->sequence = pos+1;
+				semaphore_signal(&log_signal);
+				return 1;
+			}
+			pos = prev;
+		}
+		else if(diff < 0)
+		{
+			/* queue is full, the logger thread can't keep up */
+			atomic_inc(&log_dropped);
+			return 0;
+		}
+		else
+			pos = log_queue_head;
+	}
+}
+
+static void log_write(const char *timestr, const char *line)
+{
+	char str[LOG_LINE_SIZE+96];
+	int i;
+	str_format(str, sizeof(str), "[%s]%s", timestr, line);
+	for(i = 0; i < num_loggers; i++)
+		loggers[i](str);
+}
+
+static void log_queue_flush()
+{
+	/* only called from a single consumer, so the cache needs no locking */
+	static time_t cached_time = (time_t)-1;
+	static char cached_timestr[80];
+	int dropped;
+
+	while(1)
+	{
+		LOGENTRY *entry = &log_queue[log_queue_tail&(LOG_QUEUE_SIZE-1)];
+		if(entry->sequence != log_queue_tail+1)
+			break;
+		sync_barrier();
+
+		if(entry->timestamp != cached_time)
+		{
+			cached_time = entry->timestamp;
+			strftime(cached_timestr, sizeof(cached_timestr), "%y-%m-%d %H:%M:%S", localtime(&cached_time));
+		}
+		log_write(cached_timestr, entry->line);
+
+		sync_barrier();
+		entry->sequence = log_queue_tail+LOG_QUEUE_SIZE;
+		log_queue_tail++;
+	}
+
+	dropped = log_dropped;
+	if(dropped)
+	{
+		char buf[64];
+		atomic_add(&log_dropped, -dropped);
+		str_format(buf, sizeof(buf), "[dbg/logger]: dropped %d messages", dropped);
+		log_write(cached_timestr, buf);
+	}
+}
+
+static int log_on_logger_thread()
+{
+#if defined(CONF_FAMILY_UNIX)
+	return pthread_equal(pthread_self(), log_thread_id);
+#elif defined(CONF_FAMILY_WINDOWS)
+	return GetCurrentThreadId() == log_thread_id;
+#endif
+}
+
+static void log_thread_func(void *user)
+{
+#if defined(CONF_FAMILY_UNIX)
+	log_thread_id = pthread_self();
+#elif defined(CONF_FAMILY_WINDOWS)
+	log_thread_id = GetCurrentThreadId();
+#endif
+	while(!log_stop)
+	{
+		semaphore_wait(&log_signal);
+		log_queue_flush();
+	}
+	log_queue_flush();
+}
+
+static void log_disable_threaded()
+{
+	if(!log_threaded)
+		return;
+
+	/* new messages go directly to the loggers, the thread writes out the remaining ones */
+	log_threaded = 0;
+	sync_barrier();
+
+	/* an assert in the logger thread itself, it can't wait for its own exit */
+	if(log_on_logger_thread())
+		return;
+
+	/* let producers that saw the queue still enabled finish their push */
+	while(log_producers)
+		thread_yield();
+
+	log_stop = 1;
+	semaphore_signal(&log_signal);
+	thread_wait(log_thread);
+	semaphore_destroy(&log_signal);
+	log_thread = 0;
+}
+
+void dbg_enable_threaded()
+{
+	int i;
+	if(log_threaded)
+		return;
+
+	for(i = 0; i < LOG_QUEUE_SIZE; i++)
+		log_queue[i].sequence = i;
+	log_queue_head = 0;
+	log_queue_tail = 0;
+	log_stop = 0;
+	semaphore_init(&log_signal);
+	log_thread = thread_create(log_thread_func, 0);
+	if(!log_thread)
+	{
+		semaphore_destroy(&log_signal);
+		return;
+	}
+
+	sync_barrier();
+	log_threaded = 1;
+	atexit(log_disable_threaded);
+}
+
 void dbg_msg(const char *sys, const char *fmt, ...)
 {
 	va_list args;
-	char str[1024*4];
+	char str[LOG_LINE_SIZE];
 	char *msg;
-	int i, len;
+	int i, len, threaded;
 
 	//str_format(str, sizeof(str), "[%08x][%s]: ", (int)time(0), sys);
 	time_t rawtime;
@@ -96,10 +281,25 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 	char timestr [80];
 
 	time ( &rawtime );
-	timeinfo = localtime ( &rawtime );
 
-	strftime (timestr,sizeof(timestr),"%y-%m-%d %H:%M:%S",timeinfo);
-	str_format(str, sizeof(str), "[%s][%s]: ", timestr, sys);
+	/* announce the push before looking at the flag, so disabling waits for it */
+	atomic_inc(&log_producers);
+	threaded = log_threaded;
+	if(!threaded)
+		atomic_dec(&log_producers);
+
+	if(threaded)
+	{
+		/* the logger thread adds the timestamp */
+		str_format(str, sizeof(str), "[%s]: ", sys);
+	}
+	else
+	{
+		timeinfo = localtime ( &rawtime );
+
+		strftime (timestr,sizeof(timestr),"%y-%m-%d %H:%M:%S",timeinfo);
+		str_format(str, sizeof(str), "[%s][%s]: ", timestr, sys);
+	}
 
 	len = strlen(str);
 	msg = (char *)str + len;
@@ -112,6 +312,13 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 #endif
 	va_end(args);
 
+	if(threaded)
+	{
+		log_queue_push(rawtime, str);
+		atomic_dec(&log_producers);
+		return;
+	}
+
 	for(i = 0; i < num_loggers; i++)
 		loggers[i](str);
 }
@@ -152,6 +359,7 @@ void dbg_logger_file(const char *filename)
 }
 /* */
 
+#if defined(CONF_MEM_DEBUG)
 typedef struct MEMHEADER
 {
 	const char *filename;
@@ -169,6 +377,22 @@ typedef struct MEMTAIL
 static struct MEMHEADER *first = 0;
 static const int MEM_GUARD_VAL = 0xbaadc0de;
 
+/* the list and the stats are shared by all threads that allocate, a
+   spinlock because a LOCK can't be created safely from in here */
+static volatile int mem_debug_lock = 0;
+
+static void mem_debug_lock_wait()
+{
+	while(atomic_compare_swap(&mem_debug_lock, 0, 1) != 0)
+		thread_yield();
+}
+
+static void mem_debug_lock_release()
+{
+	sync_barrier();
+	mem_debug_lock = 0;
+}
+
 void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment)
 {
 	/* TODO: fix alignment */
@@ -180,18 +404,19 @@ void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned al
 	header->size = size;
 	header->filename = filename;
 	header->line = line;
+	tail->guard = MEM_GUARD_VAL;
 
+	mem_debug_lock_wait();
 	memory_stats.allocated += header->size;
 	memory_stats.total_allocations++;
 	memory_stats.active_allocations++;
 
-	tail->guard = MEM_GUARD_VAL;
-
 	header->prev = (MEMHEADER *)0;
 	header->next = first;
 	if(first)
 		first->prev = header;
 	first = header;
+	mem_debug_lock_release();
 
 	/*dbg_msg("mem", "++ %p", header+1); */
 	return header+1;
@@ -207,6 +432,7 @@ void mem_free(void *p)
 		if(tail->guard != MEM_GUARD_VAL)
 			dbg_msg("mem", "!! %p", p);
 		/* dbg_msg("mem", "-- %p", p); */
+		mem_debug_lock_wait();
 		memory_stats.allocated -= header->size;
 		memory_stats.active_allocations--;
 
@@ -216,6 +442,7 @@ void mem_free(void *p)
 			first = header->next;
 		if(header->next)
 			header->next->prev = header->prev;
+		mem_debug_lock_release();
 
 		free(header);
 	}
@@ -224,56 +451,298 @@ void mem_free(void *p)
 void mem_debug_dump(IOHANDLE file)
 {
 	char buf[1024];
-	MEMHEADER *header = first;
+	MEMHEADER *header;
 	if(!file)
 		file = io_open("memory.txt", IOFLAG_WRITE);
 
 	if(file)
 	{
-		while(header)
+		mem_debug_lock_wait();
+		for(header = first; header; header = header->next)
 		{
 			str_format(buf, sizeof(buf), "%s(%d): %d", header->filename, header->line, header->size);
 			io_write(file, buf, strlen(buf));
 			io_write_newline(file);
-			header = header->next;
 		}
+		mem_debug_lock_release();
 
 		io_close(file);
 	}
 }
 
+int mem_check_imp()
+{
+	MEMHEADER *header;
+	mem_debug_lock_wait();
+	for(header = first; header; header = header->next)
+	{
+		MEMTAIL *tail = (MEMTAIL *)(((char*)(header+1))+header->size);
+		if(tail->guard != MEM_GUARD_VAL)
+		{
+			mem_debug_lock_release();
+			dbg_msg("mem", "Memory check failed at %s(%d): %d", header->filename, header->line, header->size);
+			return 0;
+		}
+	}
+	mem_debug_lock_release();
+
+	return 1;
+}
+#else
+/* release allocator: size class pools with per thread caches */
+enum
+{
+	MEM_NUM_CLASSES = 9, /* 16 bytes to 4k */
+	MEM_MIN_CLASS_SHIFT = 4,
+	MEM_CHUNK_SIZE = 64*1024,
+	MEM_CACHE_BATCH = 32, /* blocks moved between a thread cache and the pool at once */
+	MEM_CACHE_MAX = 2*MEM_CACHE_BATCH
+};
+
+/* 16 bytes to keep the payload aligned like malloc does */
+typedef union MEMHEADER
+{
+	struct
+	{
+		int size_class; /* -1 for blocks that bypass the pools */
+		unsigned size;
+	} info;
+	union MEMHEADER *next_free;
+	double align[2];
+} MEMHEADER;
+
+typedef struct
+{
+	MEMHEADER *free_list[MEM_NUM_CLASSES];
+	int num_free[MEM_NUM_CLASSES];
+} MEMCACHE;
 
-void mem_copy(void *dest, const void *source, unsigned size)
+static MEMHEADER *mem_pool[MEM_NUM_CLASSES];
+static volatile int mem_pool_lock = 0;
+static volatile int mem_cache_key_state = 0;
+
+#if defined(CONF_FAMILY_UNIX)
+static pthread_key_t mem_cache_key;
+#elif defined(CONF_FAMILY_WINDOWS)
+static DWORD mem_cache_key;
+#endif
+
+static void mem_pool_acquire()
 {
-	memcpy(dest, source, size);
+	while(atomic_compare_swap(&mem_pool_lock, 0, 1) != 0)
+		thread_yield();
 }
 
-void mem_move(void *dest, const void *source, unsigned size)
+static void mem_pool_release()
 {
-	memmove(dest, source, size);
+	sync_barrier();
+	mem_pool_lock = 0;
 }
 
-void mem_zero(void *block,unsigned size)
+static unsigned mem_class_block_size(int size_class)
 {
-	memset(block, 0, size);
+	return sizeof(MEMHEADER) + (1<<(size_class+MEM_MIN_CLASS_SHIFT));
 }
 
-int mem_check_imp()
+/* moves up to num blocks of a class from the thread cache to the shared pool */
+static void mem_cache_return(MEMCACHE *cache, int size_class, int num)
 {
-	MEMHEADER *header = first;
-	while(header)
+	MEMHEADER *first = cache->free_list[size_class];
+	MEMHEADER *last = first;
+	int i;
+
+	if(!first)
+		return;
+	for(i = 1; i < num && last->next_free; i++)
+		last = last->next_free;
+
+	cache->free_list[size_class] = last->next_free;
+	cache->num_free[size_class] -= i;
+
+	mem_pool_acquire();
+	last->next_free = mem_pool[size_class];
+	mem_pool[size_class] = first;
+	mem_pool_release();
+}
+
+/* fills the thread cache from the shared pool, carving a new chunk when it runs dry */
+static void mem_cache_refill(MEMCACHE *cache, int size_class)
+{
+	MEMHEADER *block;
+	int i;
+
+	mem_pool_acquire();
+	for(i = 0; i < MEM_CACHE_BATCH && mem_pool[size_class]; i++)
 	{
-		MEMTAIL *tail = (MEMTAIL *)(((char*)(header+1))+header->size);
-		if(tail->guard != MEM_GUARD_VAL)
+		block = mem_pool[size_class];
+		mem_pool[size_class] = block->next_free;
+		block->next_free = cache->free_list[size_class];
+		cache->free_list[size_class] = block;
+	}
+	mem_pool_release();
+	cache->num_free[size_class] += i;
+
+	if(i == 0)
+	{
+		unsigned block_size = mem_class_block_size(size_class);
+		int num_blocks = MEM_CHUNK_SIZE/block_size;
+		char *chunk = (char *)malloc(num_blocks*block_size);
+		dbg_assert(chunk != 0, "mem_alloc failure");
+
+		/* chunks are never given back, freed blocks go back into the pools */
+		for(i = 0; i < num_blocks; i++)
 		{
-			dbg_msg("mem", "Memory check failed at %s(%d): %d", header->filename, header->line, header->size);
-			return 0;
+			block = (MEMHEADER *)(chunk+i*block_size);
+			block->next_free = cache->free_list[size_class];
+			cache->free_list[size_class] = block;
+		}
+		cache->num_free[size_class] += num_blocks;
+	}
+}
+
+static void mem_cache_destroy(void *user)
+{
+	MEMCACHE *cache = (MEMCACHE *)user;
+	int i;
+	for(i = 0; i < MEM_NUM_CLASSES; i++)
+		mem_cache_return(cache, i, cache->num_free[i]);
+	free(cache);
+}
+
+static MEMCACHE *mem_cache_get()
+{
+	MEMCACHE *cache;
+
+	if(mem_cache_key_state != 2)
+	{
+		if(atomic_compare_swap(&mem_cache_key_state, 0, 1) == 0)
+		{
+		#if defined(CONF_FAMILY_UNIX)
+			pthread_key_create(&mem_cache_key, mem_cache_destroy);
+		#elif defined(CONF_FAMILY_WINDOWS)
+			/* there is no destructor, the cache of an exiting thread is lost */
+			mem_cache_key = TlsAlloc();
+		#endif
+			sync_barrier();
+			mem_cache_key_state = 2;
+		}
+		else
+		{
+			while(mem_cache_key_state != 2)
+				thread_yield();
+		}
+	}
+
+#if defined(CONF_FAMILY_UNIX)
+	cache = (MEMCACHE *)pthread_getspecific(mem_cache_key);
+#elif defined(CONF_FAMILY_WINDOWS)
+	cache = (MEMCACHE *)TlsGetValue(mem_cache_key);
+#endif
+	if(!cache)
+	{
+		cache = (MEMCACHE *)calloc(1, sizeof(MEMCACHE));
+		dbg_assert(cache != 0, "mem_alloc failure");
+	#if defined(CONF_FAMILY_UNIX)
+		pthread_setspecific(mem_cache_key, cache);
+	#elif defined(CONF_FAMILY_WINDOWS)
+		TlsSetValue(mem_cache_key, cache);
+	#endif
+	}
+	return cache;
+}
+
+void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment)
+{
+	/* TODO: fix alignment */
+	MEMHEADER *header;
+	int size_class = 0;
+
+	while(size_class < MEM_NUM_CLASSES && (1u<<(size_class+MEM_MIN_CLASS_SHIFT)) < size)
+		size_class++;
+
+	if(size_class == MEM_NUM_CLASSES)
+	{
+		header = (MEMHEADER *)malloc(size+sizeof(MEMHEADER));
+		dbg_assert(header != 0, "mem_alloc failure");
+		header->info.size_class = -1;
+	}
+	else
+	{
+		MEMCACHE *cache = mem_cache_get();
+		if(!cache->free_list[size_class])
+			mem_cache_refill(cache, size_class);
+		header = cache->free_list[size_class];
+		cache->free_list[size_class] = header->next_free;
+		cache->num_free[size_class]--;
+		header->info.size_class = size_class;
+	}
+	header->info.size = size;
+
+	atomic_add(&memory_stats.allocated, size);
+	atomic_inc(&memory_stats.total_allocations);
+	atomic_inc(&memory_stats.active_allocations);
+
+	return header+1;
+}
+
+void mem_free(void *p)
+{
+	if(p)
+	{
+		MEMHEADER *header = (MEMHEADER *)p - 1;
+		int size_class = header->info.size_class;
+
+		atomic_add(&memory_stats.allocated, -(int)header->info.size);
+		atomic_dec(&memory_stats.active_allocations);
+
+		if(size_class < 0)
+			free(header);
+		else
+		{
+			MEMCACHE *cache = mem_cache_get();
+			header->next_free = cache->free_list[size_class];
+			cache->free_list[size_class] = header;
+			if(++cache->num_free[size_class] > MEM_CACHE_MAX)
+				mem_cache_return(cache, size_class, MEM_CACHE_BATCH);
 		}
-		header = header->next;
 	}
+}
+
+void mem_debug_dump(IOHANDLE file)
+{
+	static const char msg[] = "memory tracking is only available with CONF_MEM_DEBUG";
+	if(!file)
+		file = io_open("memory.txt", IOFLAG_WRITE);
 
+	if(file)
+	{
+		io_write(file, msg, sizeof(msg)-1);
+		io_write_newline(file);
+		io_close(file);
+	}
+}
+
+int mem_check_imp()
+{
 	return 1;
 }
+#endif
+
+
+void mem_copy(void *dest, const void *source, unsigned size)
+{
+	memcpy(dest, source, size);
+}
+
+void mem_move(void *dest, const void *source, unsigned size)
+{
+	memmove(dest, source, size);
+}
+
+void mem_zero(void *block,unsigned size)
+{
+	memset(block, 0, size);
+}
 
 IOHANDLE io_open(const char *filename, int flags)
 {
@@ -378,6 +847,67 @@ int io_flush(IOHANDLE io)
 	return 0;
 }
 
+const void *io_map(const char *filename, unsigned *size)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file, mapping;
+	DWORD length;
+	void *data;
+
+	*size = 0;
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return 0;
+	length = GetFileSize(file, NULL);
+	if(length == INVALID_FILE_SIZE || length == 0)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+	mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if(!mapping)
+		return 0;
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if(!data)
+		return 0;
+	*size = length;
+	return data;
+#else
+	struct stat sb;
+	void *data;
+	int fd;
+
+	*size = 0;
+	fd = open(filename, O_RDONLY);
+	if(fd < 0)
+		return 0;
+	if(fstat(fd, &sb) != 0 || sb.st_size <= 0)
+	{
+		close(fd);
+		return 0;
+	}
+	data = mmap(0, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED)
+		return 0;
+	*size = (unsigned)sb.st_size;
+	return data;
+#endif
+}
+
+void io_unmap(const void *data, unsigned size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, size);
+#endif
+}
+
 void *thread_create(void (*threadfunc)(void *), void *u)
 {
 #if defined(CONF_FAMILY_UNIX)
@@ -434,6 +964,20 @@ void thread_sleep(int milliseconds)
 #endif
 }
 
+int thread_num_cpus()
+{
+#if defined(CONF_FAMILY_UNIX)
+	long num = sysconf(_SC_NPROCESSORS_ONLN);
+	return num > 0 ? (int)num : 1;
+#elif defined(CONF_FAMILY_WINDOWS)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+	#error not implemented
+#endif
+}
+
 void thread_detach(void *thread)
 {
 #if defined(CONF_FAMILY_UNIX)
@@ -522,13 +1066,32 @@ void semaphore_signal(SEMAPHORE *sem) { sem_post(sem); }
 void semaphore_destroy(SEMAPHORE *sem) { sem_destroy(sem); }
 #elif defined(CONF_FAMILY_WINDOWS)
 void semaphore_init(SEMAPHORE *sem) { *sem = CreateSemaphore(0, 0, 10000, 0); }
-void semaphore_wait(SEMAPHORE *sem) { WaitForSingleObject((HANDLE)*sem, 0L); }
+void semaphore_wait(SEMAPHORE *sem) { WaitForSingleObject((HANDLE)*sem, INFINITE); }
 void semaphore_signal(SEMAPHORE *sem) { ReleaseSemaphore((HANDLE)*sem, 1, NULL); }
 void semaphore_destroy(SEMAPHORE *sem) { CloseHandle((HANDLE)*sem); }
 #else
 	#error not implemented on this platform
 #endif
 
+/* -----  atomics ----- */
+#if defined(CONF_FAMILY_WINDOWS)
+int atomic_inc(volatile int *value) { return InterlockedIncrement((volatile LONG *)value); }
+int atomic_dec(volatile int *value) { return InterlockedDecrement((volatile LONG *)value); }
+int atomic_add(volatile int *value, int amount) { return InterlockedExchangeAdd((volatile LONG *)value, amount)+amount; }
+int atomic_compare_swap(volatile int *value, int expected, int desired) { return InterlockedCompareExchange((volatile LONG *)value, desired, expected); }
+void *atomic_compare_swap_ptr(void * volatile *ptr, void *expected, void *desired) { return InterlockedCompareExchangePointer(ptr, desired, expected); }
+void sync_barrier() { MemoryBarrier(); }
+#elif defined(__GNUC__)
+int atomic_inc(volatile int *value) { return __sync_add_and_fetch(value, 1); }
+int atomic_dec(volatile int *value) { return __sync_sub_and_fetch(value, 1); }
+int atomic_add(volatile int *value, int amount) { return __sync_add_and_fetch(value, amount); }
+int atomic_compare_swap(volatile int *value, int expected, int desired) { return __sync_val_compare_and_swap(value, expected, desired); }
+void *atomic_compare_swap_ptr(void * volatile *ptr, void *expected, void *desired) { return __sync_val_compare_and_swap(ptr, expected, desired); }
+void sync_barrier() { __sync_synchronize(); }
+#else
+	#error not implemented on this platform
+#endif
+
 
 /* -----  time ----- */
 int64 time_get()
@@ -1474,6 +2037,28 @@ int fs_rename(const char *oldname, const char *newname)
 	return 0;
 }
 
+int fs_file_info(const char *filename, unsigned *size, int64 *modified)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	int64 filetime;
+	if(!GetFileAttributesExA(filename, GetFileExInfoStandard, &data) || (data.dwFileAttributes&FILE_ATTRIBUTE_DIRECTORY))
+		return 1;
+	*size = data.nFileSizeLow;
+	/* 100ns intervals since 1601 */
+	filetime = ((int64)data.ftLastWriteTime.dwHighDateTime<<32) | data.ftLastWriteTime.dwLowDateTime;
+	*modified = filetime/10000000 - 11644473600LL;
+	return 0;
+#else
+	struct stat sb;
+	if(stat(filename, &sb) != 0 || !S_ISREG(sb.st_mode))
+		return 1;
+	*size = (unsigned)sb.st_size;
+	*modified = (int64)sb.st_mtime;
+	return 0;
+#endif
+}
+
 void swap_endian(void *data, unsigned elem_size, unsigned num)
 {
 	char *src = (char*) data;
@@ -62,6 +62,23 @@ void dbg_break();
 */
 void dbg_msg(const char *sys, const char *fmt, ...);
 
+/*
+	Function: dbg_enable_threaded
+		Moves the invocation of the registered loggers to a
+		background thread.
+
+	Remarks:
+		- <dbg_msg> only formats the message and pushes it into a
+		lock-free queue afterwards. Messages are dropped (and the number
+		of dropped messages reported later) if the queue is full.
+		- Pending messages are flushed at exit and before an assert
+		breaks into the debugger.
+
+	See Also:
+		<dbg_msg>
+*/
+void dbg_enable_threaded();
+
 /* Group: Memory */
 
 /*
@@ -79,6 +96,9 @@ void dbg_msg(const char *sys, const char *fmt, ...);
 	Remarks:
 		- Passing 0 to size will allocated the smallest amount possible
 		and return a unique pointer.
+		- Small blocks are served from size class pools through a per
+		thread cache. Building with CONF_MEM_DEBUG instead tracks every
+		block with guards for <mem_check> and <mem_debug_dump>.
 
 	See Also:
 		<mem_free>
@@ -313,6 +333,33 @@ int io_close(IOHANDLE io);
 */
 int io_flush(IOHANDLE io);
 
+/*
+	Function: io_map
+		Maps a whole file read-only into memory.
+
+	Parameters:
+		filename - File to map.
+		size - Pointer that receives the size of the mapping.
+
+	Returns:
+		Returns a pointer to the file data, NULL on error or if the
+		file is empty.
+
+	Remarks:
+		- The mapping must be released with <io_unmap>.
+*/
+const void *io_map(const char *filename, unsigned *size);
+
+/*
+	Function: io_unmap
+		Releases a mapping created by <io_map>.
+
+	Parameters:
+		data - Pointer returned by <io_map>.
+		size - Size returned by <io_map>.
+*/
+void io_unmap(const void *data, unsigned size);
+
 
 /*
 	Function: io_stdin
@@ -379,6 +426,15 @@ void thread_destroy(void *thread);
 */
 void thread_yield();
 
+/*
+	Function: thread_num_cpus
+		Returns the number of logical processors that are online.
+
+	Returns:
+		The number of processors, at least 1.
+*/
+int thread_num_cpus();
+
 /*
 	Function: thread_detach
 		Puts the thread in the detached thread, guaranteeing that
@@ -417,6 +473,63 @@ void semaphore_wait(SEMAPHORE *sem);
 void semaphore_signal(SEMAPHORE *sem);
 void semaphore_destroy(SEMAPHORE *sem);
 
+/* Group: Atomics */
+
+/*
+	Function: atomic_inc
+		Atomically increments a value.
+
+	Returns:
+		The incremented value.
+*/
+int atomic_inc(volatile int *value);
+
+/*
+	Function: atomic_dec
+		Atomically decrements a value.
+
+	Returns:
+		The decremented value.
+*/
+int atomic_dec(volatile int *value);
+
+/*
+	Function: atomic_add
+		Atomically adds an amount to a value.
+
+	Returns:
+		The resulting value.
+*/
+int atomic_add(volatile int *value, int amount);
+
+/*
+	Function: atomic_compare_swap
+		Atomically replaces a value if it equals an expected one.
+
+	Parameters:
+		value - Value to modify.
+		expected - Value that is expected to be stored.
+		desired - Value to store if the expectation holds.
+
+	Returns:
+		The value stored before the operation. The swap happened if
+		it equals expected.
+*/
+int atomic_compare_swap(volatile int *value, int expected, int desired);
+
+/*
+	Function: atomic_compare_swap_ptr
+		Pointer version of <atomic_compare_swap>.
+*/
+void *atomic_compare_swap_ptr(void * volatile *ptr, void *expected, void *desired);
+
+/*
+	Function: sync_barrier
+		Full memory barrier, neither the compiler nor the cpu may
+		reorder loads and stores across it.
+*/
+void sync_barrier();
+
 /* Group: Timer */
 #ifdef __GNUC__
 /* if compiled with -pedantic-errors it will complain about long
@@ -1114,6 +1227,20 @@ int fs_remove(const char *filename);
 */
 int fs_rename(const char *oldname, const char *newname);
 
+/*
+	Function: fs_file_info
+		Gets the size and the last modification time of a file.
+
+	Parameters:
+		filename - The file to look at
+		size - Pointer that receives the size in bytes
+		modified - Pointer that receives the modification time as a unix timestamp
+
+	Returns:
+		Returns 0 on success, 1 on failure.
+*/
+int fs_file_info(const char *filename, unsigned *size, int64 *modified);
+
 /*
 	Group: Undocumented
 */
@@ -0,0 +1,46 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_ASSETCACHE_H
+#define ENGINE_ASSETCACHE_H
+
+#include "kernel.h"
+
+class IAssetCache : public IInterface
+{
+	MACRO_INTERFACE("assetcache", 0)
+public:
+	enum
+	{
+		MAX_INFO = 4,
+	};
+
+	// identifies the source data of a cache entry, Params holds
+	// everything else the decoded result depends on (e.g. the mixing rate).
+	// files are identified by their path, size and modification time so
+	// a cache hit doesn't have to read them
+	struct CKey
+	{
+		unsigned m_Crc;
+		unsigned m_Adler;
+		unsigned m_Size;
+		unsigned m_Params;
+	};
+
+	virtual void MakeKey(CKey *pKey, const void *pData, unsigned Size, unsigned Params) = 0;
+	virtual bool KeyFromFile(CKey *pKey, const char *pPath, unsigned Params) = 0;
+
+	// returns a copy of the cached data that has to be freed with mem_free, or 0 on a miss
+	virtual void *Load(const char *pType, const CKey *pKey, int *pInfo, unsigned *pDataSize) = 0;
+	virtual void Store(const char *pType, const CKey *pKey, const int *pInfo, const void *pData, unsigned DataSize) = 0;
+};
+
+class IEngineAssetCache : public IAssetCache
+{
+	MACRO_INTERFACE("engineassetcache", 0)
+public:
+	virtual void Init() = 0;
+};
+
+extern IEngineAssetCache *CreateEngineAssetCache();
+
+#endif
@@ -0,0 +1,225 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <base/tl/sorted_array.h>
+
+#include <engine/assetcache.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+#include <zlib.h>
+
+class CAssetCache : public IEngineAssetCache
+{
+	enum
+	{
+		VERSION = 1,
+	};
+
+	struct CHeader
+	{
+		char m_aID[4];
+		int m_Version;
+		CKey m_Key;
+		int m_aInfo[MAX_INFO];
+		unsigned m_DataSize;
+	};
+
+	struct CCacheFile
+	{
+		char m_aName[128];
+		unsigned m_Size;
+		int64 m_Modified;
+
+		bool operator<(const CCacheFile &Other) const { return m_Modified < Other.m_Modified; }
+	};
+
+	IStorage *m_pStorage;
+	bool m_Enabled;
+	volatile int m_TempCounter;
+
+	// total size of the cache folder, guarded by m_SizeLock
+	LOCK m_SizeLock;
+	int64 m_TotalSize;
+	sorted_array<CCacheFile> m_lFiles;
+
+	void GetFilename(const char *pType, const CKey *pKey, char *pBuf, int BufSize)
+	{
+		str_format(pBuf, BufSize, "cache/%s_v%d_%08x%08x_%u_%u.bin", pType, (int)VERSION, pKey->m_Crc, pKey->m_Adler, pKey->m_Size, pKey->m_Params);
+	}
+
+	bool Active() const
+	{
+		return m_Enabled && g_Config.m_ClAssetCache;
+	}
+
+	static int ListCacheFile(const char *pName, int IsDir, int StorageType, void *pUser)
+	{
+		CAssetCache *pSelf = (CAssetCache *)pUser;
+		int Length = str_length(pName);
+		if(IsDir || Length < 4 || str_comp(pName+Length-4, ".bin") != 0)
+			return 0;
+
+		CCacheFile File;
+		char aPath[512];
+		str_format(File.m_aName, sizeof(File.m_aName), "cache/%s", pName);
+		pSelf->m_pStorage->GetCompletePath(IStorage::TYPE_SAVE, File.m_aName, aPath, sizeof(aPath));
+		if(fs_file_info(aPath, &File.m_Size, &File.m_Modified) == 0)
+			pSelf->m_lFiles.add_unsorted(File);
+		return 0;
+	}
+
+	// recounts the cache folder and removes the oldest entries until it is
+	// a quarter below the limit, so this doesn't run again on the next store.
+	// m_SizeLock has to be held
+	void Prune()
+	{
+		int64 Limit = (int64)g_Config.m_ClAssetCacheSize*1024*1024;
+
+		m_lFiles.clear();
+		m_pStorage->ListDirectory(IStorage::TYPE_SAVE, "cache", ListCacheFile, this);
+		m_TotalSize = 0;
+		for(int i = 0; i < m_lFiles.size(); i++)
+			m_TotalSize += m_lFiles[i].m_Size;
+
+		if(m_TotalSize > Limit)
+		{
+			m_lFiles.sort_range();
+			int Removed = 0;
+			for(int i = 0; i < m_lFiles.size() && m_TotalSize > Limit/4*3; i++)
+			{
+				if(!m_pStorage->RemoveFile(m_lFiles[i].m_aName, IStorage::TYPE_SAVE))
+					continue;
+				m_TotalSize -= m_lFiles[i].m_Size;
+				Removed++;
+			}
+			dbg_msg("assetcache", "removed %d old cache files, %d KiB left", Removed, (int)(m_TotalSize/1024));
+		}
+		m_lFiles.clear();
+	}
+
+public:
+	CAssetCache()
+	{
+		m_pStorage = 0;
+		m_Enabled = false;
+		m_TempCounter = 0;
+		m_SizeLock = lock_create();
+		m_TotalSize = 0;
+	}
+
+	~CAssetCache()
+	{
+		lock_destroy(m_SizeLock);
+	}
+
+	virtual void Init()
+	{
+		m_pStorage = Kernel()->RequestInterface<IStorage>();
+		m_pStorage->CreateFolder("cache", IStorage::TYPE_SAVE);
+		m_Enabled = true;
+
+		lock_wait(m_SizeLock);
+		Prune();
+		lock_release(m_SizeLock);
+	}
+
+	virtual void MakeKey(CKey *pKey, const void *pData, unsigned Size, unsigned Params)
+	{
+		pKey->m_Crc = crc32(0, (const Bytef *)pData, Size);
+		pKey->m_Adler = adler32(1, (const Bytef *)pData, Size);
+		pKey->m_Size = Size;
+		pKey->m_Params = Params;
+	}
+
+	virtual bool KeyFromFile(CKey *pKey, const char *pPath, unsigned Params)
+	{
+		if(!Active())
+			return false;
+
+		unsigned Size;
+		int64 Modified;
+		if(fs_file_info(pPath, &Size, &Modified) != 0)
+			return false;
+
+		pKey->m_Crc = crc32(0, (const Bytef *)pPath, str_length(pPath));
+		pKey->m_Adler = (unsigned)Modified;
+		pKey->m_Size = Size;
+		pKey->m_Params = Params;
+		return Size > 0;
+	}
+
+	virtual void *Load(const char *pType, const CKey *pKey, int *pInfo, unsigned *pDataSize)
+	{
+		if(!Active())
+			return 0;
+
+		char aFilename[128];
+		char aPath[512];
+		GetFilename(pType, pKey, aFilename, sizeof(aFilename));
+		m_pStorage->GetCompletePath(IStorage::TYPE_SAVE, aFilename, aPath, sizeof(aPath));
+
+		unsigned MapSize;
+		const void *pMap = io_map(aPath, &MapSize);
+		if(!pMap)
+			return 0;
+
+		// the key is part of the filename, but a damaged or truncated file must not get through
+		const CHeader *pHeader = (const CHeader *)pMap;
+		if(MapSize < sizeof(CHeader) || mem_comp(pHeader->m_aID, "TWAC", 4) != 0 || pHeader->m_Version != VERSION ||
+			mem_comp(&pHeader->m_Key, pKey, sizeof(CKey)) != 0 || pHeader->m_DataSize != MapSize-sizeof(CHeader))
+		{
+			dbg_msg("assetcache", "ignoring invalid cache file '%s'", aFilename);
+			io_unmap(pMap, MapSize);
+			return 0;
+		}
+
+		void *pData = mem_alloc(pHeader->m_DataSize, 1);
+		mem_copy(pData, pHeader+1, pHeader->m_DataSize);
+		mem_copy(pInfo, pHeader->m_aInfo, sizeof(pHeader->m_aInfo));
+		*pDataSize = pHeader->m_DataSize;
+		io_unmap(pMap, MapSize);
+		return pData;
+	}
+
+	virtual void Store(const char *pType, const CKey *pKey, const int *pInfo, const void *pData, unsigned DataSize)
+	{
+		if(!Active())
+			return;
+
+		CHeader Header;
+		mem_zero(&Header, sizeof(Header));
+		mem_copy(Header.m_aID, "TWAC", 4);
+		Header.m_Version = VERSION;
+		Header.m_Key = *pKey;
+		mem_copy(Header.m_aInfo, pInfo, sizeof(Header.m_aInfo));
+		Header.m_DataSize = DataSize;
+
+		// write to a temporary file first so a reader never sees a half written entry,
+		// stores can happen from several job threads at once
+		char aFilename[128];
+		char aTempFilename[128];
+		GetFilename(pType, pKey, aFilename, sizeof(aFilename));
+		str_format(aTempFilename, sizeof(aTempFilename), "cache/tmp_%08x_%d.tmp", (unsigned)time_get(), atomic_inc(&m_TempCounter));
+
+		IOHANDLE File = m_pStorage->OpenFile(aTempFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!File)
+			return;
+		bool Ok = io_write(File, &Header, sizeof(Header)) == sizeof(Header) && io_write(File, pData, DataSize) == DataSize;
+		io_close(File);
+
+		if(!Ok || !m_pStorage->RenameFile(aTempFilename, aFilename, IStorage::TYPE_SAVE))
+		{
+			m_pStorage->RemoveFile(aTempFilename, IStorage::TYPE_SAVE);
+			return;
+		}
+
+		lock_wait(m_SizeLock);
+		m_TotalSize += sizeof(Header)+DataSize;
+		if(m_TotalSize > (int64)g_Config.m_ClAssetCacheSize*1024*1024)
+			Prune();
+		lock_release(m_SizeLock);
+	}
+};
+
+IEngineAssetCache *CreateEngineAssetCache() { return new CAssetCache; }
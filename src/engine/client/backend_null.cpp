@@ -0,0 +1,161 @@
+
+#include <base/detect.h>
+#include <base/math.h>
+#include <base/tl/threading.h>
+
+#include <base/system.h>
+
+#include "backend_null.h"
+
+// ------------ CCommandProcessor_Null
+
+CCommandProcessor_Null::CCommandProcessor_Null(int ScreenWidth, int ScreenHeight)
+{
+	mem_zero(&m_Stats, sizeof(m_Stats));
+	mem_zero(&m_LastState, sizeof(m_LastState));
+	m_HasLastState = false;
+	m_ScreenWidth = ScreenWidth;
+	m_ScreenHeight = ScreenHeight;
+}
+
+int CCommandProcessor_Null::TexFormatToBpp(int TexFormat)
+{
+	if(TexFormat == CCommandBuffer::TEXFORMAT_RGB) return 3;
+	if(TexFormat == CCommandBuffer::TEXFORMAT_ALPHA) return 1;
+	return 4;
+}
+
+void CCommandProcessor_Null::Cmd_Texture_Update(const CCommandBuffer::SCommand_Texture_Update *pCommand)
+{
+	m_Stats.m_TextureUploads++;
+	m_Stats.m_TextureUploadBytes += pCommand->m_Width*pCommand->m_Height*TexFormatToBpp(pCommand->m_Format);
+	mem_free(pCommand->m_pData);
+}
+
+void CCommandProcessor_Null::Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand)
+{
+	m_Stats.m_TextureUploads++;
+	m_Stats.m_TextureUploadBytes += pCommand->m_Width*pCommand->m_Height*TexFormatToBpp(pCommand->m_Format);
+	mem_free(pCommand->m_pData);
+}
+
+void CCommandProcessor_Null::Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand)
+{
+	const CCommandBuffer::SState &State = pCommand->m_State;
+	if(!m_HasLastState || mem_comp(&m_LastState, &State, sizeof(State)) != 0)
+	{
+		m_Stats.m_StateChanges++;
+		if(!m_HasLastState || m_LastState.m_Texture != State.m_Texture)
+			m_Stats.m_TextureChanges++;
+		m_LastState = State;
+		m_HasLastState = true;
+	}
+
+	m_Stats.m_RenderCalls++;
+	if(pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_QUADS)
+		m_Stats.m_Vertices += pCommand->m_PrimCount*4;
+	else if(pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_LINES)
+		m_Stats.m_Vertices += pCommand->m_PrimCount*2;
+}
+
+void CCommandProcessor_Null::Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand)
+{
+	// hand out a black image so the caller can go through its normal path
+	int w = m_ScreenWidth;
+	int h = m_ScreenHeight;
+	unsigned char *pPixelData = (unsigned char *)mem_alloc(w*h*3, 1);
+	mem_zero(pPixelData, w*h*3);
+
+	pCommand->m_pImage->m_Width = w;
+	pCommand->m_pImage->m_Height = h;
+	pCommand->m_pImage->m_Format = CImageInfo::FORMAT_RGB;
+	pCommand->m_pImage->m_pData = pPixelData;
+}
+
+void CCommandProcessor_Null::Cmd_VideoModes(const CCommandBuffer::SCommand_VideoModes *pCommand)
+{
+	// only the current resolution is available
+	if(pCommand->m_MaxModes < 1)
+	{
+		*pCommand->m_pNumModes = 0;
+		return;
+	}
+
+	pCommand->m_pModes[0].m_Width = m_ScreenWidth;
+	pCommand->m_pModes[0].m_Height = m_ScreenHeight;
+	pCommand->m_pModes[0].m_Red = 8;
+	pCommand->m_pModes[0].m_Green = 8;
+	pCommand->m_pModes[0].m_Blue = 8;
+	*pCommand->m_pNumModes = 1;
+}
+
+void CCommandProcessor_Null::RunBuffer(CCommandBuffer *pBuffer)
+{
+	unsigned CmdIndex = 0;
+	while(1)
+	{
+		const CCommandBuffer::SCommand *pBaseCommand = pBuffer->GetCommand(&CmdIndex);
+		if(pBaseCommand == 0x0)
+			break;
+
+		m_Stats.m_Commands++;
+
+		switch(pBaseCommand->m_Cmd)
+		{
+		case CCommandBuffer::CMD_NOP: break;
+		case CCommandBuffer::CMD_SIGNAL: static_cast<const CCommandBuffer::SCommand_Signal *>(pBaseCommand)->m_pSemaphore->signal(); break;
+		case CCommandBuffer::CMD_TEXTURE_CREATE: Cmd_Texture_Create(static_cast<const CCommandBuffer::SCommand_Texture_Create *>(pBaseCommand)); break;
+		case CCommandBuffer::CMD_TEXTURE_DESTROY: break;
+		case CCommandBuffer::CMD_TEXTURE_UPDATE: Cmd_Texture_Update(static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand)); break;
+		case CCommandBuffer::CMD_CLEAR: break;
+		case CCommandBuffer::CMD_RENDER: Cmd_Render(static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand)); break;
+		case CCommandBuffer::CMD_SWAP: m_Stats.m_Frames++; break;
+		case CCommandBuffer::CMD_SCREENSHOT: Cmd_Screenshot(static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand)); break;
+		case CCommandBuffer::CMD_VIDEOMODES: Cmd_VideoModes(static_cast<const CCommandBuffer::SCommand_VideoModes *>(pBaseCommand)); break;
+		default: dbg_msg("graphics", "unknown command %d", pBaseCommand->m_Cmd);
+		}
+	}
+}
+
+// ------------ CGraphicsBackend_Null
+
+CGraphicsBackend_Null::CGraphicsBackend_Null()
+{
+	m_pProcessor = 0;
+	m_StartTime = 0;
+}
+
+int CGraphicsBackend_Null::Init(const char *pName, int Width, int Height, int FsaaSamples, int Flags)
+{
+	m_pProcessor = new CCommandProcessor_Null(Width, Height);
+	m_StartTime = time_get();
+	dbg_msg("gfx", "using null backend, nothing will be displayed");
+	return 0;
+}
+
+int CGraphicsBackend_Null::Shutdown()
+{
+	// report what would have been sent to the gpu
+	const CCommandProcessor_Null::CStats &Stats = m_pProcessor->Stats();
+	int64 Frames = Stats.m_Frames > 0 ? Stats.m_Frames : 1;
+	float Seconds = (time_get()-m_StartTime)/(float)time_freq();
+	dbg_msg("gfx/null", "frames=%d time=%.2fs commands=%d render_calls=%d vertices=%d",
+		(int)Stats.m_Frames, Seconds, (int)Stats.m_Commands, (int)Stats.m_RenderCalls, (int)Stats.m_Vertices);
+	dbg_msg("gfx/null", "per frame: commands=%.1f render_calls=%.1f vertices=%.1f state_changes=%.1f texture_changes=%.1f",
+		Stats.m_Commands/(float)Frames, Stats.m_RenderCalls/(float)Frames, Stats.m_Vertices/(float)Frames,
+		Stats.m_StateChanges/(float)Frames, Stats.m_TextureChanges/(float)Frames);
+	dbg_msg("gfx/null", "texture uploads=%d bytes=%d",
+		(int)Stats.m_TextureUploads, (int)Stats.m_TextureUploadBytes);
+
+	delete m_pProcessor;
+	m_pProcessor = 0;
+	return 0;
+}
+
+void CGraphicsBackend_Null::RunBuffer(CCommandBuffer *pBuffer)
+{
+	m_pProcessor->RunBuffer(pBuffer);
+}
+
+
+IGraphicsBackend *CreateGraphicsBackendNull() { return new CGraphicsBackend_Null; }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "graphics_threaded.h"
+
+// command processor that does not touch any graphics api, it only
+// keeps statistics about the commands that it gets fed with
+class CCommandProcessor_Null
+{
+public:
+	struct CStats
+	{
+		int64 m_Frames;
+		int64 m_Commands;
+		int64 m_RenderCalls;
+		int64 m_Vertices;
+		int64 m_StateChanges;
+		int64 m_TextureChanges;
+		int64 m_TextureUploads;
+		int64 m_TextureUploadBytes;
+	};
+
+private:
+	CStats m_Stats;
+	CCommandBuffer::SState m_LastState;
+	bool m_HasLastState;
+	int m_ScreenWidth;
+	int m_ScreenHeight;
+
+	static int TexFormatToBpp(int TexFormat);
+
+	void Cmd_Texture_Update(const CCommandBuffer::SCommand_Texture_Update *pCommand);
+	void Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand);
+	void Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand);
+	void Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand);
+	void Cmd_VideoModes(const CCommandBuffer::SCommand_VideoModes *pCommand);
+
+public:
+	CCommandProcessor_Null(int ScreenWidth, int ScreenHeight);
+
+	void RunBuffer(CCommandBuffer *pBuffer);
+	const CStats &Stats() const { return m_Stats; }
+};
+
+// graphics backend that discards everything, used for headless runs and benchmarks.
+// buffers are processed directly on the calling thread so the cost measured by the
+// client is the pure cpu side cost of building the command buffers
+class CGraphicsBackend_Null : public IGraphicsBackend
+{
+	CCommandProcessor_Null *m_pProcessor;
+	int64 m_StartTime;
+public:
+	CGraphicsBackend_Null();
+
+	virtual int Init(const char *pName, int Width, int Height, int FsaaSamples, int Flags);
+	virtual int Shutdown();
+
+	virtual void Minimize() {}
+	virtual void Maximize() {}
+	virtual int WindowActive() { return 1; }
+	virtual int WindowOpen() { return 1; }
+
+	virtual void RunBuffer(CCommandBuffer *pBuffer);
+	virtual bool IsIdle() const { return true; }
+	virtual void WaitForIdle() {}
+};
@@ -9,6 +9,7 @@
 #include <base/system.h>
 #include <base/tl/threading.h>
 
+#include <engine/assetcache.h>
 #include <engine/client.h>
 #include <engine/config.h>
 #include <engine/console.h>
@@ -263,6 +264,10 @@ CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta), m_DemoRecorder(&m_SnapshotD
 	m_AutoScreenshotRecycle = false;
 	m_EditorActive = false;
 
+	m_Benchmark = false;
+	m_BenchmarkStartTime = 0;
+	m_BenchmarkStartFrames = 0;
+
 	m_AckGameTick = -1;
 	m_CurrentRecvTick = 0;
 	m_RconAuthed = 0;
@@ -738,6 +743,14 @@ void CClient::DebugRender()
 		(int)((m_PredictedTime.Get(Now)-m_GameTime.Get(Now))*1000/(float)time_freq()));
 	Graphics()->QuadsText(2, 70, 16, 1,1,1,1, aBuffer);
 
+	{
+		int DrawCalls, DrawsRequested;
+		Graphics()->GetDrawStats(&DrawCalls, &DrawsRequested);
+		str_format(aBuffer, sizeof(aBuffer), "draws: %d (%d requested, %d merged)",
+			DrawCalls, DrawsRequested, DrawsRequested-DrawCalls);
+		Graphics()->QuadsText(2, 84, 16, 1,1,1,1, aBuffer);
+	}
+
 	// render graphs
 	if(g_Config.m_DbgGraphs)
 	{
@@ -1727,7 +1740,7 @@ void CClient::Run()
 
 	// init graphics
 	{
-		if(g_Config.m_GfxThreaded)
+		if(g_Config.m_GfxThreaded || g_Config.m_GfxNull)
 			m_pGraphics = CreateEngineGraphicsThreaded();
 		else
 			m_pGraphics = CreateEngineGraphics();
@@ -1802,6 +1815,24 @@ void CClient::Run()
 	// process pending commands
 	m_pConsole->StoreCommands(false);
 
+	// start the benchmark demo if wanted
+	if(g_Config.m_DbgBench[0])
+	{
+		const char *pError = DemoPlayer_Play(g_Config.m_DbgBench, IStorage::TYPE_ALL);
+		if(pError)
+		{
+			str_format(aBuf, sizeof(aBuf), "couldn't start benchmark: %s", pError);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+			g_Config.m_DbgBench[0] = 0;
+		}
+		else
+		{
+			m_Benchmark = true;
+			m_BenchmarkStartTime = time_get();
+			m_BenchmarkStartFrames = m_RenderFrames;
+		}
+	}
+
 	while (1)
 	{
 		//
@@ -1939,6 +1970,18 @@ void CClient::Run()
 		if(State() == IClient::STATE_QUITING)
 			break;
 
+		// the benchmark is over once the demo reached its end
+		if(m_Benchmark && (State() != IClient::STATE_DEMOPLAYBACK || m_DemoPlayer.Info()->m_Info.m_Paused))
+		{
+			float Seconds = (time_get()-m_BenchmarkStartTime)/(float)time_freq();
+			int Frames = m_RenderFrames-m_BenchmarkStartFrames;
+			str_format(aBuf, sizeof(aBuf), "frames=%d time=%.2fs avg_fps=%.1f", Frames, Seconds, Seconds > 0.0f ? Frames/Seconds : 0.0f);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+			m_Benchmark = false;
+			Quit();
+			break;
+		}
+
 		// beNice
 		if(g_Config.m_DbgStress)
 			thread_sleep(5);
@@ -2296,6 +2339,7 @@ int main(int argc, const char **argv) // ignore_convention
 	pClient->RegisterInterfaces();
 
 	// create the components
+	// one job thread per core, asset loading at startup spreads over all of them
 	IEngine *pEngine = CreateEngine("Teeworlds");
 	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
 	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
@@ -2305,6 +2349,7 @@ int main(int argc, const char **argv) // ignore_convention
 	IEngineTextRender *pEngineTextRender = CreateEngineTextRender();
 	IEngineMap *pEngineMap = CreateEngineMap();
 	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
+	IEngineAssetCache *pEngineAssetCache = CreateEngineAssetCache();
 
 	{
 		bool RegisterFail = false;
@@ -2328,6 +2373,9 @@ int main(int argc, const char **argv) // ignore_convention
 		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(pEngineMasterServer)); // register as both
 		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMasterServer*>(pEngineMasterServer));
 
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineAssetCache*>(pEngineAssetCache)); // register as both
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IAssetCache*>(pEngineAssetCache));
+
 		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateEditor());
 		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateGameClient());
 		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
@@ -2340,6 +2388,7 @@ int main(int argc, const char **argv) // ignore_convention
 	pConfig->Init();
 	pEngineMasterServer->Init();
 	pEngineMasterServer->Load();
+	pEngineAssetCache->Init();
 
 	// register all console commands
 	pClient->RegisterCommands();
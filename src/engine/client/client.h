@@ -90,6 +90,11 @@ class CClient : public IClient, public CDemoPlayer::IListner
 	float m_RenderFrameTimeHigh;
 	int m_RenderFrames;
 
+	// benchmark
+	bool m_Benchmark;
+	int64 m_BenchmarkStartTime;
+	int m_BenchmarkStartFrames;
+
 	NETADDR m_ServerAddress;
 	int m_WindowMustRefocus;
 	int m_SnapCrcErrors;
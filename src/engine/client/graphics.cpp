@@ -13,6 +13,7 @@
 
 #include <engine/shared/config.h>
 #include <engine/graphics.h>
+#include <engine/assetcache.h>
 #include <engine/storage.h>
 #include <engine/keys.h>
 #include <engine/console.h>
@@ -73,6 +74,7 @@ void CGraphics_OpenGL::Flush()
 			glDrawArrays(GL_QUADS, 0, m_NumVertices);
 		else if(m_Drawing == DRAWING_LINES)
 			glDrawArrays(GL_LINES, 0, m_NumVertices);
+		m_DrawCalls++;
 	}
 
 	// Reset pointer
@@ -141,6 +143,9 @@ CGraphics_OpenGL::CGraphics_OpenGL()
 {
 	m_NumVertices = 0;
 
+	m_DrawCalls = 0;
+	m_LastDrawCalls = 0;
+
 	m_ScreenX0 = 0;
 	m_ScreenY0 = 0;
 	m_ScreenX1 = 0;
@@ -434,14 +439,32 @@ int CGraphics_OpenGL::LoadPNG(CImageInfo *pImg, const char *pFilename, int Stora
 	png_init(0,0); // ignore_convention
 
 	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
-	if(File)
-		io_close(File);
-	else
+	if(!File)
 	{
 		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
 		return 0;
 	}
 
+	io_close(File);
+
+	// decoded images are cached by the path, size and modification time of the png
+	IAssetCache::CKey Key;
+	bool UseCache = m_pAssetCache && m_pAssetCache->KeyFromFile(&Key, aCompleteFilename, 0);
+	if(UseCache)
+	{
+		int aInfo[IAssetCache::MAX_INFO];
+		unsigned DataSize;
+		void *pData = m_pAssetCache->Load("img", &Key, aInfo, &DataSize);
+		if(pData)
+		{
+			pImg->m_Width = aInfo[0];
+			pImg->m_Height = aInfo[1];
+			pImg->m_Format = aInfo[2];
+			pImg->m_pData = pData;
+			return 1;
+		}
+	}
+
 	int Error = png_open_file(&Png, aCompleteFilename); // ignore_convention
 	if(Error != PNG_NO_ERROR)
 	{
@@ -469,6 +492,12 @@ int CGraphics_OpenGL::LoadPNG(CImageInfo *pImg, const char *pFilename, int Stora
 	else if(Png.color_type == PNG_TRUECOLOR_ALPHA) // ignore_convention
 		pImg->m_Format = CImageInfo::FORMAT_RGBA;
 	pImg->m_pData = pBuffer;
+
+	if(UseCache)
+	{
+		int aInfo[IAssetCache::MAX_INFO] = { pImg->m_Width, pImg->m_Height, pImg->m_Format, 0 };
+		m_pAssetCache->Store("img", &Key, aInfo, pBuffer, Png.width * Png.height * Png.bpp); // ignore_convention
+	}
 	return 1;
 }
 
@@ -686,6 +715,59 @@ void CGraphics_OpenGL::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
 	AddVertices(4*Num);
 }
 
+void CGraphics_OpenGL::QuadsDrawTextured(const CTexturedQuadItem *pArray, int Num)
+{
+	CPoint Center;
+	Center.z = 0;
+
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawTextured without begin");
+
+	while(Num > 0)
+	{
+		// never write past the vertex buffer, big arrays are split up
+		int Count = (MAX_VERTICES - m_NumVertices)/4;
+		if(Count <= 0)
+		{
+			Flush();
+			continue;
+		}
+		if(Count > Num)
+			Count = Num;
+
+		for(int i = 0; i < Count; ++i)
+		{
+			const CTexturedQuadItem *pItem = &pArray[i];
+			for(int v = 0; v < 4; v++)
+			{
+				m_aVertices[m_NumVertices + 4*i + v].m_Tex.u = pItem->m_aU[v];
+				m_aVertices[m_NumVertices + 4*i + v].m_Tex.v = pItem->m_aV[v];
+				m_aVertices[m_NumVertices + 4*i + v].m_Color = m_aColor[v];
+			}
+
+			m_aVertices[m_NumVertices + 4*i].m_Pos.x = pItem->m_X;
+			m_aVertices[m_NumVertices + 4*i].m_Pos.y = pItem->m_Y;
+			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.x = pItem->m_X + pItem->m_Width;
+			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.y = pItem->m_Y;
+			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.x = pItem->m_X + pItem->m_Width;
+			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.y = pItem->m_Y + pItem->m_Height;
+			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.x = pItem->m_X;
+			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.y = pItem->m_Y + pItem->m_Height;
+
+			if(m_Rotation != 0)
+			{
+				Center.x = pItem->m_X + pItem->m_Width/2;
+				Center.y = pItem->m_Y + pItem->m_Height/2;
+
+				Rotate4(Center, &m_aVertices[m_NumVertices + 4*i]);
+			}
+		}
+
+		AddVertices(4*Count);
+		pArray += Count;
+		Num -= Count;
+	}
+}
+
 void CGraphics_OpenGL::QuadsText(float x, float y, float Size, float r, float g, float b, float a, const char *pText)
 {
 	float StartX = x;
@@ -720,9 +802,17 @@ void CGraphics_OpenGL::QuadsText(float x, float y, float Size, float r, float g,
 	QuadsEnd();
 }
 
+void CGraphics_OpenGL::GetDrawStats(int *pDrawCalls, int *pDrawsRequested)
+{
+	// no batching here, every flush is a draw call
+	*pDrawCalls = m_LastDrawCalls;
+	*pDrawsRequested = m_LastDrawCalls;
+}
+
 int CGraphics_OpenGL::Init()
 {
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
+	m_pAssetCache = Kernel()->RequestInterface<IAssetCache>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 
 	// Set all z to -5.0f
@@ -937,6 +1027,9 @@ void CGraphics_SDL::Swap()
 
 	if(g_Config.m_GfxFinish)
 		glFinish();
+
+	m_LastDrawCalls = m_DrawCalls;
+	m_DrawCalls = 0;
 }
 
 
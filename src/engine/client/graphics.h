@@ -7,6 +7,7 @@ class CGraphics_OpenGL : public IEngineGraphics
 {
 protected:
 	class IStorage *m_pStorage;
+	class IAssetCache *m_pAssetCache;
 	class IConsole *m_pConsole;
 
 	//
@@ -62,6 +63,9 @@ protected:
 	int m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
 
+	int m_DrawCalls;
+	int m_LastDrawCalls;
+
 	void Flush();
 	void AddVertices(int Count);
 	void Rotate4(const CPoint &rCenter, CVertex *pPoints);
@@ -119,8 +123,11 @@ public:
 	virtual void QuadsDraw(CQuadItem *pArray, int Num);
 	virtual void QuadsDrawTL(const CQuadItem *pArray, int Num);
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
+	virtual void QuadsDrawTextured(const CTexturedQuadItem *pArray, int Num);
 	virtual void QuadsText(float x, float y, float Size, float r, float g, float b, float a, const char *pText);
 
+	virtual void GetDrawStats(int *pDrawCalls, int *pDrawsRequested);
+
 	virtual int Init();
 };
 
@@ -10,6 +10,7 @@
 
 #include <engine/shared/config.h>
 #include <engine/graphics.h>
+#include <engine/assetcache.h>
 #include <engine/storage.h>
 #include <engine/keys.h>
 #include <engine/console.h>
@@ -50,21 +51,40 @@ void CGraphics_Threaded::FlushVertices()
 	int NumVerts = m_NumVertices;
 	m_NumVertices = 0;
 
-	CCommandBuffer::SCommand_Render Cmd;
-	Cmd.m_State = m_State;
-
+	unsigned PrimType;
 	if(m_Drawing == DRAWING_QUADS)
-	{
-		Cmd.m_PrimType = CCommandBuffer::PRIMTYPE_QUADS;
-		Cmd.m_PrimCount = NumVerts/4;
-	}
+		PrimType = CCommandBuffer::PRIMTYPE_QUADS;
 	else if(m_Drawing == DRAWING_LINES)
+		PrimType = CCommandBuffer::PRIMTYPE_LINES;
+	else
+		return;
+
+	m_DrawsRequested++;
+
+	if(g_Config.m_GfxBatching)
 	{
-		Cmd.m_PrimType = CCommandBuffer::PRIMTYPE_LINES;
-		Cmd.m_PrimCount = NumVerts/2;
+		BatchVertices(PrimType, NumVerts);
+		return;
 	}
+
+	// batching might just have been turned off
+	if(m_NumBatchDraws)
+		SubmitBatch();
+
+	CCommandBuffer::SVertex *pVertices = AllocRenderCommand(m_State, PrimType, NumVerts);
+	if(pVertices)
+		mem_copy(pVertices, m_aVertices, sizeof(CCommandBuffer::SVertex)*NumVerts);
+}
+
+CCommandBuffer::SVertex *CGraphics_Threaded::AllocRenderCommand(const CCommandBuffer::SState &State, unsigned PrimType, int NumVerts)
+{
+	CCommandBuffer::SCommand_Render Cmd;
+	Cmd.m_State = State;
+	Cmd.m_PrimType = PrimType;
+	if(PrimType == CCommandBuffer::PRIMTYPE_QUADS)
+		Cmd.m_PrimCount = NumVerts/4;
 	else
-		return;
+		Cmd.m_PrimCount = NumVerts/2;
 
 	Cmd.m_pVertices = (CCommandBuffer::SVertex *)m_pCommandBuffer->AllocData(sizeof(CCommandBuffer::SVertex)*NumVerts);
 	if(Cmd.m_pVertices == 0x0)
@@ -76,7 +96,7 @@ void CGraphics_Threaded::FlushVertices()
 		if(Cmd.m_pVertices == 0x0)
 		{
 			dbg_msg("graphics", "failed to allocate data for vertices");
-			return;
+			return 0x0;
 		}
 	}
 
@@ -90,17 +110,127 @@ void CGraphics_Threaded::FlushVertices()
 		if(Cmd.m_pVertices == 0x0)
 		{
 			dbg_msg("graphics", "failed to allocate data for vertices");
-			return;
+			return 0x0;
 		}
 
 		if(!m_pCommandBuffer->AddCommand(Cmd))
 		{
 			dbg_msg("graphics", "failed to allocate memory for render command");
-			return;
+			return 0x0;
+		}
+	}
+
+	m_DrawCalls++;
+	return Cmd.m_pVertices;
+}
+
+bool CGraphics_Threaded::StatesEqual(const CCommandBuffer::SState &a, const CCommandBuffer::SState &b)
+{
+	if(a.m_BlendMode != b.m_BlendMode || a.m_WrapMode != b.m_WrapMode || a.m_Texture != b.m_Texture)
+		return false;
+	if(a.m_ScreenTL.x != b.m_ScreenTL.x || a.m_ScreenTL.y != b.m_ScreenTL.y ||
+		a.m_ScreenBR.x != b.m_ScreenBR.x || a.m_ScreenBR.y != b.m_ScreenBR.y)
+		return false;
+	if(a.m_ClipEnable != b.m_ClipEnable)
+		return false;
+	if(a.m_ClipEnable && (a.m_ClipX != b.m_ClipX || a.m_ClipY != b.m_ClipY || a.m_ClipW != b.m_ClipW || a.m_ClipH != b.m_ClipH))
+		return false;
+	return true;
+}
+
+void CGraphics_Threaded::BatchVertices(unsigned PrimType, int NumVerts)
+{
+	if(m_NumBatchVertices+NumVerts > MAX_BATCH_VERTICES || m_NumBatchDraws == MAX_BATCH_DRAWS || m_NumBatchSegments == MAX_BATCH_SEGMENTS)
+		SubmitBatch();
+
+	// bounds in normalized screen space so draws with different mappings can be compared
+	float aBox[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+	float ScreenW = m_State.m_ScreenBR.x-m_State.m_ScreenTL.x;
+	float ScreenH = m_State.m_ScreenBR.y-m_State.m_ScreenTL.y;
+	if(ScreenW != 0.0f && ScreenH != 0.0f)
+	{
+		float MinX = m_aVertices[0].m_Pos.x, MaxX = MinX;
+		float MinY = m_aVertices[0].m_Pos.y, MaxY = MinY;
+		for(int i = 1; i < NumVerts; i++)
+		{
+			MinX = min(MinX, m_aVertices[i].m_Pos.x);
+			MaxX = max(MaxX, m_aVertices[i].m_Pos.x);
+			MinY = min(MinY, m_aVertices[i].m_Pos.y);
+			MaxY = max(MaxY, m_aVertices[i].m_Pos.y);
+		}
+		aBox[0] = (MinX-m_State.m_ScreenTL.x)/ScreenW;
+		aBox[1] = (MinY-m_State.m_ScreenTL.y)/ScreenH;
+		aBox[2] = (MaxX-m_State.m_ScreenTL.x)/ScreenW;
+		aBox[3] = (MaxY-m_State.m_ScreenTL.y)/ScreenH;
+	}
+
+	// look for an earlier draw with the same state. the new draw can only be moved
+	// in front of the draws in between if it does not overlap any of them
+	int Target = -1;
+	for(int i = m_NumBatchDraws-1; i >= 0 && i >= m_NumBatchDraws-BATCH_SEARCH_DEPTH; i--)
+	{
+		CBatchDraw *pDraw = &m_aBatchDraws[i];
+		if(pDraw->m_PrimType == PrimType && StatesEqual(pDraw->m_State, m_State))
+		{
+			Target = i;
+			break;
+		}
+
+		if(aBox[0] <= pDraw->m_aBox[2] && aBox[2] >= pDraw->m_aBox[0] &&
+			aBox[1] <= pDraw->m_aBox[3] && aBox[3] >= pDraw->m_aBox[1])
+			break;
+	}
+
+	// store the vertices
+	int Segment = m_NumBatchSegments++;
+	m_aBatchSegments[Segment].m_Offset = m_NumBatchVertices;
+	m_aBatchSegments[Segment].m_Count = NumVerts;
+	m_aBatchSegments[Segment].m_Next = -1;
+	mem_copy(&m_aBatchVertices[m_NumBatchVertices], m_aVertices, sizeof(CCommandBuffer::SVertex)*NumVerts);
+	m_NumBatchVertices += NumVerts;
+
+	if(Target >= 0)
+	{
+		CBatchDraw *pDraw = &m_aBatchDraws[Target];
+		m_aBatchSegments[pDraw->m_LastSegment].m_Next = Segment;
+		pDraw->m_LastSegment = Segment;
+		pDraw->m_NumVertices += NumVerts;
+		pDraw->m_aBox[0] = min(pDraw->m_aBox[0], aBox[0]);
+		pDraw->m_aBox[1] = min(pDraw->m_aBox[1], aBox[1]);
+		pDraw->m_aBox[2] = max(pDraw->m_aBox[2], aBox[2]);
+		pDraw->m_aBox[3] = max(pDraw->m_aBox[3], aBox[3]);
+	}
+	else
+	{
+		CBatchDraw *pDraw = &m_aBatchDraws[m_NumBatchDraws++];
+		pDraw->m_State = m_State;
+		pDraw->m_PrimType = PrimType;
+		pDraw->m_NumVertices = NumVerts;
+		pDraw->m_FirstSegment = Segment;
+		pDraw->m_LastSegment = Segment;
+		mem_copy(pDraw->m_aBox, aBox, sizeof(aBox));
+	}
+}
+
+void CGraphics_Threaded::SubmitBatch()
+{
+	for(int i = 0; i < m_NumBatchDraws; i++)
+	{
+		const CBatchDraw *pDraw = &m_aBatchDraws[i];
+		CCommandBuffer::SVertex *pVertices = AllocRenderCommand(pDraw->m_State, pDraw->m_PrimType, pDraw->m_NumVertices);
+		if(!pVertices)
+			continue;
+
+		for(int s = pDraw->m_FirstSegment; s != -1; s = m_aBatchSegments[s].m_Next)
+		{
+			mem_copy(pVertices, &m_aBatchVertices[m_aBatchSegments[s].m_Offset], sizeof(CCommandBuffer::SVertex)*m_aBatchSegments[s].m_Count);
+			pVertices += m_aBatchSegments[s].m_Count;
 		}
 	}
 
-	mem_copy(Cmd.m_pVertices, m_aVertices, sizeof(CCommandBuffer::SVertex)*NumVerts);
+	m_NumBatchVertices = 0;
+	m_NumBatchDraws = 0;
+	m_NumBatchSegments = 0;
 }
 
 void CGraphics_Threaded::AddVertices(int Count)
@@ -183,6 +313,15 @@ CGraphics_Threaded::CGraphics_Threaded()
 
 	m_NumVertices = 0;
 
+	m_NumBatchVertices = 0;
+	m_NumBatchDraws = 0;
+	m_NumBatchSegments = 0;
+
+	m_DrawCalls = 0;
+	m_DrawsRequested = 0;
+	m_LastDrawCalls = 0;
+	m_LastDrawsRequested = 0;
+
 	m_ScreenWidth = -1;
 	m_ScreenHeight = -1;
 
@@ -310,6 +449,8 @@ int CGraphics_Threaded::UnloadTexture(int Index)
 
 	CCommandBuffer::SCommand_Texture_Destroy Cmd;
 	Cmd.m_Slot = Index;
+	// pending draws have to go out before anything else
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 
 	m_aTextures[Index].m_Next = m_FirstFreeTexture;
@@ -352,6 +493,7 @@ int CGraphics_Threaded::LoadTextureRawSub(int TextureID, int x, int y, int Width
 	Cmd.m_pData = pTmpData;
 
 	//
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 	return 0;
 }
@@ -394,6 +536,7 @@ int CGraphics_Threaded::LoadTextureRaw(int Width, int Height, int Format, const
 	Cmd.m_pData = pTmpData;
 
 	//
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 
 	// calculate memory usage
@@ -444,14 +587,32 @@ int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int Sto
 	png_init(0,0); // ignore_convention
 
 	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
-	if(File)
-		io_close(File);
-	else
+	if(!File)
 	{
 		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
 		return 0;
 	}
 
+	io_close(File);
+
+	// decoded images are cached by the path, size and modification time of the png
+	IAssetCache::CKey Key;
+	bool UseCache = m_pAssetCache && m_pAssetCache->KeyFromFile(&Key, aCompleteFilename, 0);
+	if(UseCache)
+	{
+		int aInfo[IAssetCache::MAX_INFO];
+		unsigned DataSize;
+		void *pData = m_pAssetCache->Load("img", &Key, aInfo, &DataSize);
+		if(pData)
+		{
+			pImg->m_Width = aInfo[0];
+			pImg->m_Height = aInfo[1];
+			pImg->m_Format = aInfo[2];
+			pImg->m_pData = pData;
+			return 1;
+		}
+	}
+
 	int Error = png_open_file(&Png, aCompleteFilename); // ignore_convention
 	if(Error != PNG_NO_ERROR)
 	{
@@ -479,6 +640,12 @@ int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int Sto
 	else if(Png.color_type == PNG_TRUECOLOR_ALPHA) // ignore_convention
 		pImg->m_Format = CImageInfo::FORMAT_RGBA;
 	pImg->m_pData = pBuffer;
+
+	if(UseCache)
+	{
+		int aInfo[IAssetCache::MAX_INFO] = { pImg->m_Width, pImg->m_Height, pImg->m_Format, 0 };
+		m_pAssetCache->Store("img", &Key, aInfo, pBuffer, Png.width * Png.height * Png.bpp); // ignore_convention
+	}
 	return 1;
 }
 
@@ -500,6 +667,7 @@ void CGraphics_Threaded::ScreenshotDirect(const char *pFilename)
 
 	CCommandBuffer::SCommand_Screenshot Cmd;
 	Cmd.m_pImage = &Image;
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 
 	// kick the buffer and wait for the result
@@ -541,6 +709,7 @@ void CGraphics_Threaded::Clear(float r, float g, float b)
 	Cmd.m_Color.g = g;
 	Cmd.m_Color.b = b;
 	Cmd.m_Color.a = 0;
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 }
 
@@ -694,6 +863,59 @@ void CGraphics_Threaded::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
 	AddVertices(4*Num);
 }
 
+void CGraphics_Threaded::QuadsDrawTextured(const CTexturedQuadItem *pArray, int Num)
+{
+	CCommandBuffer::SPoint Center;
+	Center.z = 0;
+
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawTextured without begin");
+
+	while(Num > 0)
+	{
+		// never write past the vertex buffer, big arrays are split up
+		int Count = (MAX_VERTICES - m_NumVertices)/4;
+		if(Count <= 0)
+		{
+			FlushVertices();
+			continue;
+		}
+		if(Count > Num)
+			Count = Num;
+
+		for(int i = 0; i < Count; ++i)
+		{
+			const CTexturedQuadItem *pItem = &pArray[i];
+			for(int v = 0; v < 4; v++)
+			{
+				m_aVertices[m_NumVertices + 4*i + v].m_Tex.u = pItem->m_aU[v];
+				m_aVertices[m_NumVertices + 4*i + v].m_Tex.v = pItem->m_aV[v];
+				m_aVertices[m_NumVertices + 4*i + v].m_Color = m_aColor[v];
+			}
+
+			m_aVertices[m_NumVertices + 4*i].m_Pos.x = pItem->m_X;
+			m_aVertices[m_NumVertices + 4*i].m_Pos.y = pItem->m_Y;
+			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.x = pItem->m_X + pItem->m_Width;
+			m_aVertices[m_NumVertices + 4*i + 1].m_Pos.y = pItem->m_Y;
+			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.x = pItem->m_X + pItem->m_Width;
+			m_aVertices[m_NumVertices + 4*i + 2].m_Pos.y = pItem->m_Y + pItem->m_Height;
+			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.x = pItem->m_X;
+			m_aVertices[m_NumVertices + 4*i + 3].m_Pos.y = pItem->m_Y + pItem->m_Height;
+
+			if(m_Rotation != 0)
+			{
+				Center.x = pItem->m_X + pItem->m_Width/2;
+				Center.y = pItem->m_Y + pItem->m_Height/2;
+
+				Rotate4(Center, &m_aVertices[m_NumVertices + 4*i]);
+			}
+		}
+
+		AddVertices(4*Count);
+		pArray += Count;
+		Num -= Count;
+	}
+}
+
 void CGraphics_Threaded::QuadsText(float x, float y, float Size, float r, float g, float b, float a, const char *pText)
 {
 	float StartX = x;
@@ -777,6 +999,7 @@ int CGraphics_Threaded::Init()
 {
 	// fetch pointers
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
+	m_pAssetCache = Kernel()->RequestInterface<IAssetCache>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 
 	// Set all z to -5.0f
@@ -789,7 +1012,10 @@ int CGraphics_Threaded::Init()
 		m_aTextures[i].m_Next = i+1;
 	m_aTextures[MAX_TEXTURES-1].m_Next = -1;
 
-	m_pBackend = CreateGraphicsBackend();
+	if(g_Config.m_GfxNull)
+		m_pBackend = CreateGraphicsBackendNull();
+	else
+		m_pBackend = CreateGraphicsBackend();
 	if(InitWindow() != 0)
 		return -1;
 
@@ -869,10 +1095,16 @@ void CGraphics_Threaded::Swap()
 	// add swap command
 	CCommandBuffer::SCommand_Swap Cmd;
 	Cmd.m_Finish = g_Config.m_GfxFinish;
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 
 	// kick the command buffer
 	KickCommandBuffer();
+
+	m_LastDrawCalls = m_DrawCalls;
+	m_LastDrawsRequested = m_DrawsRequested;
+	m_DrawCalls = 0;
+	m_DrawsRequested = 0;
 }
 
 // syncronization
@@ -880,6 +1112,7 @@ void CGraphics_Threaded::InsertSignal(semaphore *pSemaphore)
 {
 	CCommandBuffer::SCommand_Signal Cmd;
 	Cmd.m_pSemaphore = pSemaphore;
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 }
 
@@ -913,6 +1146,7 @@ int CGraphics_Threaded::GetVideoModes(CVideoMode *pModes, int MaxModes)
 	Cmd.m_pModes = pModes;
 	Cmd.m_MaxModes = MaxModes;
 	Cmd.m_pNumModes = &NumModes;
+	SubmitBatch();
 	m_pCommandBuffer->AddCommand(Cmd);
 
 	// kick the buffer and wait for the result and return it
@@ -921,4 +1155,10 @@ int CGraphics_Threaded::GetVideoModes(CVideoMode *pModes, int MaxModes)
 	return NumModes;
 }
 
+void CGraphics_Threaded::GetDrawStats(int *pDrawCalls, int *pDrawsRequested)
+{
+	*pDrawCalls = m_LastDrawCalls;
+	*pDrawsRequested = m_LastDrawsRequested;
+}
+
 extern IEngineGraphics *CreateEngineGraphicsThreaded() { return new CGraphics_Threaded(); }
@@ -323,11 +323,35 @@ class CGraphics_Threaded : public IEngineGraphics
 
 		MAX_VERTICES = 32*1024,
 		MAX_TEXTURES = 1024*4,
+
+		// deferred draw batching
+		MAX_BATCH_VERTICES = 64*1024,
+		MAX_BATCH_DRAWS = 1024,
+		MAX_BATCH_SEGMENTS = 4096,
+		BATCH_SEARCH_DEPTH = 32,
 		
 		DRAWING_QUADS=1,
 		DRAWING_LINES=2
 	};
 
+	// a draw waiting to be submitted, its vertices are a list of segments in the batch buffer
+	struct CBatchDraw
+	{
+		CCommandBuffer::SState m_State;
+		unsigned m_PrimType;
+		int m_NumVertices;
+		int m_FirstSegment;
+		int m_LastSegment;
+		float m_aBox[4]; // normalized screen space bounds
+	};
+
+	struct CBatchSegment
+	{
+		int m_Offset;
+		int m_Count;
+		int m_Next;
+	};
+
 	CCommandBuffer::SState m_State;
 	IGraphicsBackend *m_pBackend;
 
@@ -337,11 +361,25 @@ class CGraphics_Threaded : public IEngineGraphics
 
 	//
 	class IStorage *m_pStorage;
+	class IAssetCache *m_pAssetCache;
 	class IConsole *m_pConsole;
 
 	CCommandBuffer::SVertex m_aVertices[MAX_VERTICES];
 	int m_NumVertices;
 
+	CCommandBuffer::SVertex m_aBatchVertices[MAX_BATCH_VERTICES];
+	int m_NumBatchVertices;
+	CBatchDraw m_aBatchDraws[MAX_BATCH_DRAWS];
+	int m_NumBatchDraws;
+	CBatchSegment m_aBatchSegments[MAX_BATCH_SEGMENTS];
+	int m_NumBatchSegments;
+
+	// draw statistics, requested draws are the flushes before batching
+	int m_DrawCalls;
+	int m_DrawsRequested;
+	int m_LastDrawCalls;
+	int m_LastDrawsRequested;
+
 	CCommandBuffer::SColor m_aColor[4];
 	CCommandBuffer::STexCoord m_aTexture[4];
 
@@ -368,6 +406,11 @@ class CGraphics_Threaded : public IEngineGraphics
 
 	void FlushVertices();
 	void AddVertices(int Count);
+	CCommandBuffer::SVertex *AllocRenderCommand(const CCommandBuffer::SState &State, unsigned PrimType, int NumVerts);
+
+	static bool StatesEqual(const CCommandBuffer::SState &a, const CCommandBuffer::SState &b);
+	void BatchVertices(unsigned PrimType, int NumVerts);
+	void SubmitBatch();
 	void Rotate4(const CCommandBuffer::SPoint &rCenter, CCommandBuffer::SVertex *pPoints);
 
 	static unsigned char Sample(int w, int h, const unsigned char *pData, int u, int v, int Offset, int ScaleW, int ScaleH, int Bpp);
@@ -428,6 +471,7 @@ public:
 	virtual void QuadsDraw(CQuadItem *pArray, int Num);
 	virtual void QuadsDrawTL(const CQuadItem *pArray, int Num);
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
+	virtual void QuadsDrawTextured(const CTexturedQuadItem *pArray, int Num);
 	virtual void QuadsText(float x, float y, float Size, float r, float g, float b, float a, const char *pText);
 
 	virtual void Minimize();
@@ -443,6 +487,7 @@ public:
 	virtual void Swap();
 
 	virtual int GetVideoModes(CVideoMode *pModes, int MaxModes);
+	virtual void GetDrawStats(int *pDrawCalls, int *pDrawsRequested);
 
 	// syncronization
 	virtual void InsertSignal(semaphore *pSemaphore);
@@ -451,3 +496,4 @@ public:
 };
 
 extern IGraphicsBackend *CreateGraphicsBackend();
+extern IGraphicsBackend *CreateGraphicsBackendNull();
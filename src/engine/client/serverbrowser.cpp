@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <algorithm> // sort  TODO: remove this
+#include <ctype.h> // tolower
 
 #include <base/math.h>
 #include <base/system.h>
@@ -14,11 +15,48 @@
 #include <engine/console.h>
 #include <engine/friends.h>
 #include <engine/masterserver.h>
+#include <engine/storage.h>
 
 #include <mastersrv/mastersrv.h>
 
 #include "serverbrowser.h"
 
+// on disk layout of the server list cache
+struct CServerlistCacheHeader
+{
+	char m_aID[4];
+	int m_Version;
+	int m_EntrySize;
+	int m_ClientSize;
+	int m_NumEntries;
+};
+
+struct CServerlistCacheEntry
+{
+	NETADDR m_Addr;
+	int m_MaxClients;
+	int m_NumClients;
+	int m_MaxPlayers;
+	int m_NumPlayers;
+	int m_Flags;
+	int m_Latency;
+	char m_aGameType[16];
+	char m_aName[64];
+	char m_aMap[32];
+	char m_aVersion[32];
+};
+
+struct CServerlistCacheClient
+{
+	char m_aName[MAX_NAME_LENGTH];
+	char m_aClan[MAX_CLAN_LENGTH];
+	int m_Country;
+	int m_Score;
+	int m_Player;
+};
+
+static const char *s_pServerlistCacheFile = "cache/serverlist.bin";
+
 class SortWrap
 {
 	typedef bool (CServerBrowser::*SortFunc)(int, int) const;
@@ -43,6 +81,17 @@ CServerBrowser::CServerBrowser()
 	m_pLastReqServer = 0;
 	m_NumRequests = 0;
 
+	m_RequestRate = REQUEST_RATE_START;
+	m_RequestBudget = 0;
+	m_LastRequestUpdate = 0;
+	m_NumAnsweredFirstTry = 0;
+	m_NumLostRequests = 0;
+
+	m_VisibleFirst = 0;
+	m_VisibleNum = 0;
+
+	m_CacheDirty = false;
+
 	m_NeedRefresh = 0;
 
 	m_NumSortedServers = 0;
@@ -53,6 +102,8 @@ CServerBrowser::CServerBrowser()
 	m_Sorthash = 0;
 	m_aFilterString[0] = 0;
 	m_aFilterGametypeString[0] = 0;
+	m_aSearchMaskString[0] = 0;
+	mem_zero(m_aSearchMask, sizeof(m_aSearchMask));
 
 	// the token is to keep server refresh separated from each other
 	m_CurrentToken = 1;
@@ -68,6 +119,7 @@ void CServerBrowser::SetBaseInfo(class CNetClient *pClient, const char *pNetVers
 	m_pMasterServer = Kernel()->RequestInterface<IMasterServer>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 	m_pFriends = Kernel()->RequestInterface<IFriends>();
+	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	IConfig *pConfig = Kernel()->RequestInterface<IConfig>();
 	if(pConfig)
 		pConfig->RegisterCallback(ConfigSaveCallback, this);
@@ -125,134 +177,164 @@ bool CServerBrowser::SortCompareNumClients(int Index1, int Index2) const
 	return a->m_Info.m_NumClients < b->m_Info.m_NumClients;
 }
 
-void CServerBrowser::Filter()
+bool CServerBrowser::FilterEntry(CServerEntry *pEntry)
 {
-	int i = 0, p = 0;
-	m_NumSortedServers = 0;
-
-	// allocate the sorted list
-	if(m_NumSortedServersCapacity < m_NumServers)
+	int p = 0;
+	int Filtered = 0;
+
+	if(g_Config.m_BrFilterEmpty && ((g_Config.m_BrFilterSpectators && pEntry->m_Info.m_NumPlayers == 0) || pEntry->m_Info.m_NumClients == 0))
+		Filtered = 1;
+	else if(g_Config.m_BrFilterFull && ((g_Config.m_BrFilterSpectators && pEntry->m_Info.m_NumPlayers == pEntry->m_Info.m_MaxPlayers) ||
+			pEntry->m_Info.m_NumClients == pEntry->m_Info.m_MaxClients))
+		Filtered = 1;
+	else if(g_Config.m_BrFilterPw && pEntry->m_Info.m_Flags&SERVER_FLAG_PASSWORD)
+		Filtered = 1;
+	else if(g_Config.m_BrFilterPure &&
+		(str_comp(pEntry->m_Info.m_aGameType, "DM") != 0 &&
+		str_comp(pEntry->m_Info.m_aGameType, "TDM") != 0 &&
+		str_comp(pEntry->m_Info.m_aGameType, "CTF") != 0))
 	{
-		if(m_pSortedServerlist)
-			mem_free(m_pSortedServerlist);
-		m_NumSortedServersCapacity = m_NumServers;
-		m_pSortedServerlist = (int *)mem_alloc(m_NumSortedServersCapacity*sizeof(int), 1);
+		Filtered = 1;
 	}
-
-	// filter the servers
-	for(i = 0; i < m_NumServers; i++)
+	else if(g_Config.m_BrFilterPureMap &&
+		!(str_comp(pEntry->m_Info.m_aMap, "dm1") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "dm2") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "dm6") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "dm7") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "dm8") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "dm9") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf1") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf2") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf3") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf4") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf5") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf6") == 0 ||
+		str_comp(pEntry->m_Info.m_aMap, "ctf7") == 0)
+	)
 	{
-		int Filtered = 0;
-
-		if(g_Config.m_BrFilterEmpty && ((g_Config.m_BrFilterSpectators && m_ppServerlist[i]->m_Info.m_NumPlayers == 0) || m_ppServerlist[i]->m_Info.m_NumClients == 0))
-			Filtered = 1;
-		else if(g_Config.m_BrFilterFull && ((g_Config.m_BrFilterSpectators && m_ppServerlist[i]->m_Info.m_NumPlayers == m_ppServerlist[i]->m_Info.m_MaxPlayers) ||
-				m_ppServerlist[i]->m_Info.m_NumClients == m_ppServerlist[i]->m_Info.m_MaxClients))
-			Filtered = 1;
-		else if(g_Config.m_BrFilterPw && m_ppServerlist[i]->m_Info.m_Flags&SERVER_FLAG_PASSWORD)
-			Filtered = 1;
-		else if(g_Config.m_BrFilterPure &&
-			(str_comp(m_ppServerlist[i]->m_Info.m_aGameType, "DM") != 0 &&
-			str_comp(m_ppServerlist[i]->m_Info.m_aGameType, "TDM") != 0 &&
-			str_comp(m_ppServerlist[i]->m_Info.m_aGameType, "CTF") != 0))
-		{
-			Filtered = 1;
-		}
-		else if(g_Config.m_BrFilterPureMap &&
-			!(str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm1") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm2") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm6") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm7") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm8") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm9") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf1") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf2") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf3") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf4") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf5") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf6") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf7") == 0)
-		)
+		Filtered = 1;
+	}
+	else if(g_Config.m_BrFilterPing < pEntry->m_Info.m_Latency)
+		Filtered = 1;
+	else if(g_Config.m_BrFilterCompatversion && str_comp_num(pEntry->m_Info.m_aVersion, m_aNetVersion, 3) != 0)
+		Filtered = 1;
+	else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(pEntry->m_Info.m_aAddress, g_Config.m_BrFilterServerAddress))
+		Filtered = 1;
+	else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(pEntry->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
+		Filtered = 1;
+	else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_find_nocase(pEntry->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
+		Filtered = 1;
+	else
+	{
+		if(g_Config.m_BrFilterCountry)
 		{
 			Filtered = 1;
+			// match against player country
+			for(p = 0; p < pEntry->m_Info.m_NumClients; p++)
+			{
+				if(pEntry->m_Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
+				{
+					Filtered = 0;
+					break;
+				}
+			}
 		}
-		else if(g_Config.m_BrFilterPing < m_ppServerlist[i]->m_Info.m_Latency)
-			Filtered = 1;
-		else if(g_Config.m_BrFilterCompatversion && str_comp_num(m_ppServerlist[i]->m_Info.m_aVersion, m_aNetVersion, 3) != 0)
-			Filtered = 1;
-		else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(m_ppServerlist[i]->m_Info.m_aAddress, g_Config.m_BrFilterServerAddress))
-			Filtered = 1;
-		else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(m_ppServerlist[i]->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = 1;
-		else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_find_nocase(m_ppServerlist[i]->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = 1;
-		else
+
+		if(!Filtered && g_Config.m_BrFilterString[0] != 0)
 		{
-			if(g_Config.m_BrFilterCountry)
+			int MatchFound = 0;
+
+			pEntry->m_Info.m_QuickSearchHit = 0;
+
+			// the trigram index rules out most entries without looking at the strings
+			bool MayMatch = true;
+			for(int w = 0; w < SEARCH_INDEX_BITS/32; w++)
 			{
-				Filtered = 1;
-				// match against player country
-				for(p = 0; p < m_ppServerlist[i]->m_Info.m_NumClients; p++)
+				if((pEntry->m_aSearchIndex[w]&m_aSearchMask[w]) != m_aSearchMask[w])
 				{
-					if(m_ppServerlist[i]->m_Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
-					{
-						Filtered = 0;
-						break;
-					}
+					MayMatch = false;
+					break;
 				}
 			}
 
-			if(!Filtered && g_Config.m_BrFilterString[0] != 0)
+			if(MayMatch)
 			{
-				int MatchFound = 0;
-
-				m_ppServerlist[i]->m_Info.m_QuickSearchHit = 0;
-
 				// match against server name
-				if(str_find_nocase(m_ppServerlist[i]->m_Info.m_aName, g_Config.m_BrFilterString))
+				if(str_find_nocase(pEntry->m_Info.m_aName, g_Config.m_BrFilterString))
 				{
 					MatchFound = 1;
-					m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
+					pEntry->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
 				}
 
 				// match against players
-				for(p = 0; p < m_ppServerlist[i]->m_Info.m_NumClients; p++)
+				for(p = 0; p < pEntry->m_Info.m_NumClients; p++)
 				{
-					if(str_find_nocase(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName, g_Config.m_BrFilterString) ||
-						str_find_nocase(m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan, g_Config.m_BrFilterString))
+					if(str_find_nocase(pEntry->m_Info.m_aClients[p].m_aName, g_Config.m_BrFilterString) ||
+						str_find_nocase(pEntry->m_Info.m_aClients[p].m_aClan, g_Config.m_BrFilterString))
 					{
 						MatchFound = 1;
-						m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
+						pEntry->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
 						break;
 					}
 				}
 
 				// match against map
-				if(str_find_nocase(m_ppServerlist[i]->m_Info.m_aMap, g_Config.m_BrFilterString))
+				if(str_find_nocase(pEntry->m_Info.m_aMap, g_Config.m_BrFilterString))
 				{
 					MatchFound = 1;
-					m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
+					pEntry->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
 				}
-
-				if(!MatchFound)
-					Filtered = 1;
 			}
+
+			if(!MatchFound)
+				Filtered = 1;
 		}
+	}
 
-		if(Filtered == 0)
+	if(Filtered == 0)
+	{
+		// check for friend
+		pEntry->m_Info.m_FriendState = IFriends::FRIEND_NO;
+		for(p = 0; p < pEntry->m_Info.m_NumClients; p++)
 		{
-			// check for friend
-			m_ppServerlist[i]->m_Info.m_FriendState = IFriends::FRIEND_NO;
-			for(p = 0; p < m_ppServerlist[i]->m_Info.m_NumClients; p++)
-			{
-				m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState = m_pFriends->GetFriendState(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName,
-					m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan);
-				m_ppServerlist[i]->m_Info.m_FriendState = max(m_ppServerlist[i]->m_Info.m_FriendState, m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState);
-			}
-
-			if(!g_Config.m_BrFilterFriends || m_ppServerlist[i]->m_Info.m_FriendState != IFriends::FRIEND_NO)
-				m_pSortedServerlist[m_NumSortedServers++] = i;
+			pEntry->m_Info.m_aClients[p].m_FriendState = m_pFriends->GetFriendState(pEntry->m_Info.m_aClients[p].m_aName,
+				pEntry->m_Info.m_aClients[p].m_aClan);
+			pEntry->m_Info.m_FriendState = max(pEntry->m_Info.m_FriendState, pEntry->m_Info.m_aClients[p].m_FriendState);
 		}
+
+		return !g_Config.m_BrFilterFriends || pEntry->m_Info.m_FriendState != IFriends::FRIEND_NO;
+	}
+
+	return false;
+}
+
+void CServerBrowser::ReserveSorted()
+{
+	if(m_NumSortedServersCapacity >= m_NumServers)
+		return;
+
+	int *pNewList = (int *)mem_alloc(m_NumServerCapacity*sizeof(int), 1);
+	if(m_pSortedServerlist)
+	{
+		mem_copy(pNewList, m_pSortedServerlist, m_NumSortedServers*sizeof(int));
+		mem_free(m_pSortedServerlist);
+	}
+	m_pSortedServerlist = pNewList;
+	m_NumSortedServersCapacity = m_NumServerCapacity;
+}
+
+void CServerBrowser::Filter()
+{
+	m_NumSortedServers = 0;
+	ReserveSorted();
+	UpdateSearchMask();
+
+	// filter the servers
+	for(int i = 0; i < m_NumServers; i++)
+	{
+		m_ppServerlist[i]->m_Info.m_SortedIndex = -1;
+		if(FilterEntry(m_ppServerlist[i]))
+			m_pSortedServerlist[m_NumSortedServers++] = i;
 	}
 }
 
@@ -274,6 +356,37 @@ int CServerBrowser::SortHash() const
 	return i;
 }
 
+CServerBrowser::SORTFUNC CServerBrowser::GetSortFunc() const
+{
+	if(g_Config.m_BrSort == IServerBrowser::SORT_NAME)
+		return &CServerBrowser::SortCompareName;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
+		return &CServerBrowser::SortComparePing;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
+		return &CServerBrowser::SortCompareMap;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
+		return g_Config.m_BrFilterSpectators ? &CServerBrowser::SortCompareNumPlayers : &CServerBrowser::SortCompareNumClients;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
+		return &CServerBrowser::SortCompareGametype;
+	return 0;
+}
+
+// the order stable_sort produces on the filtered list: equal entries stay in server list order
+bool CServerBrowser::SortBefore(int Index1, int Index2) const
+{
+	SORTFUNC pfnSort = GetSortFunc();
+	if(pfnSort)
+	{
+		bool Less = g_Config.m_BrSortOrder ? (this->*pfnSort)(Index2, Index1) : (this->*pfnSort)(Index1, Index2);
+		if(Less)
+			return true;
+		bool Greater = g_Config.m_BrSortOrder ? (this->*pfnSort)(Index1, Index2) : (this->*pfnSort)(Index2, Index1);
+		if(Greater)
+			return false;
+	}
+	return Index1 < Index2;
+}
+
 void CServerBrowser::Sort()
 {
 	int i;
@@ -282,17 +395,9 @@ void CServerBrowser::Sort()
 	Filter();
 
 	// sort
-	if(g_Config.m_BrSort == IServerBrowser::SORT_NAME)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortCompareName));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortComparePing));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortCompareMap));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this,
-					g_Config.m_BrFilterSpectators ? &CServerBrowser::SortCompareNumPlayers : &CServerBrowser::SortCompareNumClients));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortCompareGametype));
+	SORTFUNC pfnSort = GetSortFunc();
+	if(pfnSort)
+		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, pfnSort));
 
 	// set indexes
 	for(i = 0; i < m_NumSortedServers; i++)
@@ -303,9 +408,93 @@ void CServerBrowser::Sort()
 	m_Sorthash = SortHash();
 }
 
+// re-filters a single entry and moves it to its place in the sorted list
+void CServerBrowser::UpdateEntry(CServerEntry *pEntry)
+{
+	// with changed filters or sorting the whole list has to be rebuilt
+	if(m_Sorthash != SortHash() || str_comp(m_aFilterString, g_Config.m_BrFilterString) != 0 ||
+		str_comp(m_aFilterGametypeString, g_Config.m_BrFilterGametype) != 0)
+	{
+		Sort();
+		return;
+	}
+
+	ReserveSorted();
+
+	int ServerIndex = pEntry->m_Info.m_ServerIndex;
+	int First = m_NumSortedServers;
+
+	// take it out
+	int OldIndex = pEntry->m_Info.m_SortedIndex;
+	if(OldIndex >= 0 && OldIndex < m_NumSortedServers && m_pSortedServerlist[OldIndex] == ServerIndex)
+	{
+		mem_move(&m_pSortedServerlist[OldIndex], &m_pSortedServerlist[OldIndex+1], (m_NumSortedServers-OldIndex-1)*sizeof(int));
+		m_NumSortedServers--;
+		First = OldIndex;
+	}
+	pEntry->m_Info.m_SortedIndex = -1;
+
+	// and insert it again if it still passes the filter
+	if(FilterEntry(pEntry))
+	{
+		int Low = 0;
+		int High = m_NumSortedServers;
+		while(Low < High)
+		{
+			int Mid = (Low+High)/2;
+			if(SortBefore(m_pSortedServerlist[Mid], ServerIndex))
+				Low = Mid+1;
+			else
+				High = Mid;
+		}
+
+		mem_move(&m_pSortedServerlist[Low+1], &m_pSortedServerlist[Low], (m_NumSortedServers-Low)*sizeof(int));
+		m_pSortedServerlist[Low] = ServerIndex;
+		m_NumSortedServers++;
+		First = min(First, Low);
+	}
+
+	// fix the indexes of everything that moved
+	for(int i = First; i < m_NumSortedServers; i++)
+		m_ppServerlist[m_pSortedServerlist[i]]->m_Info.m_SortedIndex = i;
+}
+
+void CServerBrowser::AddTrigrams(unsigned *pIndex, const char *pStr)
+{
+	// lowercased the same way as str_find_nocase
+	for(; pStr[0] && pStr[1] && pStr[2]; pStr++)
+	{
+		unsigned Trigram = ((unsigned char)tolower(pStr[0])<<16) | ((unsigned char)tolower(pStr[1])<<8) | (unsigned char)tolower(pStr[2]);
+		unsigned Bit = (Trigram*2654435761u)>>22; // top 10 bits
+		pIndex[Bit>>5] |= 1u<<(Bit&31);
+	}
+}
+
+void CServerBrowser::BuildSearchIndex(CServerEntry *pEntry)
+{
+	mem_zero(pEntry->m_aSearchIndex, sizeof(pEntry->m_aSearchIndex));
+	AddTrigrams(pEntry->m_aSearchIndex, pEntry->m_Info.m_aName);
+	AddTrigrams(pEntry->m_aSearchIndex, pEntry->m_Info.m_aMap);
+	for(int i = 0; i < pEntry->m_Info.m_NumClients; i++)
+	{
+		AddTrigrams(pEntry->m_aSearchIndex, pEntry->m_Info.m_aClients[i].m_aName);
+		AddTrigrams(pEntry->m_aSearchIndex, pEntry->m_Info.m_aClients[i].m_aClan);
+	}
+}
+
+void CServerBrowser::UpdateSearchMask()
+{
+	if(str_comp(m_aSearchMaskString, g_Config.m_BrFilterString) == 0)
+		return;
+
+	str_copy(m_aSearchMaskString, g_Config.m_BrFilterString, sizeof(m_aSearchMaskString));
+	mem_zero(m_aSearchMask, sizeof(m_aSearchMask));
+	AddTrigrams(m_aSearchMask, m_aSearchMaskString);
+}
+
 void CServerBrowser::RemoveRequest(CServerEntry *pEntry)
 {
-	if(pEntry->m_pPrevReq || pEntry->m_pNextReq || m_pFirstReqServer == pEntry)
+	if(IsQueued(pEntry))
 	{
 		if(pEntry->m_pPrevReq)
 			pEntry->m_pPrevReq->m_pNextReq = pEntry->m_pNextReq;
@@ -344,6 +533,9 @@ void CServerBrowser::QueueRequest(CServerEntry *pEntry)
 	else
 		m_pFirstReqServer = pEntry;
 	m_pLastReqServer = pEntry;
+	pEntry->m_RequestTime = 0;
+	pEntry->m_FirstRequestTime = 0;
+	pEntry->m_NumTries = 0;
 
 	m_NumRequests++;
 }
@@ -351,8 +543,12 @@ void CServerBrowser::QueueRequest(CServerEntry *pEntry)
 void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 {
 	int Fav = pEntry->m_Info.m_Favorite;
+	int ServerIndex = pEntry->m_Info.m_ServerIndex;
+	int SortedIndex = pEntry->m_Info.m_SortedIndex;
 	pEntry->m_Info = Info;
 	pEntry->m_Info.m_Favorite = Fav;
+	pEntry->m_Info.m_ServerIndex = ServerIndex;
+	pEntry->m_Info.m_SortedIndex = SortedIndex;
 	pEntry->m_Info.m_NetAddr = pEntry->m_Addr;
 
 	// all these are just for nice compability
@@ -370,6 +566,27 @@ void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 	}*/
 
 	pEntry->m_GotInfo = 1;
+	BuildSearchIndex(pEntry);
+}
+
+void CServerBrowser::ClearInfo(CServerEntry *pEntry)
+{
+	int Fav = pEntry->m_Info.m_Favorite;
+	int ServerIndex = pEntry->m_Info.m_ServerIndex;
+	int SortedIndex = pEntry->m_Info.m_SortedIndex;
+	mem_zero(&pEntry->m_Info, sizeof(pEntry->m_Info));
+	pEntry->m_Info.m_Favorite = Fav;
+	pEntry->m_Info.m_ServerIndex = ServerIndex;
+	pEntry->m_Info.m_SortedIndex = SortedIndex;
+	pEntry->m_Info.m_NetAddr = pEntry->m_Addr;
+
+	pEntry->m_Info.m_Latency = 999;
+	net_addr_str(&pEntry->m_Addr, pEntry->m_Info.m_aAddress, sizeof(pEntry->m_Info.m_aAddress), true);
+	str_copy(pEntry->m_Info.m_aName, pEntry->m_Info.m_aAddress, sizeof(pEntry->m_Info.m_aName));
+
+	pEntry->m_GotInfo = 0;
+	pEntry->m_CachedInfo = 0;
+	BuildSearchIndex(pEntry);
 }
 
 CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR &Addr)
@@ -384,11 +601,8 @@ CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR &Addr)
 
 	// set the info
 	pEntry->m_Addr = Addr;
-	pEntry->m_Info.m_NetAddr = Addr;
-
-	pEntry->m_Info.m_Latency = 999;
-	net_addr_str(&Addr, pEntry->m_Info.m_aAddress, sizeof(pEntry->m_Info.m_aAddress), true);
-	str_copy(pEntry->m_Info.m_aName, pEntry->m_Info.m_aAddress, sizeof(pEntry->m_Info.m_aName));
+	pEntry->m_Info.m_SortedIndex = -1;
+	ClearInfo(pEntry);
 
 	// check if it's a favorite
 	for(i = 0; i < m_NumFavoriteServers; i++)
@@ -446,24 +660,48 @@ void CServerBrowser::Set(const NETADDR &Addr, int Type, int Token, const CServer
 	}
 	else if(Type == IServerBrowser::SET_TOKEN)
 	{
-		if(Token != m_CurrentToken)
+		if((Token&~TOKEN_RETRY) != m_CurrentToken)
 			return;
+		bool Retry = (Token&TOKEN_RETRY) != 0;
 
 		pEntry = Find(Addr);
 		if(!pEntry)
 			pEntry = Add(Addr);
 		if(pEntry)
 		{
-			SetInfo(pEntry, *pInfo);
+			// every try before the answered one got lost, an answer to the first
+			// try that comes in after the retry was only late
+			if(IsQueued(pEntry))
+			{
+				if(Retry)
+					m_NumLostRequests += pEntry->m_NumTries-1;
+				else
+					m_NumAnsweredFirstTry++;
+			}
+
+			int Latency = pEntry->m_Info.m_Latency;
 			if(m_ServerlistType == IServerBrowser::TYPE_LAN)
-				pEntry->m_Info.m_Latency = min(static_cast<int>((time_get()-m_BroadcastTime)*1000/time_freq()), 999);
-			else
-				pEntry->m_Info.m_Latency = min(static_cast<int>((time_get()-pEntry->m_RequestTime)*1000/time_freq()), 999);
+				Latency = min(static_cast<int>((time_get()-m_BroadcastTime)*1000/time_freq()), 999);
+			else if(Retry || IsQueued(pEntry) || pEntry->m_NumTries < 2)
+			{
+				// a late answer to the first try is measured from its own send time,
+				// once the retry got answered it is left out
+				int64 RequestTime = Retry ? pEntry->m_RequestTime : pEntry->m_FirstRequestTime;
+				Latency = min(static_cast<int>((time_get()-RequestTime)*1000/time_freq()), 999);
+			}
+
+			SetInfo(pEntry, *pInfo);
+			pEntry->m_Info.m_Latency = Latency;
+			pEntry->m_CachedInfo = 0;
 			RemoveRequest(pEntry);
+
+			if(m_ServerlistType == IServerBrowser::TYPE_INTERNET)
+				m_CacheDirty = true;
 		}
 	}
 
-	Sort();
+	if(pEntry)
+		UpdateEntry(pEntry);
 }
 
 void CServerBrowser::Refresh(int Type)
@@ -477,8 +715,14 @@ void CServerBrowser::Refresh(int Type)
 	m_pLastReqServer = 0;
 	m_NumRequests = 0;
 
+	m_RequestBudget = 0;
+	m_LastRequestUpdate = time_get();
+	m_NumAnsweredFirstTry = 0;
+	m_NumLostRequests = 0;
+	m_CacheDirty = false;
+
 	// next token
-	m_CurrentToken = (m_CurrentToken+1)&0xff;
+	m_CurrentToken = (m_CurrentToken+1)&~TOKEN_RETRY&0xff;
 
 	//
 	m_ServerlistType = Type;
@@ -511,7 +755,11 @@ void CServerBrowser::Refresh(int Type)
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client_srvbrowse", "broadcasting for servers");
 	}
 	else if(Type == IServerBrowser::TYPE_INTERNET)
+	{
+		// show the servers of the last refresh right away, the masters fill in the rest
+		LoadCache();
 		m_NeedRefresh = 1;
+	}
 	else if(Type == IServerBrowser::TYPE_FAVORITES)
 	{
 		for(int i = 0; i < m_NumFavoriteServers; i++)
@@ -534,7 +782,7 @@ void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry) cons
 	}
 
 	mem_copy(Buffer, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO));
-	Buffer[sizeof(SERVERBROWSE_GETINFO)] = m_CurrentToken;
+	Buffer[sizeof(SERVERBROWSE_GETINFO)] = m_CurrentToken | (pEntry && pEntry->m_NumTries ? TOKEN_RETRY : 0);
 
 	Packet.m_ClientID = -1;
 	Packet.m_Address = Addr;
@@ -545,7 +793,11 @@ void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry) cons
 	m_pNetClient->Send(&Packet);
 
 	if(pEntry)
+	{
 		pEntry->m_RequestTime = time_get();
+		if(!pEntry->m_NumTries)
+			pEntry->m_FirstRequestTime = pEntry->m_RequestTime;
+	}
 }
 
 void CServerBrowser::Request(const NETADDR &Addr) const
@@ -554,11 +806,191 @@ void CServerBrowser::Request(const NETADDR &Addr) const
 }
 
 
+bool CServerBrowser::CanRequest(int InFlight) const
+{
+	return m_RequestBudget >= 1.0f && InFlight < g_Config.m_BrMaxRequests;
+}
+
+void CServerBrowser::SendRequest(CServerEntry *pEntry)
+{
+	RequestImpl(pEntry->m_Addr, pEntry);
+	pEntry->m_NumTries++;
+	m_RequestBudget -= 1.0f;
+}
+
+void CServerBrowser::UpdateRequestRate()
+{
+	int Total = m_NumAnsweredFirstTry+m_NumLostRequests;
+	if(Total < REQUEST_RATE_WINDOW)
+		return;
+
+	// servers that never answer are not counted, only requests that needed a retry
+	float Loss = m_NumLostRequests/(float)Total;
+	if(Loss > 0.1f)
+		m_RequestRate = max(m_RequestRate*0.7f, (float)REQUEST_RATE_MIN);
+	else if(Loss < 0.02f)
+		m_RequestRate = min(m_RequestRate*1.2f, (float)REQUEST_RATE_MAX);
+
+	if(g_Config.m_Debug)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "request loss %.1f%%, rate %.0f/s", Loss*100.0f, m_RequestRate);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client_srvbrowse", aBuf);
+	}
+
+	m_NumAnsweredFirstTry = 0;
+	m_NumLostRequests = 0;
+}
+
+void CServerBrowser::LoadCache()
+{
+	if(!m_pStorage)
+		return;
+
+	IOHANDLE File = m_pStorage->OpenFile(s_pServerlistCacheFile, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	CServerlistCacheHeader Header;
+	if(io_read(File, &Header, sizeof(Header)) != sizeof(Header) || mem_comp(Header.m_aID, "TWSL", 4) != 0 ||
+		Header.m_Version != CACHE_VERSION || Header.m_EntrySize != (int)sizeof(CServerlistCacheEntry) ||
+		Header.m_ClientSize != (int)sizeof(CServerlistCacheClient))
+	{
+		io_close(File);
+		return;
+	}
+
+	int NumLoaded = 0;
+	CServerInfo Info;
+	for(int i = 0; i < Header.m_NumEntries; i++)
+	{
+		CServerlistCacheEntry Entry;
+		if(io_read(File, &Entry, sizeof(Entry)) != sizeof(Entry) || Entry.m_NumClients < 0 || Entry.m_NumClients > MAX_CLIENTS)
+			break;
+
+		mem_zero(&Info, sizeof(Info));
+		Info.m_MaxClients = Entry.m_MaxClients;
+		Info.m_NumClients = Entry.m_NumClients;
+		Info.m_MaxPlayers = Entry.m_MaxPlayers;
+		Info.m_NumPlayers = Entry.m_NumPlayers;
+		Info.m_Flags = Entry.m_Flags;
+		str_copy(Info.m_aGameType, Entry.m_aGameType, sizeof(Info.m_aGameType));
+		str_copy(Info.m_aName, Entry.m_aName, sizeof(Info.m_aName));
+		str_copy(Info.m_aMap, Entry.m_aMap, sizeof(Info.m_aMap));
+		str_copy(Info.m_aVersion, Entry.m_aVersion, sizeof(Info.m_aVersion));
+		net_addr_str(&Entry.m_Addr, Info.m_aAddress, sizeof(Info.m_aAddress), true);
+
+		bool Error = false;
+		for(int c = 0; c < Entry.m_NumClients; c++)
+		{
+			CServerlistCacheClient Client;
+			if(io_read(File, &Client, sizeof(Client)) != sizeof(Client))
+			{
+				Error = true;
+				break;
+			}
+			str_copy(Info.m_aClients[c].m_aName, Client.m_aName, sizeof(Info.m_aClients[c].m_aName));
+			str_copy(Info.m_aClients[c].m_aClan, Client.m_aClan, sizeof(Info.m_aClients[c].m_aClan));
+			Info.m_aClients[c].m_Country = Client.m_Country;
+			Info.m_aClients[c].m_Score = Client.m_Score;
+			Info.m_aClients[c].m_Player = Client.m_Player != 0;
+		}
+		if(Error)
+			break;
+
+		if(Find(Entry.m_Addr))
+			continue;
+
+		CServerEntry *pEntry = Add(Entry.m_Addr);
+		SetInfo(pEntry, Info);
+		pEntry->m_Info.m_Latency = Entry.m_Latency;
+		pEntry->m_CachedInfo = 1;
+		QueueRequest(pEntry);
+		NumLoaded++;
+	}
+	io_close(File);
+
+	Sort();
+
+	if(g_Config.m_Debug)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "loaded %d servers from the list cache", NumLoaded);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client_srvbrowse", aBuf);
+	}
+}
+
+void CServerBrowser::SaveCache()
+{
+	if(!m_pStorage)
+		return;
+
+	char aTempFile[64];
+	str_format(aTempFile, sizeof(aTempFile), "%s.tmp", s_pServerlistCacheFile);
+
+	m_pStorage->CreateFolder("cache", IStorage::TYPE_SAVE);
+	IOHANDLE File = m_pStorage->OpenFile(aTempFile, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	CServerlistCacheHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aID, "TWSL", 4);
+	Header.m_Version = CACHE_VERSION;
+	Header.m_EntrySize = sizeof(CServerlistCacheEntry);
+	Header.m_ClientSize = sizeof(CServerlistCacheClient);
+	for(int i = 0; i < m_NumServers; i++)
+	{
+		if(m_ppServerlist[i]->m_GotInfo)
+			Header.m_NumEntries++;
+	}
+	io_write(File, &Header, sizeof(Header));
+
+	for(int i = 0; i < m_NumServers; i++)
+	{
+		const CServerEntry *pEntry = m_ppServerlist[i];
+		if(!pEntry->m_GotInfo)
+			continue;
+
+		CServerlistCacheEntry Entry;
+		mem_zero(&Entry, sizeof(Entry));
+		Entry.m_Addr = pEntry->m_Addr;
+		Entry.m_MaxClients = pEntry->m_Info.m_MaxClients;
+		Entry.m_NumClients = clamp(pEntry->m_Info.m_NumClients, 0, (int)MAX_CLIENTS);
+		Entry.m_MaxPlayers = pEntry->m_Info.m_MaxPlayers;
+		Entry.m_NumPlayers = pEntry->m_Info.m_NumPlayers;
+		Entry.m_Flags = pEntry->m_Info.m_Flags;
+		Entry.m_Latency = pEntry->m_Info.m_Latency;
+		str_copy(Entry.m_aGameType, pEntry->m_Info.m_aGameType, sizeof(Entry.m_aGameType));
+		str_copy(Entry.m_aName, pEntry->m_Info.m_aName, sizeof(Entry.m_aName));
+		str_copy(Entry.m_aMap, pEntry->m_Info.m_aMap, sizeof(Entry.m_aMap));
+		str_copy(Entry.m_aVersion, pEntry->m_Info.m_aVersion, sizeof(Entry.m_aVersion));
+		io_write(File, &Entry, sizeof(Entry));
+
+		for(int c = 0; c < Entry.m_NumClients; c++)
+		{
+			CServerlistCacheClient Client;
+			mem_zero(&Client, sizeof(Client));
+			str_copy(Client.m_aName, pEntry->m_Info.m_aClients[c].m_aName, sizeof(Client.m_aName));
+			str_copy(Client.m_aClan, pEntry->m_Info.m_aClients[c].m_aClan, sizeof(Client.m_aClan));
+			Client.m_Country = pEntry->m_Info.m_aClients[c].m_Country;
+			Client.m_Score = pEntry->m_Info.m_aClients[c].m_Score;
+			Client.m_Player = pEntry->m_Info.m_aClients[c].m_Player;
+			io_write(File, &Client, sizeof(Client));
+		}
+	}
+	io_close(File);
+
+	// replace the old list
+	m_pStorage->RemoveFile(s_pServerlistCacheFile, IStorage::TYPE_SAVE);
+	if(!m_pStorage->RenameFile(aTempFile, s_pServerlistCacheFile, IStorage::TYPE_SAVE))
+		m_pStorage->RemoveFile(aTempFile, IStorage::TYPE_SAVE);
+}
+
 void CServerBrowser::Update(bool ForceResort)
 {
 	int64 Timeout = time_freq();
 	int64 Now = time_get();
-	int Count;
 	CServerEntry *pEntry, *pNext;
 
 	// do server list requests
@@ -590,41 +1022,73 @@ void CServerBrowser::Update(bool ForceResort)
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client_srvbrowse", "requesting server list");
 	}
 
-	// do timeouts
+	// do timeouts, a server gets another try before it is given up
+	int InFlight = 0;
 	pEntry = m_pFirstReqServer;
-	while(1)
+	while(pEntry)
 	{
-		if(!pEntry) // no more entries
-			break;
-
 		pNext = pEntry->m_pNextReq;
 
 		if(pEntry->m_RequestTime && pEntry->m_RequestTime+Timeout < Now)
 		{
-			// timeout
-			RemoveRequest(pEntry);
+			if(pEntry->m_NumTries < MAX_REQUEST_TRIES)
+				pEntry->m_RequestTime = 0;
+			else
+			{
+				// timeout
+				RemoveRequest(pEntry);
+
+				// a cached server that doesn't answer anymore is most likely gone
+				if(pEntry->m_CachedInfo)
+				{
+					ClearInfo(pEntry);
+					UpdateEntry(pEntry);
+				}
+			}
 		}
+		else if(pEntry->m_RequestTime)
+			InFlight++;
 
 		pEntry = pNext;
 	}
 
-	// do timeouts
-	pEntry = m_pFirstReqServer;
-	Count = 0;
-	while(1)
-	{
-		if(!pEntry) // no more entries
-			break;
+	UpdateRequestRate();
 
-		// no more then 10 concurrent requests
-		if(Count == g_Config.m_BrMaxRequests)
-			break;
+	// pace the requests, allow bursts of at most 100ms worth
+	m_RequestBudget += (float)((Now-m_LastRequestUpdate)/(double)time_freq())*m_RequestRate;
+	m_RequestBudget = min(m_RequestBudget, max(m_RequestRate/10.0f, 1.0f));
+	m_LastRequestUpdate = Now;
 
-		if(pEntry->m_RequestTime == 0)
-			RequestImpl(pEntry->m_Addr, pEntry);
+	// servers on screen first
+	int VisibleEnd = min(m_VisibleFirst+m_VisibleNum, m_NumSortedServers);
+	for(int i = max(m_VisibleFirst, 0); i < VisibleEnd && CanRequest(InFlight); i++)
+	{
+		pEntry = m_ppServerlist[m_pSortedServerlist[i]];
+		if(IsQueued(pEntry) && pEntry->m_RequestTime == 0)
+		{
+			SendRequest(pEntry);
+			InFlight++;
+		}
+	}
 
-		Count++;
-		pEntry = pEntry->m_pNextReq;
+	// then favorites and after that the rest in list order
+	for(int Pass = 0; Pass < 2; Pass++)
+	{
+		for(pEntry = m_pFirstReqServer; pEntry && CanRequest(InFlight); pEntry = pEntry->m_pNextReq)
+		{
+			if(pEntry->m_RequestTime == 0 && (Pass == 1 || pEntry->m_Info.m_Favorite))
+			{
+				SendRequest(pEntry);
+				InFlight++;
+			}
+		}
+	}
+
+	// keep the list for the next start once everything is in
+	if(m_CacheDirty && m_ServerlistType == IServerBrowser::TYPE_INTERNET && !m_NeedRefresh && !m_pMasterServer->IsRefreshing() && !m_pFirstReqServer)
+	{
+		SaveCache();
+		m_CacheDirty = false;
 	}
 
 	// check if we need to resort
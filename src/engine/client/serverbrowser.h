@@ -8,14 +8,26 @@
 class CServerBrowser : public IServerBrowser
 {
 public:
+	enum
+	{
+		SEARCH_INDEX_BITS=1024,
+	};
+
 	class CServerEntry
 	{
 	public:
 		NETADDR m_Addr;
 		int64 m_RequestTime;
+		int64 m_FirstRequestTime; // a late answer to the first try is measured from here
 		int m_GotInfo;
 		CServerInfo m_Info;
 
+		// bloom filter over the lowercase trigrams of all searchable strings
+		unsigned m_aSearchIndex[SEARCH_INDEX_BITS/32];
+
+		int m_NumTries; // info requests sent since the entry got queued
+		int m_CachedInfo; // info was loaded from the list cache and is not confirmed yet
+
 		CServerEntry *m_pNextIp; // ip hashed list
 
 		CServerEntry *m_pPrevReq; // request list
@@ -24,7 +36,16 @@ public:
 
 	enum
 	{
-		MAX_FAVORITES=256
+		MAX_FAVORITES=256,
+
+		MAX_REQUEST_TRIES=2,
+		TOKEN_RETRY=0x80, // set in the token of a retry, the refresh token uses the lower bits
+		REQUEST_RATE_MIN=20, // requests per second
+		REQUEST_RATE_START=200,
+		REQUEST_RATE_MAX=1000,
+		REQUEST_RATE_WINDOW=32, // answers per rate adjustment
+
+		CACHE_VERSION=1,
 	};
 
 	CServerBrowser();
@@ -39,6 +60,7 @@ public:
 
 	int NumSortedServers() const { return m_NumSortedServers; }
 	const CServerInfo *SortedGet(int Index) const;
+	void SetVisibleRange(int First, int Num) { m_VisibleFirst = First; m_VisibleNum = Num; }
 
 	bool IsFavorite(const NETADDR &Addr) const;
 	void AddFavorite(const NETADDR &Addr);
@@ -56,6 +78,7 @@ private:
 	IMasterServer *m_pMasterServer;
 	class IConsole *m_pConsole;
 	class IFriends *m_pFriends;
+	class IStorage *m_pStorage;
 	char m_aNetVersion[128];
 
 	CHeap m_ServerlistHeap;
@@ -71,6 +94,18 @@ private:
 	CServerEntry *m_pLastReqServer;
 	int m_NumRequests;
 
+	// request pacing, the rate follows the loss seen on retried requests
+	float m_RequestRate;
+	float m_RequestBudget;
+	int64 m_LastRequestUpdate;
+	int m_NumAnsweredFirstTry;
+	int m_NumLostRequests;
+
+	int m_VisibleFirst;
+	int m_VisibleNum;
+
+	bool m_CacheDirty;
+
 	int m_NeedRefresh;
 
 	int m_NumSortedServers;
@@ -82,6 +117,10 @@ private:
 	char m_aFilterString[64];
 	char m_aFilterGametypeString[128];
 
+	// trigrams of the search string, an entry can only match if it has all of them
+	char m_aSearchMaskString[64];
+	unsigned m_aSearchMask[SEARCH_INDEX_BITS/32];
+
 	// the token is to keep server refresh separated from each other
 	int m_CurrentToken;
 
@@ -96,16 +135,35 @@ private:
 	bool SortCompareNumPlayers(int Index1, int Index2) const;
 	bool SortCompareNumClients(int Index1, int Index2) const;
 
+	typedef bool (CServerBrowser::*SORTFUNC)(int Index1, int Index2) const;
+	SORTFUNC GetSortFunc() const;
+	bool SortBefore(int Index1, int Index2) const;
+
 	//
+	static void AddTrigrams(unsigned *pIndex, const char *pStr);
+	void BuildSearchIndex(CServerEntry *pEntry);
+	void UpdateSearchMask();
+
+	bool FilterEntry(CServerEntry *pEntry);
 	void Filter();
 	void Sort();
+	void UpdateEntry(CServerEntry *pEntry);
+	void ReserveSorted();
 	int SortHash() const;
 
 	CServerEntry *Find(const NETADDR &Addr);
 	CServerEntry *Add(const NETADDR &Addr);
 
+	bool IsQueued(const CServerEntry *pEntry) const { return pEntry->m_pPrevReq || pEntry->m_pNextReq || m_pFirstReqServer == pEntry; }
 	void RemoveRequest(CServerEntry *pEntry);
 	void QueueRequest(CServerEntry *pEntry);
+	bool CanRequest(int InFlight) const;
+	void SendRequest(CServerEntry *pEntry);
+	void UpdateRequestRate();
+
+	void LoadCache();
+	void SaveCache();
+	void ClearInfo(CServerEntry *pEntry);
 
 	void RequestImpl(const NETADDR &Addr, CServerEntry *pEntry) const;
 
@@ -3,6 +3,7 @@
 #include <base/math.h>
 #include <base/system.h>
 
+#include <engine/assetcache.h>
 #include <engine/graphics.h>
 #include <engine/storage.h>
 
@@ -17,11 +18,20 @@ extern "C" { // wavpack
 }
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CONF_SOUND_SSE2 1
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+	#define CONF_SOUND_NEON 1
+	#include <arm_neon.h>
+#endif
+
 enum
 {
 	NUM_SAMPLES = 512,
 	NUM_VOICES = 64,
 	NUM_CHANNELS = 16,
+	NUM_COMMANDS = 256, // must be a power of two
 };
 
 struct CSample
@@ -49,14 +59,35 @@ struct CVoice
 	int m_Vol; // 0 - 255
 	int m_Flags;
 	int m_X, m_Y;
+
+	// gains from channel volume, panning and distance to the listener
+	int m_LVol;
+	int m_RVol;
 } ;
 
+// requests from the client to the mixer, the voices are only touched by the audio thread
+struct CSoundCommand
+{
+	enum
+	{
+		PLAY=0,
+		STOP,
+		STOP_ALL,
+		SET_CHANNEL,
+	};
+
+	int m_Type;
+	int m_ChannelID;
+	int m_SampleID;
+	int m_Flags;
+	int m_X, m_Y;
+	int m_Vol, m_Pan;
+};
+
 static CSample m_aSamples[NUM_SAMPLES] = { {0} };
 static CVoice m_aVoices[NUM_VOICES] = { {0} };
 static CChannel m_aChannels[NUM_CHANNELS] = { {255, 0} };
 
-static LOCK m_SoundLock = 0;
-
 static int m_CenterX = 0;
 static int m_CenterY = 0;
 
@@ -67,6 +98,14 @@ static int m_NextVoice = 0;
 static int *m_pMixBuffer = 0;	// buffer only used by the thread callback function
 static unsigned m_MaxFrames = 0;
 
+// serializes LoadWV, it can be called from several jobs at once
+static LOCK m_WvLock = 0;
+
+// single producer (client thread), single consumer (audio thread) queue
+static CSoundCommand m_aCommands[NUM_COMMANDS];
+static volatile int m_CommandWrite = 0;
+static volatile int m_CommandRead = 0;
+
 // TODO: there should be a faster way todo this
 static short Int2Short(int i)
 {
@@ -84,14 +123,226 @@ static int IntAbs(int i)
 	return i;
 }
 
+static bool PushCommand(const CSoundCommand *pCommand)
+{
+	int Write = m_CommandWrite;
+	int Next = (Write+1)&(NUM_COMMANDS-1);
+	while(Next == m_CommandRead)
+	{
+		// the audio thread doesn't keep up. a sound that isn't played is
+		// fine to lose, a lost stop or volume change would stick
+		if(pCommand->m_Type == CSoundCommand::PLAY)
+			return false;
+		thread_yield();
+	}
+
+	m_aCommands[Write] = *pCommand;
+	sync_barrier();
+	m_CommandWrite = Next;
+	return true;
+}
+
+static void UpdateGains(CVoice *v, int CenterX, int CenterY)
+{
+	int Rvol = v->m_pChannel->m_Vol;
+	int Lvol = v->m_pChannel->m_Vol;
+
+	// volume calculation
+	if(v->m_Flags&ISound::FLAG_POS && v->m_pChannel->m_Pan)
+	{
+		// TODO: we should respect the channel panning value
+		const int Range = 1500; // magic value, remove
+		int dx = v->m_X - CenterX;
+		int dy = v->m_Y - CenterY;
+		int Dist = (int)sqrtf((float)dx*dx+dy*dy); // float here. nasty
+		int p = IntAbs(dx);
+		if(Dist >= 0 && Dist < Range)
+		{
+			// panning
+			if(dx > 0)
+				Lvol = ((Range-p)*Lvol)/Range;
+			else
+				Rvol = ((Range-p)*Rvol)/Range;
+
+			// falloff
+			Lvol = (Lvol*(Range-Dist))/Range;
+			Rvol = (Rvol*(Range-Dist))/Range;
+		}
+		else
+		{
+			Lvol = 0;
+			Rvol = 0;
+		}
+	}
+
+	v->m_LVol = Lvol;
+	v->m_RVol = Rvol;
+}
+
+static void StopVoice(CVoice *v)
+{
+	if(v->m_Flags & ISound::FLAG_LOOP)
+		v->m_pSample->m_PausedAt = v->m_Tick;
+	else
+		v->m_pSample->m_PausedAt = 0;
+	v->m_pSample = 0;
+}
+
+static void ProcessCommands(int CenterX, int CenterY)
+{
+	while(m_CommandRead != m_CommandWrite)
+	{
+		sync_barrier();
+		const CSoundCommand *pCmd = &m_aCommands[m_CommandRead];
+
+		if(pCmd->m_Type == CSoundCommand::PLAY)
+		{
+			// search for voice
+			for(int i = 0; i < NUM_VOICES; i++)
+			{
+				int id = (m_NextVoice + i) % NUM_VOICES;
+				if(!m_aVoices[id].m_pSample)
+				{
+					CVoice *v = &m_aVoices[id];
+					m_NextVoice = id+1;
+
+					v->m_pSample = &m_aSamples[pCmd->m_SampleID];
+					v->m_pChannel = &m_aChannels[pCmd->m_ChannelID];
+					if(pCmd->m_Flags & ISound::FLAG_LOOP)
+						v->m_Tick = v->m_pSample->m_PausedAt;
+					else
+						v->m_Tick = 0;
+					v->m_Vol = 255;
+					v->m_Flags = pCmd->m_Flags;
+					v->m_X = pCmd->m_X;
+					v->m_Y = pCmd->m_Y;
+					UpdateGains(v, CenterX, CenterY);
+					break;
+				}
+			}
+		}
+		else if(pCmd->m_Type == CSoundCommand::STOP)
+		{
+			// TODO: a nice fade out
+			CSample *pSample = &m_aSamples[pCmd->m_SampleID];
+			for(int i = 0; i < NUM_VOICES; i++)
+			{
+				if(m_aVoices[i].m_pSample == pSample)
+					StopVoice(&m_aVoices[i]);
+			}
+		}
+		else if(pCmd->m_Type == CSoundCommand::STOP_ALL)
+		{
+			// TODO: a nice fade out
+			for(int i = 0; i < NUM_VOICES; i++)
+			{
+				if(m_aVoices[i].m_pSample)
+					StopVoice(&m_aVoices[i]);
+			}
+		}
+		else if(pCmd->m_Type == CSoundCommand::SET_CHANNEL)
+		{
+			CChannel *pChannel = &m_aChannels[pCmd->m_ChannelID];
+			pChannel->m_Vol = pCmd->m_Vol;
+			pChannel->m_Pan = pCmd->m_Pan;
+			for(int i = 0; i < NUM_VOICES; i++)
+			{
+				if(m_aVoices[i].m_pSample && m_aVoices[i].m_pChannel == pChannel)
+					UpdateGains(&m_aVoices[i], CenterX, CenterY);
+			}
+		}
+
+		sync_barrier();
+		m_CommandRead = (m_CommandRead+1)&(NUM_COMMANDS-1);
+	}
+}
+
+// adds Frames frames of a mono or stereo sample to the stereo mix buffer
+static void MixVoice(int *pOut, const short *pIn, int Channels, unsigned Frames, int Lvol, int Rvol)
+{
+	unsigned s = 0;
+
+#if defined(CONF_SOUND_SSE2)
+	// 4 frames per iteration, 16 bit products are widened with mullo/mulhi
+	const __m128i Vol = _mm_set_epi16(Rvol, Lvol, Rvol, Lvol, Rvol, Lvol, Rvol, Lvol);
+	for(; s+4 <= Frames; s += 4)
+	{
+		__m128i In;
+		if(Channels == 2)
+			In = _mm_loadu_si128((const __m128i *)(pIn+s*2));
+		else
+		{
+			__m128i Mono = _mm_loadl_epi64((const __m128i *)(pIn+s));
+			In = _mm_unpacklo_epi16(Mono, Mono);
+		}
+
+		__m128i Lo = _mm_mullo_epi16(In, Vol);
+		__m128i Hi = _mm_mulhi_epi16(In, Vol);
+		__m128i *pDst = (__m128i *)(pOut+s*2);
+		_mm_storeu_si128(pDst, _mm_add_epi32(_mm_loadu_si128(pDst), _mm_unpacklo_epi16(Lo, Hi)));
+		_mm_storeu_si128(pDst+1, _mm_add_epi32(_mm_loadu_si128(pDst+1), _mm_unpackhi_epi16(Lo, Hi)));
+	}
+#elif defined(CONF_SOUND_NEON)
+	const int16_t aVol[4] = {(int16_t)Lvol, (int16_t)Rvol, (int16_t)Lvol, (int16_t)Rvol};
+	const int16x4_t Vol = vld1_s16(aVol);
+	for(; s+4 <= Frames; s += 4)
+	{
+		int16x4_t In0, In1;
+		if(Channels == 2)
+		{
+			In0 = vld1_s16(pIn+s*2);
+			In1 = vld1_s16(pIn+s*2+4);
+		}
+		else
+		{
+			int16x4_t Mono = vld1_s16(pIn+s);
+			int16x4x2_t Zip = vzip_s16(Mono, Mono);
+			In0 = Zip.val[0];
+			In1 = Zip.val[1];
+		}
+
+		int32_t *pDst = pOut+s*2;
+		vst1q_s32(pDst, vmlal_s16(vld1q_s32(pDst), In0, Vol));
+		vst1q_s32(pDst+4, vmlal_s16(vld1q_s32(pDst+4), In1, Vol));
+	}
+#endif
+
+	// scalar fallback and the remaining frames
+	const short *pInL = pIn+s*Channels;
+	const short *pInR = Channels == 1 ? pInL : pInL+1;
+	pOut += s*2;
+	for(; s < Frames; s++)
+	{
+		*pOut++ += (*pInL)*Lvol;
+		*pOut++ += (*pInR)*Rvol;
+		pInL += Channels;
+		pInR += Channels;
+	}
+}
+
 static void Mix(short *pFinalOut, unsigned Frames)
 {
+	static int s_LastCenterX = 0;
+	static int s_LastCenterY = 0;
 	int MasterVol;
+	int CenterX = m_CenterX;
+	int CenterY = m_CenterY;
 	mem_zero(m_pMixBuffer, m_MaxFrames*2*sizeof(int));
 	Frames = min(Frames, m_MaxFrames);
 
-	// aquire lock while we are mixing
-	lock_wait(m_SoundLock);
+	ProcessCommands(CenterX, CenterY);
+
+	// positional gains only change when the listener moves
+	if(CenterX != s_LastCenterX || CenterY != s_LastCenterY)
+	{
+		for(unsigned i = 0; i < NUM_VOICES; i++)
+		{
+			if(m_aVoices[i].m_pSample && m_aVoices[i].m_Flags&ISound::FLAG_POS)
+				UpdateGains(&m_aVoices[i], CenterX, CenterY);
+		}
+		s_LastCenterX = CenterX;
+		s_LastCenterY = CenterY;
+	}
 
 	MasterVol = m_SoundVolume;
 
@@ -101,62 +352,18 @@ static void Mix(short *pFinalOut, unsigned Frames)
 		{
 			// mix voice
 			CVoice *v = &m_aVoices[i];
-			int *pOut = m_pMixBuffer;
-
-			int Step = v->m_pSample->m_Channels; // setup input sources
-			short *pInL = &v->m_pSample->m_pData[v->m_Tick*Step];
-			short *pInR = &v->m_pSample->m_pData[v->m_Tick*Step+1];
-
 			unsigned End = v->m_pSample->m_NumFrames-v->m_Tick;
 
-			int Rvol = v->m_pChannel->m_Vol;
-			int Lvol = v->m_pChannel->m_Vol;
-
 			// make sure that we don't go outside the sound data
 			if(Frames < End)
 				End = Frames;
 
-			// check if we have a mono sound
-			if(v->m_pSample->m_Channels == 1)
-				pInR = pInL;
-
-			// volume calculation
-			if(v->m_Flags&ISound::FLAG_POS && v->m_pChannel->m_Pan)
-			{
-				// TODO: we should respect the channel panning value
-				const int Range = 1500; // magic value, remove
-				int dx = v->m_X - m_CenterX;
-				int dy = v->m_Y - m_CenterY;
-				int Dist = (int)sqrtf((float)dx*dx+dy*dy); // float here. nasty
-				int p = IntAbs(dx);
-				if(Dist >= 0 && Dist < Range)
-				{
-					// panning
-					if(dx > 0)
-						Lvol = ((Range-p)*Lvol)/Range;
-					else
-						Rvol = ((Range-p)*Rvol)/Range;
-
-					// falloff
-					Lvol = (Lvol*(Range-Dist))/Range;
-					Rvol = (Rvol*(Range-Dist))/Range;
-				}
-				else
-				{
-					Lvol = 0;
-					Rvol = 0;
-				}
-			}
-
-			// process all frames
-			for(unsigned s = 0; s < End; s++)
+			if(v->m_LVol || v->m_RVol)
 			{
-				*pOut++ += (*pInL)*Lvol;
-				*pOut++ += (*pInR)*Rvol;
-				pInL += Step;
-				pInR += Step;
-				v->m_Tick++;
+				int Channels = v->m_pSample->m_Channels;
+				MixVoice(m_pMixBuffer, &v->m_pSample->m_pData[v->m_Tick*Channels], Channels, End, v->m_LVol, v->m_RVol);
 			}
+			v->m_Tick += End;
 
 			// free voice if not used any more
 			if(v->m_Tick == v->m_pSample->m_NumFrames)
@@ -169,10 +376,6 @@ static void Mix(short *pFinalOut, unsigned Frames)
 		}
 	}
 
-
-	// release the lock
-	lock_release(m_SoundLock);
-
 	{
 		// clamp accumulated values
 		// TODO: this seams slow
@@ -202,13 +405,13 @@ static void SdlCallback(void *pUnused, Uint8 *pStream, int Len)
 int CSound::Init()
 {
 	m_SoundEnabled = 0;
+	m_WvLock = lock_create();
 	m_pGraphics = Kernel()->RequestInterface<IEngineGraphics>();
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
+	m_pAssetCache = Kernel()->RequestInterface<IAssetCache>();
 
 	SDL_AudioSpec Format;
 
-	m_SoundLock = lock_create();
-
 	if(!g_Config.m_SndEnable)
 		return 0;
 
@@ -256,20 +459,17 @@ int CSound::Update()
 		WantedVolume = 0;
 
 	if(WantedVolume != m_SoundVolume)
-	{
-		lock_wait(m_SoundLock);
 		m_SoundVolume = WantedVolume;
-		lock_release(m_SoundLock);
-	}
 
 	return 0;
 }
 
 int CSound::Shutdown()
 {
+	// nothing may wait for the audio thread anymore
+	m_SoundEnabled = 0;
 	SDL_CloseAudio();
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
-	lock_destroy(m_SoundLock);
 	if(m_pMixBuffer)
 	{
 		mem_free(m_pMixBuffer);
@@ -351,16 +551,62 @@ int CSound::LoadWV(const char *pFilename)
 	if(!m_pStorage)
 		return -1;
 
-	ms_File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
-	if(!ms_File)
+	char aCompleteFilename[512];
+	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL, aCompleteFilename, sizeof(aCompleteFilename));
+	if(!File)
 	{
 		dbg_msg("sound/wv", "failed to open file. filename='%s'", pFilename);
 		return -1;
 	}
 
+	// the cache holds the samples already converted to the mixing rate
+	IAssetCache::CKey Key;
+	bool UseCache = m_pAssetCache && m_pAssetCache->KeyFromFile(&Key, aCompleteFilename, m_MixingRate);
+	if(UseCache)
+	{
+		int aInfo[IAssetCache::MAX_INFO];
+		unsigned DataSize;
+		short *pData = (short *)m_pAssetCache->Load("snd", &Key, aInfo, &DataSize);
+		if(pData)
+		{
+			io_close(File);
+
+			lock_wait(m_WvLock);
+			SampleID = AllocID();
+			if(SampleID < 0)
+			{
+				lock_release(m_WvLock);
+				mem_free(pData);
+				return -1;
+			}
+			pSample = &m_aSamples[SampleID];
+			pSample->m_pData = pData;
+			pSample->m_Channels = aInfo[0];
+			pSample->m_Rate = aInfo[1];
+			pSample->m_NumFrames = aInfo[2];
+			pSample->m_LoopStart = -1;
+			pSample->m_LoopEnd = -1;
+			pSample->m_PausedAt = 0;
+			lock_release(m_WvLock);
+
+			if(g_Config.m_Debug)
+				dbg_msg("sound/wv", "loaded %s from cache", pFilename);
+			return SampleID;
+		}
+	}
+
+	// wavpack keeps its state in globals, only one sound can be unpacked at a time
+	lock_wait(m_WvLock);
+
+	ms_File = File;
 	SampleID = AllocID();
 	if(SampleID < 0)
+	{
+		io_close(ms_File);
+		ms_File = NULL;
+		lock_release(m_WvLock);
 		return -1;
+	}
 	pSample = &m_aSamples[SampleID];
 
 	pContext = WavpackOpenFileInput(ReadData, aError);
@@ -381,7 +627,7 @@ int CSound::LoadWV(const char *pFilename)
 		if(pSample->m_Channels > 2)
 		{
 			dbg_msg("sound/wv", "file is not mono or stereo. filename='%s'", pFilename);
-			return -1;
+			SampleID = -1;
 		}
 
 		/*
@@ -391,28 +637,31 @@ int CSound::LoadWV(const char *pFilename)
 			return -1;
 		}*/
 
-		if(BitsPerSample != 16)
+		else if(BitsPerSample != 16)
 		{
 			dbg_msg("sound/wv", "bps is %d, not 16, filname='%s'", BitsPerSample, pFilename);
-			return -1;
+			SampleID = -1;
 		}
 
-		pData = (int *)mem_alloc(4*m_aSamples*m_aChannels, 1);
-		WavpackUnpackSamples(pContext, pData, m_aSamples); // TODO: check return value
-		pSrc = pData;
+		else
+		{
+			pData = (int *)mem_alloc(4*m_aSamples*m_aChannels, 1);
+			WavpackUnpackSamples(pContext, pData, m_aSamples); // TODO: check return value
+			pSrc = pData;
 
-		pSample->m_pData = (short *)mem_alloc(2*m_aSamples*m_aChannels, 1);
-		pDst = pSample->m_pData;
+			pSample->m_pData = (short *)mem_alloc(2*m_aSamples*m_aChannels, 1);
+			pDst = pSample->m_pData;
 
-		for (i = 0; i < m_aSamples*m_aChannels; i++)
-			*pDst++ = (short)*pSrc++;
+			for (i = 0; i < m_aSamples*m_aChannels; i++)
+				*pDst++ = (short)*pSrc++;
 
-		mem_free(pData);
+			mem_free(pData);
 
-		pSample->m_NumFrames = m_aSamples;
-		pSample->m_LoopStart = -1;
-		pSample->m_LoopEnd = -1;
-		pSample->m_PausedAt = 0;
+			pSample->m_NumFrames = m_aSamples;
+			pSample->m_LoopStart = -1;
+			pSample->m_LoopEnd = -1;
+			pSample->m_PausedAt = 0;
+		}
 	}
 	else
 	{
@@ -421,11 +670,22 @@ int CSound::LoadWV(const char *pFilename)
 
 	io_close(ms_File);
 	ms_File = NULL;
+	lock_release(m_WvLock);
+
+	if(SampleID < 0)
+		return -1;
 
 	if(g_Config.m_Debug)
 		dbg_msg("sound/wv", "loaded %s", pFilename);
 
+	// the sample is ours now, converting it can run next to other loads
 	RateConvert(SampleID);
+
+	if(UseCache)
+	{
+		int aInfo[IAssetCache::MAX_INFO] = { pSample->m_Channels, pSample->m_Rate, pSample->m_NumFrames, 0 };
+		m_pAssetCache->Store("snd", &Key, aInfo, pSample->m_pData, pSample->m_NumFrames*pSample->m_Channels*sizeof(short));
+	}
 	return SampleID;
 }
 
@@ -438,46 +698,36 @@ void CSound::SetListenerPos(float x, float y)
 
 void CSound::SetChannel(int ChannelID, float Vol, float Pan)
 {
-	m_aChannels[ChannelID].m_Vol = (int)(Vol*255.0f);
-	m_aChannels[ChannelID].m_Pan = (int)(Pan*255.0f); // TODO: this is only on and off right now
-}
+	CSoundCommand Cmd;
+	Cmd.m_Type = CSoundCommand::SET_CHANNEL;
+	Cmd.m_ChannelID = ChannelID;
+	Cmd.m_Vol = (int)(Vol*255.0f);
+	Cmd.m_Pan = (int)(Pan*255.0f); // TODO: this is only on and off right now
 
-int CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
-{
-	int VoiceID = -1;
-	int i;
-
-	lock_wait(m_SoundLock);
-
-	// search for voice
-	for(i = 0; i < NUM_VOICES; i++)
+	// the audio thread isn't running yet, no need to queue it
+	if(!m_SoundEnabled)
 	{
-		int id = (m_NextVoice + i) % NUM_VOICES;
-		if(!m_aVoices[id].m_pSample)
-		{
-			VoiceID = id;
-			m_NextVoice = id+1;
-			break;
-		}
+		m_aChannels[ChannelID].m_Vol = Cmd.m_Vol;
+		m_aChannels[ChannelID].m_Pan = Cmd.m_Pan;
+		return;
 	}
+	PushCommand(&Cmd);
+}
 
-	// voice found, use it
-	if(VoiceID != -1)
-	{
-		m_aVoices[VoiceID].m_pSample = &m_aSamples[SampleID];
-		m_aVoices[VoiceID].m_pChannel = &m_aChannels[ChannelID];
-		if(Flags & FLAG_LOOP)
-			m_aVoices[VoiceID].m_Tick = m_aSamples[SampleID].m_PausedAt;
-		else
-			m_aVoices[VoiceID].m_Tick = 0;
-		m_aVoices[VoiceID].m_Vol = 255;
-		m_aVoices[VoiceID].m_Flags = Flags;
-		m_aVoices[VoiceID].m_X = (int)x;
-		m_aVoices[VoiceID].m_Y = (int)y;
-	}
+int CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
+{
+	if(!m_SoundEnabled || SampleID < 0)
+		return -1;
 
-	lock_release(m_SoundLock);
-	return VoiceID;
+	// the voice is picked by the audio thread, so there is no id to return
+	CSoundCommand Cmd;
+	Cmd.m_Type = CSoundCommand::PLAY;
+	Cmd.m_ChannelID = ChannelID;
+	Cmd.m_SampleID = SampleID;
+	Cmd.m_Flags = Flags;
+	Cmd.m_X = (int)x;
+	Cmd.m_Y = (int)y;
+	return PushCommand(&Cmd) ? 0 : -1;
 }
 
 int CSound::PlayAt(int ChannelID, int SampleID, int Flags, float x, float y)
@@ -492,39 +742,23 @@ int CSound::Play(int ChannelID, int SampleID, int Flags)
 
 void CSound::Stop(int SampleID)
 {
-	// TODO: a nice fade out
-	lock_wait(m_SoundLock);
-	CSample *pSample = &m_aSamples[SampleID];
-	for(int i = 0; i < NUM_VOICES; i++)
-	{
-		if(m_aVoices[i].m_pSample == pSample)
-		{
-			if(m_aVoices[i].m_Flags & FLAG_LOOP)
-				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
-			else
-				m_aVoices[i].m_pSample->m_PausedAt = 0;
-			m_aVoices[i].m_pSample = 0;
-		}
-	}
-	lock_release(m_SoundLock);
+	if(!m_SoundEnabled || SampleID < 0)
+		return;
+
+	CSoundCommand Cmd;
+	Cmd.m_Type = CSoundCommand::STOP;
+	Cmd.m_SampleID = SampleID;
+	PushCommand(&Cmd);
 }
 
 void CSound::StopAll()
 {
-	// TODO: a nice fade out
-	lock_wait(m_SoundLock);
-	for(int i = 0; i < NUM_VOICES; i++)
-	{
-		if(m_aVoices[i].m_pSample)
-		{
-			if(m_aVoices[i].m_Flags & FLAG_LOOP)
-				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
-			else
-				m_aVoices[i].m_pSample->m_PausedAt = 0;
-		}
-		m_aVoices[i].m_pSample = 0;
-	}
-	lock_release(m_SoundLock);
+	if(!m_SoundEnabled)
+		return;
+
+	CSoundCommand Cmd;
+	Cmd.m_Type = CSoundCommand::STOP_ALL;
+	PushCommand(&Cmd);
 }
 
 IOHANDLE CSound::ms_File = 0;
@@ -12,6 +12,7 @@ class CSound : public IEngineSound
 public:
 	IEngineGraphics *m_pGraphics;
 	IStorage *m_pStorage;
+	class IAssetCache *m_pAssetCache;
 
 	virtual int Init();
 
@@ -13,10 +13,16 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
-// TODO: Refactor: clean this up
 enum
 {
-	MAX_CHARACTERS = 64,
+	MAX_GLYPHS = 4096,
+	GLYPH_HASH_SIZE = 1024,
+	MAX_SHELVES = 256,
+	MAX_TEXTURE_SIZE = 2048,
+
+	LAYOUT_CACHE_SIZE = 512,
+	LAYOUT_HASH_SIZE = 1024,
+	MAX_LAYOUT_TEXT = 256,
 };
 
 
@@ -26,6 +32,7 @@ static int aFontSizes[] = {8,9,10,11,12,13,14,15,16,17,18,19,20,36,64};
 struct CFontChar
 {
 	int m_ID;
+	int m_HashNext;
 
 	// these values are scaled to the pFont size
 	// width * font_size == real_size
@@ -35,8 +42,16 @@ struct CFontChar
 	float m_OffsetY;
 	float m_AdvanceX;
 
-	float m_aUvs[4];
-	int64 m_TouchTime;
+	// position in the atlas in texels, stays valid when the atlas grows
+	float m_aTexels[4];
+};
+
+// a row of glyphs in the atlas, glyphs are appended from left to right
+struct CGlyphShelf
+{
+	int m_Y;
+	int m_Height;
+	int m_Used;
 };
 
 struct CFontSizeData
@@ -48,15 +63,21 @@ struct CFontSizeData
 	int m_TextureWidth;
 	int m_TextureHeight;
 
-	int m_NumXChars;
-	int m_NumYChars;
+	// copy of the atlas, uploaded again when the texture grows
+	unsigned char *m_apTextureData[2];
 
 	int m_CharMaxWidth;
 	int m_CharMaxHeight;
 
-	CFontChar m_aCharacters[MAX_CHARACTERS*MAX_CHARACTERS];
+	CGlyphShelf m_aShelves[MAX_SHELVES];
+	int m_NumShelves;
+
+	CFontChar m_aCharacters[MAX_GLYPHS];
+	int m_NumCharacters;
+	int m_aCharacterHash[GLYPH_HASH_SIZE];
 
-	int m_CurrentCharacter;
+	// changes when glyphs get thrown out, cached layouts are invalid after that
+	int m_Generation;
 };
 
 class CFont
@@ -67,6 +88,47 @@ public:
 	CFontSizeData m_aSizes[NUM_FONT_SIZES];
 };
 
+// a glyph quad of a laid out text, relative to the cursor
+struct CTextQuad
+{
+	float m_X;
+	float m_Y;
+	float m_Width;
+	float m_Height;
+	float m_aTexels[4];
+};
+
+struct CTextLayout
+{
+	// key
+	unsigned m_Hash;
+	char m_aText[MAX_LAYOUT_TEXT];
+	int m_Length;
+	CFont *m_pFont;
+	int m_FontSize;
+	int m_Flags;
+	int m_MaxLines;
+	float m_LineWidth;
+	float m_FakeToScreenX;
+	float m_FakeToScreenY;
+	int m_Generation;
+
+	// result, relative to the cursor
+	CTextQuad *m_pQuads;
+	int m_NumQuads;
+	int m_QuadCapacity;
+	float m_EndX;
+	float m_EndY;
+	int m_NumLines;
+	int m_NumChars;
+	int m_GotNewLine;
+
+	// lru list and hash chain
+	int m_Prev;
+	int m_Next;
+	int m_HashNext;
+};
+
 
 class CTextRender : public IEngineTextRender
 {
@@ -103,6 +165,16 @@ class CTextRender : public IEngineTextRender
 
 	FT_Library m_FTLibrary;
 
+	// laid out texts, most recently used first
+	CTextLayout m_aLayouts[LAYOUT_CACHE_SIZE];
+	int m_aLayoutHash[LAYOUT_HASH_SIZE];
+	int m_FirstLayout;
+	int m_LastLayout;
+
+	// used for texts that don't go into the cache
+	CTextLayout m_ScratchLayout;
+	int m_LayoutDepth;
+
 	int GetFontSizeIndex(int Pixelsize)
 	{
 		for(unsigned i = 0; i < NUM_FONT_SIZES; i++)
@@ -140,16 +212,23 @@ class CTextRender : public IEngineTextRender
 			}
 	}
 
-	void InitTexture(CFontSizeData *pSizeData, int CharWidth, int CharHeight, int Xchars, int Ychars)
+	void InitTexture(CFontSizeData *pSizeData, int Width, int Height)
 	{
 		static int FontMemoryUsage = 0;
-		int Width = CharWidth*Xchars;
-		int Height = CharHeight*Ychars;
-		void *pMem = mem_alloc(Width*Height, 1);
-		mem_zero(pMem, Width*Height);
 
 		for(int i = 0; i < 2; i++)
 		{
+			// glyphs keep their texels, the old atlas ends up in the top left corner
+			unsigned char *pMem = (unsigned char *)mem_alloc(Width*Height, 1);
+			mem_zero(pMem, Width*Height);
+			if(pSizeData->m_apTextureData[i])
+			{
+				for(int y = 0; y < pSizeData->m_TextureHeight; y++)
+					mem_copy(&pMem[y*Width], &pSizeData->m_apTextureData[i][y*pSizeData->m_TextureWidth], pSizeData->m_TextureWidth);
+				mem_free(pSizeData->m_apTextureData[i]);
+			}
+			pSizeData->m_apTextureData[i] = pMem;
+
 			if(pSizeData->m_aTextures[i] != 0)
 			{
 				Graphics()->UnloadTexture(pSizeData->m_aTextures[i]);
@@ -161,15 +240,23 @@ class CTextRender : public IEngineTextRender
 			FontMemoryUsage += Width*Height;
 		}
 
-		pSizeData->m_NumXChars = Xchars;
-		pSizeData->m_NumYChars = Ychars;
 		pSizeData->m_TextureWidth = Width;
 		pSizeData->m_TextureHeight = Height;
-		pSizeData->m_CurrentCharacter = 0;
-		
+
 		dbg_msg("", "pFont memory usage: %d", FontMemoryUsage);
+	}
 
-		mem_free(pMem);
+	void FreeTexture(CFontSizeData *pSizeData)
+	{
+		for(int i = 0; i < 2; i++)
+		{
+			if(pSizeData->m_aTextures[i] != 0)
+				Graphics()->UnloadTexture(pSizeData->m_aTextures[i]);
+			pSizeData->m_aTextures[i] = 0;
+			if(pSizeData->m_apTextureData[i])
+				mem_free(pSizeData->m_apTextureData[i]);
+			pSizeData->m_apTextureData[i] = 0;
+		}
 	}
 
 	int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize)
@@ -181,13 +268,27 @@ class CTextRender : public IEngineTextRender
 		return OutlineThickness;
 	}
 
-	void IncreaseTextureSize(CFontSizeData *pSizeData)
+	bool IncreaseTextureSize(CFontSizeData *pSizeData)
 	{
-		if(pSizeData->m_TextureWidth < pSizeData->m_TextureHeight)
-			pSizeData->m_NumXChars <<= 1;
+		int Width = pSizeData->m_TextureWidth;
+		int Height = pSizeData->m_TextureHeight;
+		if(Width < Height)
+			Width <<= 1;
 		else
-			pSizeData->m_NumYChars <<= 1;
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, pSizeData->m_NumXChars, pSizeData->m_NumYChars);
+			Height <<= 1;
+		if(Width > MAX_TEXTURE_SIZE || Height > MAX_TEXTURE_SIZE)
+			return false;
+		InitTexture(pSizeData, Width, Height);
+		return true;
+	}
+
+	void ResetGlyphs(CFontSizeData *pSizeData)
+	{
+		pSizeData->m_NumShelves = 0;
+		pSizeData->m_NumCharacters = 0;
+		for(int i = 0; i < GLYPH_HASH_SIZE; i++)
+			pSizeData->m_aCharacterHash[i] = -1;
+		pSizeData->m_Generation++;
 	}
 
 
@@ -226,7 +327,8 @@ class CTextRender : public IEngineTextRender
 
 		//dbg_msg("pFont", "init size %d, texture size %d %d", pFont->sizes[index].font_size, w, h);
 		//FT_New_Face(m_FTLibrary, "data/fonts/vera.ttf", 0, &pFont->ft_face);
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, 8, 8);
+		ResetGlyphs(pSizeData);
+		InitTexture(pSizeData, min(pSizeData->m_CharMaxWidth*8, (int)MAX_TEXTURE_SIZE), min(pSizeData->m_CharMaxHeight*8, (int)MAX_TEXTURE_SIZE));
 	}
 
 	CFontSizeData *GetSize(CFont *pFont, int Pixelsize)
@@ -238,65 +340,76 @@ class CTextRender : public IEngineTextRender
 	}
 
 
-	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int SlotID, int Chr, const void *pData)
+	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int x, int y, int Width, int Height, const unsigned char *pData)
 	{
-		int x = (SlotID%pSizeData->m_NumXChars) * (pSizeData->m_TextureWidth/pSizeData->m_NumXChars);
-		int y = (SlotID/pSizeData->m_NumXChars) * (pSizeData->m_TextureHeight/pSizeData->m_NumYChars);
+		unsigned char *pAtlas = pSizeData->m_apTextureData[Texnum];
+		for(int py = 0; py < Height; py++)
+			mem_copy(&pAtlas[(y+py)*pSizeData->m_TextureWidth+x], &pData[py*Width], Width);
 
-		Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[Texnum], x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			CImageInfo::FORMAT_ALPHA, pData);
-		/*
-		glBindTexture(GL_TEXTURE_2D, pSizeData->m_aTextures[Texnum]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			m_FontTextureFormat, GL_UNSIGNED_BYTE, pData);*/
+		Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[Texnum], x, y, Width, Height, CImageInfo::FORMAT_ALPHA, pData);
 	}
 
 	// 32k of data used for rendering glyphs
 	unsigned char ms_aGlyphData[(1024/8) * (1024/8)];
 	unsigned char ms_aGlyphDataOutlined[(1024/8) * (1024/8)];
 
-	int GetSlot(CFontSizeData *pSizeData)
+	bool AllocShelfSpace(CFontSizeData *pSizeData, int Width, int Height, int *pX, int *pY)
 	{
-		int CharCount = pSizeData->m_NumXChars*pSizeData->m_NumYChars;
-		if(pSizeData->m_CurrentCharacter < CharCount)
+		// take the lowest shelf the glyph fits in
+		CGlyphShelf *pShelf = 0;
+		for(int i = 0; i < pSizeData->m_NumShelves; i++)
 		{
-			int i = pSizeData->m_CurrentCharacter;
-			pSizeData->m_CurrentCharacter++;
-			return i;
+			CGlyphShelf *pCur = &pSizeData->m_aShelves[i];
+			if(pCur->m_Height >= Height && pCur->m_Used+Width <= pSizeData->m_TextureWidth &&
+				(!pShelf || pCur->m_Height < pShelf->m_Height))
+				pShelf = pCur;
 		}
 
-		// kick out the oldest
-		// TODO: remove this linear search
+		// open a new one below the others
+		if(!pShelf)
 		{
-			int Oldest = 0;
-			for(int i = 1; i < CharCount; i++)
+			int y = 0;
+			if(pSizeData->m_NumShelves)
 			{
-				if(pSizeData->m_aCharacters[i].m_TouchTime < pSizeData->m_aCharacters[Oldest].m_TouchTime)
-					Oldest = i;
+				CGlyphShelf *pLast = &pSizeData->m_aShelves[pSizeData->m_NumShelves-1];
+				y = pLast->m_Y + pLast->m_Height;
 			}
+			int ShelfHeight = (Height+3)&~3;
+			if(pSizeData->m_NumShelves == MAX_SHELVES || y+ShelfHeight > pSizeData->m_TextureHeight || Width > pSizeData->m_TextureWidth)
+				return false;
+
+			pShelf = &pSizeData->m_aShelves[pSizeData->m_NumShelves++];
+			pShelf->m_Y = y;
+			pShelf->m_Height = ShelfHeight;
+			pShelf->m_Used = 0;
+		}
+
+		*pX = pShelf->m_Used;
+		*pY = pShelf->m_Y;
+		pShelf->m_Used += Width;
+		return true;
+	}
 
-			if(time_get()-pSizeData->m_aCharacters[Oldest].m_TouchTime < time_freq() &&
-				(pSizeData->m_NumXChars < MAX_CHARACTERS || pSizeData->m_NumYChars < MAX_CHARACTERS))
+	bool GetGlyphSpace(CFontSizeData *pSizeData, int Width, int Height, int *pX, int *pY)
+	{
+		if(pSizeData->m_NumCharacters == MAX_GLYPHS)
+			ResetGlyphs(pSizeData);
+
+		while(!AllocShelfSpace(pSizeData, Width, Height, pX, pY))
+		{
+			if(!IncreaseTextureSize(pSizeData))
 			{
-				IncreaseTextureSize(pSizeData);
-				return GetSlot(pSizeData);
+				// the atlas can't grow anymore, start over
+				ResetGlyphs(pSizeData);
+				return AllocShelfSpace(pSizeData, Width, Height, pX, pY);
 			}
-
-			return Oldest;
 		}
+		return true;
 	}
 
 	int RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
 		FT_Bitmap *pBitmap;
-		int SlotID = 0;
-		int SlotW = pSizeData->m_TextureWidth / pSizeData->m_NumXChars;
-		int SlotH = pSizeData->m_TextureHeight / pSizeData->m_NumYChars;
-		int SlotSize = SlotW*SlotH;
 		int x = 1;
 		int y = 1;
 		int px, py;
@@ -311,24 +424,32 @@ class CTextRender : public IEngineTextRender
 
 		pBitmap = &pFont->m_FtFace->glyph->bitmap; // ignore_convention
 
-		// fetch slot
-		SlotID = GetSlot(pSizeData);
-		if(SlotID < 0)
-			return -1;
-
 		// adjust spacing
 		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
 		x += OutlineThickness;
 		y += OutlineThickness;
 
+		int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
+		int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
+		if(Width*Height > (int)sizeof(ms_aGlyphData))
+		{
+			dbg_msg("pFont", "glyph %d too big", Chr);
+			return -1;
+		}
+
+		// fetch space in the atlas
+		int AtlasX, AtlasY;
+		if(!GetGlyphSpace(pSizeData, Width, Height, &AtlasX, &AtlasY))
+			return -1;
+
 		// prepare glyph data
-		mem_zero(ms_aGlyphData, SlotSize);
+		mem_zero(ms_aGlyphData, Width*Height);
 
 		if(pBitmap->pixel_mode == FT_PIXEL_MODE_GRAY) // ignore_convention
 		{
 			for(py = 0; py < pBitmap->rows; py++) // ignore_convention
 				for(px = 0; px < pBitmap->width; px++) // ignore_convention
-					ms_aGlyphData[(py+y)*SlotW+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
+					ms_aGlyphData[(py+y)*Width+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
 		}
 		else if(pBitmap->pixel_mode == FT_PIXEL_MODE_MONO) // ignore_convention
 		{
@@ -336,40 +457,33 @@ class CTextRender : public IEngineTextRender
 				for(px = 0; px < pBitmap->width; px++) // ignore_convention
 				{
 					if(pBitmap->buffer[py*pBitmap->pitch+px/8]&(1<<(7-(px%8)))) // ignore_convention
-						ms_aGlyphData[(py+y)*SlotW+px+x] = 255;
+						ms_aGlyphData[(py+y)*Width+px+x] = 255;
 				}
 		}
 
-		if(0) for(py = 0; py < SlotW; py++)
-			for(px = 0; px < SlotH; px++)
-				ms_aGlyphData[py*SlotW+px] = 255;
-
 		// upload the glyph
-		UploadGlyph(pSizeData, 0, SlotID, Chr, ms_aGlyphData);
+		UploadGlyph(pSizeData, 0, AtlasX, AtlasY, Width, Height, ms_aGlyphData);
 
 		if(OutlineThickness == 1)
 		{
-			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphDataOutlined);
+			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+			UploadGlyph(pSizeData, 1, AtlasX, AtlasY, Width, Height, ms_aGlyphDataOutlined);
 		}
 		else
 		{
 			for(int i = OutlineThickness; i > 0; i-=2)
 			{
-				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, SlotW, SlotH);
+				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, Width, Height);
 			}
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphData);
+			UploadGlyph(pSizeData, 1, AtlasX, AtlasY, Width, Height, ms_aGlyphData);
 		}
 
 		// set char info
+		int Index = pSizeData->m_NumCharacters++;
 		{
-			CFontChar *pFontchr = &pSizeData->m_aCharacters[SlotID];
+			CFontChar *pFontchr = &pSizeData->m_aCharacters[Index];
 			float Scale = 1.0f/pSizeData->m_FontSize;
-			float Uscale = 1.0f/pSizeData->m_TextureWidth;
-			float Vscale = 1.0f/pSizeData->m_TextureHeight;
-			int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
-			int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
 
 			pFontchr->m_ID = Chr;
 			pFontchr->m_Height = Height * Scale;
@@ -378,45 +492,33 @@ class CTextRender : public IEngineTextRender
 			pFontchr->m_OffsetY = (pSizeData->m_FontSize - pFont->m_FtFace->glyph->bitmap_top) * Scale; // ignore_convention
 			pFontchr->m_AdvanceX = (pFont->m_FtFace->glyph->advance.x>>6) * Scale; // ignore_convention
 
-			pFontchr->m_aUvs[0] = (SlotID%pSizeData->m_NumXChars) / (float)(pSizeData->m_NumXChars);
-			pFontchr->m_aUvs[1] = (SlotID/pSizeData->m_NumXChars) / (float)(pSizeData->m_NumYChars);
-			pFontchr->m_aUvs[2] = pFontchr->m_aUvs[0] + Width*Uscale;
-			pFontchr->m_aUvs[3] = pFontchr->m_aUvs[1] + Height*Vscale;
+			pFontchr->m_aTexels[0] = AtlasX;
+			pFontchr->m_aTexels[1] = AtlasY;
+			pFontchr->m_aTexels[2] = AtlasX + Width;
+			pFontchr->m_aTexels[3] = AtlasY + Height;
+
+			int *pBucket = &pSizeData->m_aCharacterHash[(unsigned)Chr%GLYPH_HASH_SIZE];
+			pFontchr->m_HashNext = *pBucket;
+			*pBucket = Index;
 		}
 
-		return SlotID;
+		return Index;
 	}
 
 	CFontChar *GetChar(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
-		CFontChar *pFontchr = NULL;
-
 		// search for the character
-		// TODO: remove this linear search
-		int i;
-		for(i = 0; i < pSizeData->m_CurrentCharacter; i++)
+		for(int i = pSizeData->m_aCharacterHash[(unsigned)Chr%GLYPH_HASH_SIZE]; i >= 0; i = pSizeData->m_aCharacters[i].m_HashNext)
 		{
 			if(pSizeData->m_aCharacters[i].m_ID == Chr)
-			{
-				pFontchr = &pSizeData->m_aCharacters[i];
-				break;
-			}
-		}
-
-		// check if we need to render the character
-		if(!pFontchr)
-		{
-			int Index = RenderGlyph(pFont, pSizeData, Chr);
-			if(Index >= 0)
-				pFontchr = &pSizeData->m_aCharacters[Index];
+				return &pSizeData->m_aCharacters[i];
 		}
 
-		// touch the character
-		// TODO: don't call time_get here
-		if(pFontchr)
-			pFontchr->m_TouchTime = time_get();
-
-		return pFontchr;
+		// render the character
+		int Index = RenderGlyph(pFont, pSizeData, Chr);
+		if(Index >= 0)
+			return &pSizeData->m_aCharacters[Index];
+		return NULL;
 	}
 
 	// must only be called from the rendering function as the pFont must be set to the correct size
@@ -432,6 +534,318 @@ class CTextRender : public IEngineTextRender
 		return (Kerning.x>>6);
 	}
 
+	static unsigned LayoutHash(const char *pText, int Length)
+	{
+		unsigned Hash = 5381;
+		for(int i = 0; i < Length; i++)
+			Hash = ((Hash << 5) + Hash) + (unsigned char)pText[i];
+		return Hash;
+	}
+
+	void UnlinkLayout(int Index)
+	{
+		CTextLayout *pLayout = &m_aLayouts[Index];
+		if(pLayout->m_Prev >= 0)
+			m_aLayouts[pLayout->m_Prev].m_Next = pLayout->m_Next;
+		else
+			m_FirstLayout = pLayout->m_Next;
+		if(pLayout->m_Next >= 0)
+			m_aLayouts[pLayout->m_Next].m_Prev = pLayout->m_Prev;
+		else
+			m_LastLayout = pLayout->m_Prev;
+	}
+
+	void LinkLayoutFront(int Index)
+	{
+		CTextLayout *pLayout = &m_aLayouts[Index];
+		pLayout->m_Prev = -1;
+		pLayout->m_Next = m_FirstLayout;
+		if(m_FirstLayout >= 0)
+			m_aLayouts[m_FirstLayout].m_Prev = Index;
+		else
+			m_LastLayout = Index;
+		m_FirstLayout = Index;
+	}
+
+	void LinkLayoutBack(int Index)
+	{
+		CTextLayout *pLayout = &m_aLayouts[Index];
+		pLayout->m_Prev = m_LastLayout;
+		pLayout->m_Next = -1;
+		if(m_LastLayout >= 0)
+			m_aLayouts[m_LastLayout].m_Next = Index;
+		else
+			m_FirstLayout = Index;
+		m_LastLayout = Index;
+	}
+
+	void RemoveLayout(int Index)
+	{
+		CTextLayout *pLayout = &m_aLayouts[Index];
+		if(pLayout->m_Length < 0)
+			return;
+
+		int *pLink = &m_aLayoutHash[pLayout->m_Hash%LAYOUT_HASH_SIZE];
+		while(*pLink != Index)
+			pLink = &m_aLayouts[*pLink].m_HashNext;
+		*pLink = pLayout->m_HashNext;
+		pLayout->m_Length = -1;
+	}
+
+	int FindLayout(unsigned Hash, const char *pText, int Length, CFont *pFont, int FontSize, const CTextCursor *pCursor, float FakeToScreenX, float FakeToScreenY)
+	{
+		for(int i = m_aLayoutHash[Hash%LAYOUT_HASH_SIZE]; i >= 0; i = m_aLayouts[i].m_HashNext)
+		{
+			CTextLayout *pLayout = &m_aLayouts[i];
+			if(pLayout->m_Hash == Hash && pLayout->m_Length == Length && pLayout->m_pFont == pFont && pLayout->m_FontSize == FontSize &&
+				pLayout->m_Flags == (pCursor->m_Flags&TEXTFLAG_STOP_AT_END) && pLayout->m_MaxLines == pCursor->m_MaxLines &&
+				pLayout->m_LineWidth == pCursor->m_LineWidth && pLayout->m_FakeToScreenX == FakeToScreenX &&
+				pLayout->m_FakeToScreenY == FakeToScreenY && mem_comp(pLayout->m_aText, pText, Length) == 0)
+				return i;
+		}
+		return -1;
+	}
+
+	int NewLayout(unsigned Hash, const char *pText, int Length, CFont *pFont, int FontSize, const CTextCursor *pCursor, float FakeToScreenX, float FakeToScreenY)
+	{
+		// reuse the least recently used one
+		int Index = m_LastLayout;
+		CTextLayout *pLayout = &m_aLayouts[Index];
+		RemoveLayout(Index);
+
+		pLayout->m_Hash = Hash;
+		mem_copy(pLayout->m_aText, pText, Length);
+		pLayout->m_Length = Length;
+		pLayout->m_pFont = pFont;
+		pLayout->m_FontSize = FontSize;
+		pLayout->m_Flags = pCursor->m_Flags&TEXTFLAG_STOP_AT_END;
+		pLayout->m_MaxLines = pCursor->m_MaxLines;
+		pLayout->m_LineWidth = pCursor->m_LineWidth;
+		pLayout->m_FakeToScreenX = FakeToScreenX;
+		pLayout->m_FakeToScreenY = FakeToScreenY;
+		pLayout->m_Generation = -1;
+
+		int *pBucket = &m_aLayoutHash[Hash%LAYOUT_HASH_SIZE];
+		pLayout->m_HashNext = *pBucket;
+		*pBucket = Index;
+		return Index;
+	}
+
+	void ClearLayouts(CFont *pFont)
+	{
+		for(int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+		{
+			if(m_aLayouts[i].m_Length >= 0 && m_aLayouts[i].m_pFont == pFont)
+			{
+				RemoveLayout(i);
+				UnlinkLayout(i);
+				LinkLayoutBack(i);
+			}
+		}
+	}
+
+	void AddQuad(CTextLayout *pLayout, float x, float y, float Size, const CFontChar *pChr)
+	{
+		if(pLayout->m_NumQuads == pLayout->m_QuadCapacity)
+		{
+			int NewCapacity = max(pLayout->m_QuadCapacity*2, 32);
+			CTextQuad *pNewQuads = (CTextQuad *)mem_alloc(NewCapacity*sizeof(CTextQuad), 1);
+			if(pLayout->m_pQuads)
+			{
+				mem_copy(pNewQuads, pLayout->m_pQuads, pLayout->m_NumQuads*sizeof(CTextQuad));
+				mem_free(pLayout->m_pQuads);
+			}
+			pLayout->m_pQuads = pNewQuads;
+			pLayout->m_QuadCapacity = NewCapacity;
+		}
+
+		CTextQuad *pQuad = &pLayout->m_pQuads[pLayout->m_NumQuads++];
+		pQuad->m_X = x+pChr->m_OffsetX*Size;
+		pQuad->m_Y = y+pChr->m_OffsetY*Size;
+		pQuad->m_Width = pChr->m_Width*Size;
+		pQuad->m_Height = pChr->m_Height*Size;
+		for(int i = 0; i < 4; i++)
+			pQuad->m_aTexels[i] = pChr->m_aTexels[i];
+	}
+
+	// walks the text and moves the cursor, records the glyph quads relative to CursorX/CursorY into pLayout if given
+	int DoLayout(CTextCursor *pCursor, const char *pText, int Length, CFont *pFont, CFontSizeData *pSizeData,
+		float Size, float CursorX, float CursorY, float FakeToScreenX, float FakeToScreenY, CTextLayout *pLayout)
+	{
+		const char *pCurrent = (char *)pText;
+		const char *pEnd = pCurrent+Length;
+		float DrawX = CursorX;
+		float DrawY = CursorY;
+		int LineCount = pCursor->m_LineCount;
+		int GotNewLine = 0;
+		float Scale = 1/pSizeData->m_FontSize;
+
+		while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
+		{
+			int NewLine = 0;
+			const char *pBatchEnd = pEnd;
+			if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
+			{
+				int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
+				CTextCursor Compare = *pCursor;
+				Compare.m_X = DrawX;
+				Compare.m_Y = DrawY;
+				Compare.m_Flags &= ~TEXTFLAG_RENDER;
+				Compare.m_LineWidth = -1;
+				TextEx(&Compare, pText, Wlen);
+
+				if(Compare.m_X-DrawX > pCursor->m_LineWidth)
+				{
+					// word can't be fitted in one line, cut it
+					CTextCursor Cutter = *pCursor;
+					Cutter.m_CharCount = 0;
+					Cutter.m_X = DrawX;
+					Cutter.m_Y = DrawY;
+					Cutter.m_Flags &= ~TEXTFLAG_RENDER;
+					Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
+
+					TextEx(&Cutter, (const char *)pCurrent, Wlen);
+					Wlen = Cutter.m_CharCount;
+					NewLine = 1;
+
+					if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
+						Wlen = 0;
+				}
+				else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
+				{
+					NewLine = 1;
+					Wlen = 0;
+				}
+
+				pBatchEnd = pCurrent + Wlen;
+			}
+
+			const char *pTmp = pCurrent;
+			int NextCharacter = str_utf8_decode(&pTmp);
+			while(pCurrent < pBatchEnd)
+			{
+				int Character = NextCharacter;
+				pCurrent = pTmp;
+				NextCharacter = str_utf8_decode(&pTmp);
+
+				if(Character == '\n')
+				{
+					DrawX = pCursor->m_StartX;
+					DrawY += Size;
+					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+					++LineCount;
+					if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
+						break;
+					continue;
+				}
+
+				CFontChar *pChr = GetChar(pFont, pSizeData, Character);
+				if(pChr)
+				{
+					float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
+					if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
+					{
+						// we hit the end of the line, no more to render or count
+						pCurrent = pEnd;
+						break;
+					}
+
+					if(pLayout)
+						AddQuad(pLayout, DrawX-CursorX, DrawY-CursorY, Size, pChr);
+
+					DrawX += Advance*Size;
+					pCursor->m_CharCount++;
+				}
+			}
+
+			if(NewLine)
+			{
+				DrawX = pCursor->m_StartX;
+				DrawY += Size;
+				GotNewLine = 1;
+				DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+				DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+				++LineCount;
+			}
+		}
+
+		pCursor->m_X = DrawX;
+		pCursor->m_LineCount = LineCount;
+
+		if(GotNewLine)
+			pCursor->m_Y = DrawY;
+		return GotNewLine;
+	}
+
+	void BuildLayout(CTextLayout *pLayout, const CTextCursor *pCursor, const char *pText, int Length, CFont *pFont, CFontSizeData *pSizeData,
+		float Size, float CursorX, float CursorY, float FakeToScreenX, float FakeToScreenY)
+	{
+		// if the atlas had to start over while laying out, the first glyphs are gone, so do it again
+		for(int Try = 0; Try < 2; Try++)
+		{
+			int Generation = pSizeData->m_Generation;
+			CTextCursor Cursor = *pCursor;
+			pLayout->m_NumQuads = 0;
+			pLayout->m_GotNewLine = DoLayout(&Cursor, pText, Length, pFont, pSizeData, Size, CursorX, CursorY, FakeToScreenX, FakeToScreenY, pLayout);
+			pLayout->m_EndX = Cursor.m_X-CursorX;
+			pLayout->m_EndY = Cursor.m_Y-CursorY;
+			pLayout->m_NumLines = Cursor.m_LineCount-pCursor->m_LineCount;
+			pLayout->m_NumChars = Cursor.m_CharCount-pCursor->m_CharCount;
+			pLayout->m_Generation = pSizeData->m_Generation;
+			if(Generation == pSizeData->m_Generation)
+				break;
+		}
+	}
+
+	void RenderLayout(const CTextLayout *pLayout, CFontSizeData *pSizeData, float CursorX, float CursorY)
+	{
+		if(pLayout->m_NumQuads == 0)
+			return;
+
+		float UScale = 1.0f/pSizeData->m_TextureWidth;
+		float VScale = 1.0f/pSizeData->m_TextureHeight;
+		IGraphics::CTexturedQuadItem aItems[64];
+
+		// outline first, then the text itself
+		for(int i = 0; i < 2; i++)
+		{
+			if(i == 0)
+				Graphics()->TextureSet(pSizeData->m_aTextures[1]);
+			else
+				Graphics()->TextureSet(pSizeData->m_aTextures[0]);
+
+			Graphics()->QuadsBegin();
+			if(i == 0)
+				Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
+			else
+				Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
+
+			for(int q = 0; q < pLayout->m_NumQuads; q += 64)
+			{
+				int Num = min(pLayout->m_NumQuads-q, 64);
+				for(int k = 0; k < Num; k++)
+				{
+					const CTextQuad *pQuad = &pLayout->m_pQuads[q+k];
+					IGraphics::CTexturedQuadItem *pItem = &aItems[k];
+					float u0 = pQuad->m_aTexels[0]*UScale, v0 = pQuad->m_aTexels[1]*VScale;
+					float u1 = pQuad->m_aTexels[2]*UScale, v1 = pQuad->m_aTexels[3]*VScale;
+					pItem->m_X = CursorX+pQuad->m_X;
+					pItem->m_Y = CursorY+pQuad->m_Y;
+					pItem->m_Width = pQuad->m_Width;
+					pItem->m_Height = pQuad->m_Height;
+					pItem->m_aU[0] = u0; pItem->m_aV[0] = v0;
+					pItem->m_aU[1] = u1; pItem->m_aV[1] = v0;
+					pItem->m_aU[2] = u1; pItem->m_aV[2] = v1;
+					pItem->m_aU[3] = u0; pItem->m_aV[3] = v1;
+				}
+				Graphics()->QuadsDrawTextured(aItems, Num);
+			}
+
+			Graphics()->QuadsEnd();
+		}
+	}
+
 
 public:
 	CTextRender()
@@ -449,6 +863,23 @@ public:
 
 		m_pDefaultFont = 0;
 
+		for(int i = 0; i < LAYOUT_HASH_SIZE; i++)
+			m_aLayoutHash[i] = -1;
+		m_FirstLayout = -1;
+		m_LastLayout = -1;
+		for(int i = 0; i < LAYOUT_CACHE_SIZE; i++)
+		{
+			m_aLayouts[i].m_Length = -1;
+			m_aLayouts[i].m_pQuads = 0;
+			m_aLayouts[i].m_NumQuads = 0;
+			m_aLayouts[i].m_QuadCapacity = 0;
+			LinkLayoutBack(i);
+		}
+		m_ScratchLayout.m_pQuads = 0;
+		m_ScratchLayout.m_NumQuads = 0;
+		m_ScratchLayout.m_QuadCapacity = 0;
+		m_LayoutDepth = 0;
+
 		// GL_LUMINANCE can be good for debugging
 		//m_FontTextureFormat = GL_ALPHA;
 	}
@@ -482,6 +913,9 @@ public:
 
 	virtual void DestroyFont(CFont *pFont)
 	{
+		ClearLayouts(pFont);
+		for(unsigned i = 0; i < NUM_FONT_SIZES; i++)
+			FreeTexture(&pFont->m_aSizes[i]);
 		mem_free(pFont);
 	}
 
@@ -560,10 +994,6 @@ public:
 		int ActualX, ActualY;
 
 		int ActualSize;
-		int i;
-		int GotNewLine = 0;
-		float DrawX = 0.0f, DrawY = 0.0f;
-		int LineCount = 0;
 		float CursorX, CursorY;
 
 		float Size = pCursor->m_FontSize;
@@ -593,143 +1023,50 @@ public:
 		pSizeData = GetSize(pFont, ActualSize);
 		RenderSetup(pFont, ActualSize);
 
-		float Scale = 1/pSizeData->m_FontSize;
-
 		// set length
 		if(Length < 0)
 			Length = str_length(pText);
 
-		// if we don't want to render, we can just skip the first outline pass
-		i = 1;
-		if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			i = 0;
-
-		for(;i < 2; i++)
+		// texts laid out from a fresh cursor only depend on the text and the size, keep those around
+		CTextLayout *pLayout = 0;
+		if(m_LayoutDepth == 0 && Length <= MAX_LAYOUT_TEXT && pCursor->m_LineCount == 1 &&
+			pCursor->m_X == pCursor->m_StartX && pCursor->m_Y == pCursor->m_StartY)
 		{
-			const char *pCurrent = (char *)pText;
-			const char *pEnd = pCurrent+Length;
-			DrawX = CursorX;
-			DrawY = CursorY;
-			LineCount = pCursor->m_LineCount;
-
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			{
-				// TODO: Make this better
-				if (i == 0)
-					Graphics()->TextureSet(pSizeData->m_aTextures[1]);
-				else
-					Graphics()->TextureSet(pSizeData->m_aTextures[0]);
-
-				Graphics()->QuadsBegin();
-				if (i == 0)
-					Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
-				else
-					Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
-			}
-
-			while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
-			{
-				int NewLine = 0;
-				const char *pBatchEnd = pEnd;
-				if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
-				{
-					int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
-					CTextCursor Compare = *pCursor;
-					Compare.m_X = DrawX;
-					Compare.m_Y = DrawY;
-					Compare.m_Flags &= ~TEXTFLAG_RENDER;
-					Compare.m_LineWidth = -1;
-					TextEx(&Compare, pText, Wlen);
-
-					if(Compare.m_X-DrawX > pCursor->m_LineWidth)
-					{
-						// word can't be fitted in one line, cut it
-						CTextCursor Cutter = *pCursor;
-						Cutter.m_CharCount = 0;
-						Cutter.m_X = DrawX;
-						Cutter.m_Y = DrawY;
-						Cutter.m_Flags &= ~TEXTFLAG_RENDER;
-						Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
-
-						TextEx(&Cutter, (const char *)pCurrent, Wlen);
-						Wlen = Cutter.m_CharCount;
-						NewLine = 1;
-
-						if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
-							Wlen = 0;
-					}
-					else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
-					{
-						NewLine = 1;
-						Wlen = 0;
-					}
-
-					pBatchEnd = pCurrent + Wlen;
-				}
-
-				const char *pTmp = pCurrent;
-				int NextCharacter = str_utf8_decode(&pTmp);
-				while(pCurrent < pBatchEnd)
-				{
-					int Character = NextCharacter;
-					pCurrent = pTmp;
-					NextCharacter = str_utf8_decode(&pTmp);
-
-					if(Character == '\n')
-					{
-						DrawX = pCursor->m_StartX;
-						DrawY += Size;
-						DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-						DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-						++LineCount;
-						if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
-							break;
-						continue;
-					}
-
-					CFontChar *pChr = GetChar(pFont, pSizeData, Character);
-					if(pChr)
-					{
-						float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
-						if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
-						{
-							// we hit the end of the line, no more to render or count
-							pCurrent = pEnd;
-							break;
-						}
-
-						if(pCursor->m_Flags&TEXTFLAG_RENDER)
-						{
-							Graphics()->QuadsSetSubset(pChr->m_aUvs[0], pChr->m_aUvs[1], pChr->m_aUvs[2], pChr->m_aUvs[3]);
-							IGraphics::CQuadItem QuadItem(DrawX+pChr->m_OffsetX*Size, DrawY+pChr->m_OffsetY*Size, pChr->m_Width*Size, pChr->m_Height*Size);
-							Graphics()->QuadsDrawTL(&QuadItem, 1);
-						}
-
-						DrawX += Advance*Size;
-						pCursor->m_CharCount++;
-					}
-				}
-
-				if(NewLine)
-				{
-					DrawX = pCursor->m_StartX;
-					DrawY += Size;
-					GotNewLine = 1;
-					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-					++LineCount;
-				}
-			}
+			unsigned Hash = LayoutHash(pText, Length);
+			int Index = FindLayout(Hash, pText, Length, pFont, ActualSize, pCursor, FakeToScreenX, FakeToScreenY);
+			if(Index < 0)
+				Index = NewLayout(Hash, pText, Length, pFont, ActualSize, pCursor, FakeToScreenX, FakeToScreenY);
+			UnlinkLayout(Index);
+			LinkLayoutFront(Index);
+			pLayout = &m_aLayouts[Index];
+		}
+		else if(m_LayoutDepth == 0 && pCursor->m_Flags&TEXTFLAG_RENDER)
+		{
+			pLayout = &m_ScratchLayout;
+			pLayout->m_Generation = -1;
+		}
 
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-				Graphics()->QuadsEnd();
+		m_LayoutDepth++;
+		if(!pLayout)
+		{
+			// measuring only
+			DoLayout(pCursor, pText, Length, pFont, pSizeData, Size, CursorX, CursorY, FakeToScreenX, FakeToScreenY, 0);
+			m_LayoutDepth--;
+			return;
 		}
 
-		pCursor->m_X = DrawX;
-		pCursor->m_LineCount = LineCount;
+		if(pLayout->m_Generation != pSizeData->m_Generation)
+			BuildLayout(pLayout, pCursor, pText, Length, pFont, pSizeData, Size, CursorX, CursorY, FakeToScreenX, FakeToScreenY);
+		m_LayoutDepth--;
 
-		if(GotNewLine)
-			pCursor->m_Y = DrawY;
+		if(pCursor->m_Flags&TEXTFLAG_RENDER)
+			RenderLayout(pLayout, pSizeData, CursorX, CursorY);
+
+		pCursor->m_X = CursorX+pLayout->m_EndX;
+		pCursor->m_LineCount += pLayout->m_NumLines;
+		pCursor->m_CharCount += pLayout->m_NumChars;
+		if(pLayout->m_GotNewLine)
+			pCursor->m_Y = CursorY+pLayout->m_EndY;
 	}
 
 };
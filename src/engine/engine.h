@@ -26,9 +26,13 @@ public:
 	virtual void Init() = 0;
 	virtual void InitLogfile() = 0;
 	virtual void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype) = 0;
-	virtual void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData) = 0;
+	virtual void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup = 0) = 0;
+	virtual void WaitJob(CJob *pJob) = 0;
+	virtual void WaitJobGroup(CJobGroup *pGroup) = 0;
+	virtual void AddJobContinuation(CJobGroup *pGroup, CJob *pJob, JOBFUNC pfnFunc, void *pData) = 0;
 };
 
-extern IEngine *CreateEngine(const char *pAppname);
+// NumJobThreads 0 sizes the job pool from the number of cores
+extern IEngine *CreateEngine(const char *pAppname, int NumJobThreads = 0);
 
 #endif
@@ -120,6 +120,16 @@ public:
 			: m_X0(x0), m_Y0(y0), m_X1(x1), m_Y1(y1), m_X2(x2), m_Y2(y2), m_X3(x3), m_Y3(y3) {}
 	};
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num) = 0;
+
+	// quad with its own texture coordinates, corners are top left, top right,
+	// bottom right, bottom left. used to submit prebuilt geometry in one call
+	struct CTexturedQuadItem
+	{
+		float m_X, m_Y, m_Width, m_Height;
+		float m_aU[4];
+		float m_aV[4];
+	};
+	virtual void QuadsDrawTextured(const CTexturedQuadItem *pArray, int Num) = 0;
 	virtual void QuadsText(float x, float y, float Size, float r, float g, float b, float a, const char *pText) = 0;
 
 	struct CColorVertex
@@ -156,6 +166,8 @@ public:
 	virtual int WindowActive() = 0;
 	virtual int WindowOpen() = 0;
 
+	// draw calls issued during the last frame and how many were requested before batching
+	virtual void GetDrawStats(int *pDrawCalls, int *pDrawsRequested) = 0;
 };
 
 extern IEngineGraphics *CreateEngineGraphics();
@@ -52,6 +52,9 @@ public:
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
+	// room left in the snapshot being built, within the budget of the client it is for
+	virtual int SnapItemsLeft() = 0;
+	virtual int SnapSizeLeft() = 0;
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
@@ -100,6 +103,7 @@ public:
 	virtual const char *GameType() = 0;
 	virtual const char *Version() = 0;
 	virtual const char *NetVersion() = 0;
+	virtual const char *GetItemName(int Type) = 0;
 
 	// DDRace
 
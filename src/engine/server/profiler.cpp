@@ -0,0 +1,182 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include <engine/console.h>
+
+#include "profiler.h"
+
+const char *CTickProfiler::ms_apPhaseNames[NUM_PHASES] = {
+	"input",
+	"tick",
+	"snap_build",
+	"snap_delta",
+	"snap_compress",
+	"snap_send",
+	"network",
+	"map_download",
+	"frame",
+};
+
+// upper bounds of the histogram buckets in microseconds, the last bucket is open
+const int CTickProfiler::ms_aBucketLimits[NUM_BUCKETS-1] = {100, 250, 500, 1000, 2000, 5000, 10000, 20000};
+
+CTickProfiler::CTickProfiler()
+{
+	Reset();
+}
+
+void CTickProfiler::Reset()
+{
+	mem_zero(m_aHistory, sizeof(m_aHistory));
+	mem_zero(m_aFrame, sizeof(m_aFrame));
+	mem_zero(m_aFrameActive, sizeof(m_aFrameActive));
+	m_Current = 0;
+	m_NumWindows = 0;
+	m_Freq = time_freq();
+	m_FrameStart = time_get();
+	m_aHistory[m_Current].m_Start = m_FrameStart;
+}
+
+void CTickProfiler::BeginFrame()
+{
+	m_FrameStart = time_get();
+}
+
+bool CTickProfiler::EndFrame()
+{
+	int64 Now = time_get();
+	Add(PHASE_FRAME, Now-m_FrameStart);
+
+	CWindow *pWindow = &m_aHistory[m_Current];
+	int64 FrameTime = m_aFrame[PHASE_FRAME]*1000000/m_Freq;
+	bool Slowest = FrameTime > pWindow->m_aStats[PHASE_FRAME].m_Max;
+
+	for(int p = 0; p < NUM_PHASES; p++)
+	{
+		int64 Time = m_aFrame[p]*1000000/m_Freq;
+		if(Slowest)
+			pWindow->m_aSlowestFrame[p] = Time;
+		if(!m_aFrameActive[p])
+			continue;
+
+		CStat *pStat = &pWindow->m_aStats[p];
+		int Bucket = 0;
+		while(Bucket < NUM_BUCKETS-1 && Time >= ms_aBucketLimits[Bucket])
+			Bucket++;
+		pStat->m_Count++;
+		pStat->m_Total += Time;
+		if(Time > pStat->m_Max)
+			pStat->m_Max = Time;
+		pStat->m_aBuckets[Bucket]++;
+
+		m_aFrame[p] = 0;
+		m_aFrameActive[p] = false;
+	}
+
+	if(Now < pWindow->m_Start+m_Freq)
+		return false;
+
+	// start the next second, skip ahead if the server stalled
+	int64 Start = pWindow->m_Start+m_Freq;
+	if(Start+m_Freq <= Now)
+		Start = Now;
+	m_Current = (m_Current+1)%HISTORY_SECONDS;
+	mem_zero(&m_aHistory[m_Current], sizeof(CWindow));
+	m_aHistory[m_Current].m_Start = Start;
+	if(m_NumWindows < HISTORY_SECONDS-1)
+		m_NumWindows++;
+	return true;
+}
+
+void CTickProfiler::Sum(int Seconds, CWindow *pSum) const
+{
+	mem_zero(pSum, sizeof(CWindow));
+	int64 SlowestFrame = -1;
+	for(int i = 1; i <= Seconds; i++)
+	{
+		const CWindow *pWindow = &m_aHistory[(m_Current-i+HISTORY_SECONDS)%HISTORY_SECONDS];
+		for(int p = 0; p < NUM_PHASES; p++)
+		{
+			const CStat *pFrom = &pWindow->m_aStats[p];
+			CStat *pTo = &pSum->m_aStats[p];
+			pTo->m_Count += pFrom->m_Count;
+			pTo->m_Total += pFrom->m_Total;
+			if(pFrom->m_Max > pTo->m_Max)
+				pTo->m_Max = pFrom->m_Max;
+			for(int b = 0; b < NUM_BUCKETS; b++)
+				pTo->m_aBuckets[b] += pFrom->m_aBuckets[b];
+		}
+		if(pWindow->m_aSlowestFrame[PHASE_FRAME] > SlowestFrame)
+		{
+			SlowestFrame = pWindow->m_aSlowestFrame[PHASE_FRAME];
+			mem_copy(pSum->m_aSlowestFrame, pWindow->m_aSlowestFrame, sizeof(pSum->m_aSlowestFrame));
+		}
+	}
+}
+
+void CTickProfiler::Print(IConsole *pConsole, int Seconds) const
+{
+	if(m_NumWindows == 0)
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", "no stats yet");
+		return;
+	}
+	Seconds = clamp(Seconds, 1, m_NumWindows);
+
+	CWindow Total;
+	Sum(Seconds, &Total);
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "last %d second(s), times in microseconds, histogram buckets in ms", Seconds);
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile",
+		"phase          count    avg    max |  <.1 <.25  <.5   <1   <2   <5  <10  <20 >=20");
+	for(int p = 0; p < NUM_PHASES; p++)
+	{
+		const CStat *pStat = &Total.m_aStats[p];
+		int Avg = pStat->m_Count ? (int)(pStat->m_Total/pStat->m_Count) : 0;
+		str_format(aBuf, sizeof(aBuf), "%-13s %6d %6d %6d |", ms_apPhaseNames[p], pStat->m_Count, Avg, (int)pStat->m_Max);
+		for(int b = 0; b < NUM_BUCKETS; b++)
+		{
+			char aBucket[16];
+			str_format(aBucket, sizeof(aBucket), " %4d", pStat->m_aBuckets[b]);
+			str_append(aBuf, aBucket, sizeof(aBuf));
+		}
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+	}
+
+	str_copy(aBuf, "slowest frame:", sizeof(aBuf));
+	for(int p = 0; p < NUM_PHASES; p++)
+	{
+		char aPhase[64];
+		str_format(aPhase, sizeof(aPhase), " %s=%d", ms_apPhaseNames[p], (int)Total.m_aSlowestFrame[p]);
+		str_append(aBuf, aPhase, sizeof(aBuf));
+	}
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+}
+
+void CTickProfiler::Log(IConsole *pConsole, int Tick) const
+{
+	if(m_NumWindows == 0)
+		return;
+
+	// one line per second: phase=count/total_us/max_us/bucket,bucket,...
+	const CWindow *pWindow = &m_aHistory[(m_Current-1+HISTORY_SECONDS)%HISTORY_SECONDS];
+	char aBuf[960];
+	str_format(aBuf, sizeof(aBuf), "gametick=%d", Tick);
+	for(int p = 0; p < NUM_PHASES; p++)
+	{
+		const CStat *pStat = &pWindow->m_aStats[p];
+		char aPhase[128];
+		str_format(aPhase, sizeof(aPhase), " %s=%d/%d/%d/", ms_apPhaseNames[p], pStat->m_Count, (int)pStat->m_Total, (int)pStat->m_Max);
+		for(int b = 0; b < NUM_BUCKETS; b++)
+		{
+			char aBucket[16];
+			str_format(aBucket, sizeof(aBucket), b ? ",%d" : "%d", pStat->m_aBuckets[b]);
+			str_append(aPhase, aBucket, sizeof(aPhase));
+		}
+		str_append(aBuf, aPhase, sizeof(aBuf));
+	}
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+}
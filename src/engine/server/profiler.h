@@ -0,0 +1,91 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_PROFILER_H
+#define ENGINE_SERVER_PROFILER_H
+
+#include <base/system.h>
+
+// keeps per second timing histograms of the phases of the server main loop
+class CTickProfiler
+{
+public:
+	enum
+	{
+		PHASE_INPUT=0,
+		PHASE_TICK,
+		PHASE_SNAP_BUILD,
+		PHASE_SNAP_DELTA,
+		PHASE_SNAP_COMPRESS,
+		PHASE_SNAP_SEND,
+		PHASE_NETWORK, // includes the map download
+		PHASE_MAP_DOWNLOAD,
+		PHASE_FRAME, // one pass of the main loop, without the wait for network data
+		NUM_PHASES,
+
+		NUM_BUCKETS=9,
+		HISTORY_SECONDS=60,
+	};
+
+private:
+	struct CStat
+	{
+		int m_Count;
+		int64 m_Total; // microseconds
+		int64 m_Max;
+		int m_aBuckets[NUM_BUCKETS];
+	};
+
+	struct CWindow
+	{
+		int64 m_Start;
+		CStat m_aStats[NUM_PHASES];
+		int64 m_aSlowestFrame[NUM_PHASES]; // phase times of the slowest frame
+	};
+
+	CWindow m_aHistory[HISTORY_SECONDS];
+	int m_Current;
+	int m_NumWindows; // finished windows in the history
+
+	int64 m_aFrame[NUM_PHASES]; // time spent in the running frame, in time_get units
+	bool m_aFrameActive[NUM_PHASES];
+	int64 m_FrameStart;
+	int64 m_Freq;
+
+	static const char *ms_apPhaseNames[NUM_PHASES];
+	static const int ms_aBucketLimits[NUM_BUCKETS-1];
+
+	void Sum(int Seconds, CWindow *pSum) const;
+
+public:
+	CTickProfiler();
+
+	void Reset();
+
+	void BeginFrame();
+	// returns true when a second of stats is done
+	bool EndFrame();
+
+	void Add(int Phase, int64 Time)
+	{
+		m_aFrame[Phase] += Time;
+		m_aFrameActive[Phase] = true;
+	}
+
+	void Print(class IConsole *pConsole, int Seconds) const;
+	void Log(class IConsole *pConsole, int Tick) const;
+
+	static const char *PhaseName(int Phase) { return ms_apPhaseNames[Phase]; }
+};
+
+class CProfileScope
+{
+	CTickProfiler *m_pProfiler;
+	int m_Phase;
+	int64 m_Start;
+
+public:
+	CProfileScope(CTickProfiler *pProfiler, int Phase) : m_pProfiler(pProfiler), m_Phase(Phase), m_Start(time_get()) {}
+	~CProfileScope() { m_pProfiler->Add(m_Phase, time_get()-m_Start); }
+};
+
+#endif
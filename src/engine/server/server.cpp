@@ -24,6 +24,7 @@
 #include <engine/shared/packer.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/tickrecord.h>
 
 #include <mastersrv/mastersrv.h>
 
@@ -293,6 +294,26 @@ void CServer::CClient::Reset()
 	m_LastInputTick = -1;
 	m_SnapRate = CClient::SNAPRATE_INIT;
 	m_Score = 0;
+
+	m_SnapInterval = 0;
+	m_LastSnapTick = -1;
+	m_SnapWindowStart = -1;
+	m_SnapsSent = 0;
+	m_SnapsAcked = 0;
+	m_SnapBytesSent = 0;
+	m_SnapBytesDelivered = 0;
+	m_SnapsChecked = 0;
+	m_SnapsStalled = 0;
+	m_SnapWindowVital = 0;
+	m_SnapWindowResent = 0;
+	m_SnapGoodWindows = 0;
+	mem_zero(m_aSnapsSent, sizeof(m_aSnapsSent));
+	m_SnapSentIndex = 0;
+	m_ReportSnaps = 0;
+	m_ReportBytesSent = 0;
+	m_ReportBytesDelivered = 0;
+	m_ReportLoss = 0;
+	m_ReportResendLoss = 0;
 }
 
 CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
@@ -300,6 +321,9 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_TickSpeed = SERVER_TICK_SPEED;
 
 	m_pGameServer = 0;
+	m_CostAccounting = false;
+	m_SnapBudget = CSnapshot::MAX_SIZE;
+	m_CostStartTick = 0;
 
 	m_CurrentGameTick = 0;
 	m_RunServer = 1;
@@ -309,6 +333,12 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 
 	m_MapReload = 0;
 
+	m_TickRecordSeed = 0;
+	m_InTick = false;
+	m_Replaying = false;
+	m_aReplayFilename[0] = 0;
+	m_aReplayOutput[0] = 0;
+
 	m_RconClientID = IServer::RCON_CID_SERV;
 	m_RconAuthLevel = AUTHED_ADMIN;
 
@@ -522,6 +552,9 @@ bool CServer::ClientIngame(int ClientID)
 
 int CServer::MaxClients() const
 {
+	// a replay doesn't open the network
+	if(m_Replaying)
+		return g_Config.m_SvMaxClients;
 	return m_NetServer.MaxClients();
 }
 
@@ -556,7 +589,8 @@ int CServer::SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System)
 	if(!(Flags&MSGFLAG_NORECORD))
 		m_DemoRecorder.RecordMessage(pMsg->Data(), pMsg->Size());
 
-	if(!(Flags&MSGFLAG_NOSEND))
+	// nobody is connected to a replay
+	if(!(Flags&MSGFLAG_NOSEND) && !m_Replaying)
 	{
 		if(ClientID == -1)
 		{
@@ -575,13 +609,128 @@ int CServer::SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System)
 	return 0;
 }
 
+int CServer::SnapIntervalBase() const
+{
+	return g_Config.m_SvHighBandwidth ? 1 : 2;
+}
+
+int CServer::SnapIntervalMax() const
+{
+	int BaseInterval = SnapIntervalBase();
+	return max(BaseInterval, g_Config.m_SvSnapIntervalMax/BaseInterval*BaseInterval);
+}
+
+void CServer::CheckSnapStall(CClient *pClient, CClient::CSnapSent *pSent)
+{
+	pSent->m_Checked = true;
+	pClient->m_SnapsChecked++;
+	if(pSent->m_Tick > pClient->m_LastAckedSnapshot)
+		pClient->m_SnapsStalled++;
+}
+
+void CServer::UpdateSnapRate(int ClientID)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	int BaseInterval = SnapIntervalBase();
+	int MaxInterval = SnapIntervalMax();
+
+	// a replay acks every snapshot right away without inputs, keep it at the full rate
+	bool Adaptive = g_Config.m_SvSnapAdaptive && !m_Replaying;
+	if(!Adaptive || pClient->m_SnapInterval == 0)
+		pClient->m_SnapInterval = BaseInterval;
+
+	CNetResendStats Stats;
+	m_NetServer.ClientResendStats(ClientID, &Stats);
+	if(pClient->m_SnapWindowStart < 0)
+	{
+		pClient->m_SnapWindowStart = Tick();
+		pClient->m_SnapWindowVital = Stats.m_NumVital;
+		pClient->m_SnapWindowResent = Stats.m_NumResent;
+	}
+
+	// the client only acks its newest snapshot, once per frame, so a snapshot
+	// isn't lost until no ack covered it by a round trip, the next snapshot and
+	// a slow frame later. that leaves out single lost ones, but catches lost runs
+	// and stalls
+	int Rtt = Stats.m_Rtt >= 0 ? Stats.m_Rtt : 250;
+	int Timeout = (Rtt*TickSpeed()+999)/1000 + pClient->m_SnapInterval + 3;
+	for(int i = 0; i < 32; i++)
+	{
+		CClient::CSnapSent *pSent = &pClient->m_aSnapsSent[i];
+		if(pSent->m_Tick > 0 && !pSent->m_Checked && Tick() >= pSent->m_Tick+Timeout)
+			CheckSnapStall(pClient, pSent);
+	}
+
+	if(Tick() < pClient->m_SnapWindowStart+TickSpeed())
+		return;
+
+	// a window is done
+	int Stalls = pClient->m_SnapsChecked ? pClient->m_SnapsStalled*100/pClient->m_SnapsChecked : 0;
+	int Vital = Stats.m_NumVital-pClient->m_SnapWindowVital;
+	int ResendLoss = Vital >= 8 ? min((Stats.m_NumResent-pClient->m_SnapWindowResent)*100/Vital, 100) : 0;
+	int Seconds = (Tick()-pClient->m_SnapWindowStart)/TickSpeed();
+	pClient->m_ReportSnaps = pClient->m_SnapsSent/Seconds;
+	pClient->m_ReportBytesSent = pClient->m_SnapBytesSent/Seconds;
+	pClient->m_ReportBytesDelivered = pClient->m_SnapBytesDelivered/Seconds;
+	pClient->m_ReportLoss = Stalls;
+	pClient->m_ReportResendLoss = ResendLoss;
+
+	if(Adaptive && pClient->m_SnapRate == CClient::SNAPRATE_FULL && pClient->m_SnapsChecked >= 3)
+	{
+		bool OverCap = g_Config.m_SvSnapRateMax && pClient->m_ReportBytesSent > g_Config.m_SvSnapRateMax;
+		if(Stalls > 5 || ResendLoss > 15 || pClient->m_SnapsAcked == 0 || OverCap)
+		{
+			// the client can't keep up, halve its rate
+			int Interval = pClient->m_SnapInterval*2;
+			if(OverCap)
+				Interval = max(Interval, pClient->m_SnapInterval*pClient->m_ReportBytesSent/g_Config.m_SvSnapRateMax+1);
+			pClient->m_SnapInterval = min((Interval+BaseInterval-1)/BaseInterval*BaseInterval, MaxInterval);
+			pClient->m_SnapGoodWindows = 0;
+		}
+		else if(Stalls < 2 && ResendLoss < 5 && ++pClient->m_SnapGoodWindows >= 2)
+		{
+			// slowly go back up, unless the next step would break the cap
+			int Interval = max(BaseInterval, pClient->m_SnapInterval-BaseInterval);
+			if(!g_Config.m_SvSnapRateMax || pClient->m_ReportBytesSent*pClient->m_SnapInterval/Interval <= g_Config.m_SvSnapRateMax)
+				pClient->m_SnapInterval = Interval;
+			pClient->m_SnapGoodWindows = 0;
+		}
+	}
+	pClient->m_SnapInterval = clamp(pClient->m_SnapInterval, BaseInterval, MaxInterval);
+
+	pClient->m_SnapWindowStart = Tick();
+	pClient->m_SnapWindowVital = Stats.m_NumVital;
+	pClient->m_SnapWindowResent = Stats.m_NumResent;
+	pClient->m_SnapsSent = 0;
+	pClient->m_SnapsAcked = 0;
+	pClient->m_SnapsChecked = 0;
+	pClient->m_SnapsStalled = 0;
+	pClient->m_SnapBytesSent = 0;
+	pClient->m_SnapBytesDelivered = 0;
+}
+
 void CServer::DoSnapshot()
 {
+	// start counting from zero when the cost accounting gets turned on
+	if(g_Config.m_SvCostAccounting && !m_CostAccounting)
+	{
+		mem_zero(m_aSnapDataRate, sizeof(m_aSnapDataRate));
+		mem_zero(m_aSnapDataUpdates, sizeof(m_aSnapDataUpdates));
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			mem_zero(m_aClients[i].m_aSnapDataRate, sizeof(m_aClients[i].m_aSnapDataRate));
+			mem_zero(m_aClients[i].m_aSnapDataUpdates, sizeof(m_aClients[i].m_aSnapDataUpdates));
+		}
+		m_CostStartTick = Tick();
+	}
+	m_CostAccounting = g_Config.m_SvCostAccounting != 0;
+
 	GameServer()->OnPreSnap();
 
 	// create snapshot for demo recording
 	if(m_DemoRecorder.IsRecording())
 	{
+		CProfileScope Profile(&m_Profiler, CTickProfiler::PHASE_SNAP_BUILD);
 		char aData[CSnapshot::MAX_SIZE];
 		int SnapshotSize;
 
@@ -601,6 +750,11 @@ void CServer::DoSnapshot()
 		if(m_aClients[i].m_State != CClient::STATE_INGAME)
 			continue;
 
+		// the client gets snapshots as often as its connection allows
+		UpdateSnapRate(i);
+		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL && Tick()-m_aClients[i].m_LastSnapTick < m_aClients[i].m_SnapInterval)
+			continue;
+
 		// this client is trying to recover, don't spam snapshots
 		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick()%50) != 0)
 			continue;
@@ -621,18 +775,25 @@ void CServer::DoSnapshot()
 			int DeltashotSize;
 			int DeltaTick = -1;
 			int DeltaSize;
+			int64 StageStart = time_get();
+			int64 StageEnd;
 
 			m_SnapshotBuilder.Init();
 
+			// clients can be held below the full size a demo snapshot gets
+			m_SnapBudget = g_Config.m_SvSnapBudget ? min(g_Config.m_SvSnapBudget, (int)CSnapshot::MAX_SIZE) : CSnapshot::MAX_SIZE;
 			GameServer()->OnSnap(i);
+			m_SnapBudget = CSnapshot::MAX_SIZE;
 
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
 			Crc = pData->Crc();
 
 			// remove old snapshos
-			// keep 3 seconds worth of snapshots
-			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick-SERVER_TICK_SPEED*3);
+			// keep 3 seconds worth of snapshots, longer for clients with a lowered rate so they
+			// can still ack one to delta against
+			int KeepTicks = SERVER_TICK_SPEED*3*m_aClients[i].m_SnapInterval/SnapIntervalBase();
+			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick-min(KeepTicks, SERVER_TICK_SPEED*10));
 
 			// save it the snapshot
 			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0);
@@ -647,13 +808,39 @@ void CServer::DoSnapshot()
 				else
 				{
 					// no acked package found, force client to recover rate
+					// and come back from the lowest rate
 					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
+					{
 						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
+						m_aClients[i].m_SnapInterval = SnapIntervalMax();
+					}
 				}
 			}
 
+			StageEnd = time_get();
+			m_Profiler.Add(CTickProfiler::PHASE_SNAP_BUILD, StageEnd-StageStart);
+			StageStart = StageEnd;
+
 			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			if(m_CostAccounting)
+			{
+				int aDataRate[CSnapshotDelta::MAX_ITEMTYPES] = {0};
+				int aDataUpdates[CSnapshotDelta::MAX_ITEMTYPES] = {0};
+				DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData, aDataRate, aDataUpdates);
+				for(int t = 0; t < CSnapshotDelta::MAX_ITEMTYPES; t++)
+				{
+					m_aClients[i].m_aSnapDataRate[t] += aDataRate[t];
+					m_aClients[i].m_aSnapDataUpdates[t] += aDataUpdates[t];
+					m_aSnapDataRate[t] += aDataRate[t];
+					m_aSnapDataUpdates[t] += aDataUpdates[t];
+				}
+			}
+			else
+				DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+
+			StageEnd = time_get();
+			m_Profiler.Add(CTickProfiler::PHASE_SNAP_DELTA, StageEnd-StageStart);
+			StageStart = StageEnd;
 
 			if(DeltaSize)
 			{
@@ -664,6 +851,12 @@ void CServer::DoSnapshot()
 
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData);
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+				m_aClients[i].m_SnapBytesSent += SnapshotSize;
+				m_aClients[i].m_aSnapsSent[m_aClients[i].m_SnapSentIndex].m_Size = SnapshotSize;
+
+				StageEnd = time_get();
+				m_Profiler.Add(CTickProfiler::PHASE_SNAP_COMPRESS, StageEnd-StageStart);
+				StageStart = StageEnd;
 
 				for(int n = 0, Left = SnapshotSize; Left; n++)
 				{
@@ -701,12 +894,40 @@ void CServer::DoSnapshot()
 				Msg.AddInt(m_CurrentGameTick-DeltaTick);
 				SendMsgEx(&Msg, MSGFLAG_FLUSH, i, true);
 			}
+
+			m_Profiler.Add(CTickProfiler::PHASE_SNAP_SEND, time_get()-StageStart);
+
+			// a slot that gets reused before its ack deadline is looked at right away
+			CClient::CSnapSent *pSent = &m_aClients[i].m_aSnapsSent[m_aClients[i].m_SnapSentIndex];
+			if(pSent->m_Tick > 0 && !pSent->m_Checked)
+				CheckSnapStall(&m_aClients[i], pSent);
+			if(!DeltaSize)
+				pSent->m_Size = 0;
+			pSent->m_Tick = m_CurrentGameTick;
+			pSent->m_Checked = false;
+			m_aClients[i].m_SnapSentIndex = (m_aClients[i].m_SnapSentIndex+1)%32;
+			m_aClients[i].m_LastSnapTick = m_CurrentGameTick;
+			m_aClients[i].m_SnapsSent++;
 		}
 	}
 
 	GameServer()->OnPostSnap();
 }
 
+unsigned CServer::WorldHash()
+{
+	// hash the snapshot a demo would get, it holds the whole world state
+	m_SnapshotBuilder.Init();
+	GameServer()->OnSnap(-1);
+	char aData[CSnapshot::MAX_SIZE];
+	int SnapshotSize = m_SnapshotBuilder.Finish(aData);
+
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < SnapshotSize; i++)
+		Hash = (Hash^(unsigned char)aData[i])*16777619u;
+	return Hash;
+}
+
 
 int CServer::NewClientCallback(int ClientID, void *pUser)
 {
@@ -718,6 +939,8 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_Authed = AUTHED_NO;
 	pThis->m_aClients[ClientID].m_AuthTries = 0;
 	pThis->m_aClients[ClientID].m_pRconCmdToSend = 0;
+	mem_zero(pThis->m_aClients[ClientID].m_aSnapDataRate, sizeof(pThis->m_aClients[ClientID].m_aSnapDataRate));
+	mem_zero(pThis->m_aClients[ClientID].m_aSnapDataUpdates, sizeof(pThis->m_aClients[ClientID].m_aSnapDataUpdates));
 	pThis->m_aClients[ClientID].Reset();
 	return 0;
 }
@@ -734,7 +957,12 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 
 	// notify the mod about the drop
 	if(pThis->m_aClients[ClientID].m_State >= CClient::STATE_READY)
+	{
+		// drops from inside a tick happen again on replay
+		if(!pThis->m_InTick)
+			pThis->m_TickRecorder.RecordDrop(ClientID, pReason);
 		pThis->GameServer()->OnClientDrop(ClientID, pReason);
+	}
 
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
 	pThis->m_aClients[ClientID].m_aName[0] = 0;
@@ -881,6 +1109,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			if(m_aClients[ClientID].m_State < CClient::STATE_CONNECTING)
 				return; // no map w/o password, sorry guys
 
+			CProfileScope Profile(&m_Profiler, CTickProfiler::PHASE_MAP_DOWNLOAD);
 			int Chunk = Unpacker.GetInt();
 			int ChunkSize = 1024-128;
 			int Offset = Chunk * ChunkSize;
@@ -934,6 +1163,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player is ready. ClientID=%x addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_READY;
+				m_TickRecorder.RecordClientEvent(CTickRecord::RECORD_CONNECT, ClientID);
 				GameServer()->OnClientConnected(ClientID);
 				SendConnectionReady(ClientID);
 			}
@@ -949,6 +1179,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player has entered the game. ClientID=%x addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				m_TickRecorder.RecordClientEvent(CTickRecord::RECORD_ENTER, ClientID);
 				GameServer()->OnClientEnter(ClientID);
 			}
 		}
@@ -957,6 +1188,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			CClient::CInput *pInput;
 			int64 TagTime;
 
+			int LastAckedSnapshot = m_aClients[ClientID].m_LastAckedSnapshot;
 			m_aClients[ClientID].m_LastAckedSnapshot = Unpacker.GetInt();
 			int IntendedTick = Unpacker.GetInt();
 			int Size = Unpacker.GetInt();
@@ -965,6 +1197,21 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			if(Unpacker.Error() || Size/4 > MAX_INPUT_SIZE)
 				return;
 
+			// count the delivered snapshots for the adaptive snapshot rate. the client
+			// acks only its newest one, the ones it skipped over got there as well
+			if(m_aClients[ClientID].m_LastAckedSnapshot > LastAckedSnapshot)
+			{
+				for(int i = 0; i < 32; i++)
+				{
+					const CClient::CSnapSent *pSent = &m_aClients[ClientID].m_aSnapsSent[i];
+					if(pSent->m_Tick > LastAckedSnapshot && pSent->m_Tick <= m_aClients[ClientID].m_LastAckedSnapshot)
+					{
+						m_aClients[ClientID].m_SnapsAcked++;
+						m_aClients[ClientID].m_SnapBytesDelivered += pSent->m_Size;
+					}
+				}
+			}
+
 			if(m_aClients[ClientID].m_LastAckedSnapshot > 0)
 				m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
 
@@ -1002,7 +1249,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			// call the mod with the fresh input data
 			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+			{
+				m_TickRecorder.RecordDirectInput(ClientID, m_aClients[ClientID].m_Latency, m_aClients[ClientID].m_LatestInput.m_aData);
 				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			}
 		}
 		else if(Msg == NETMSG_RCON_CMD)
 		{
@@ -1013,6 +1263,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				char aBuf[256];
 				str_format(aBuf, sizeof(aBuf), "ClientID=%d rcon='%s'", ClientID, pCmd);
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+				m_TickRecorder.RecordRcon(ClientID, pCmd);
 				m_RconClientID = ClientID;
 				m_RconAuthLevel = m_aClients[ClientID].m_Authed;
 				Console()->SetAccessLevel(m_aClients[ClientID].m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : m_aClients[ClientID].m_Authed == AUTHED_MOD ? IConsole::ACCESS_LEVEL_MOD : IConsole::ACCESS_LEVEL_USER);
@@ -1052,6 +1303,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 					// DDRace
 
+					m_TickRecorder.RecordAuth(ClientID, AUTHED_ADMIN);
 					GameServer()->OnSetAuthed(ClientID, AUTHED_ADMIN);
 				}
 				else if(g_Config.m_SvRconModPassword[0] && str_comp(pPw, g_Config.m_SvRconModPassword) == 0)
@@ -1072,6 +1324,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 					// DDRace
 
+					m_TickRecorder.RecordAuth(ClientID, AUTHED_MOD);
 					GameServer()->OnSetAuthed(ClientID, AUTHED_MOD);
 				}
 				else if(g_Config.m_SvRconMaxTries)
@@ -1125,7 +1378,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	{
 		// game message
 		if(m_aClients[ClientID].m_State >= CClient::STATE_READY)
+		{
+			m_TickRecorder.RecordMessage(ClientID, pPacket->m_pData, pPacket->m_DataSize);
 			GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
 	}
 }
 
@@ -1206,6 +1462,7 @@ void CServer::UpdateServerInfo()
 void CServer::PumpNetwork()
 {
 	CNetChunk Packet;
+	CProfileScope Profile(&m_Profiler, CTickProfiler::PHASE_NETWORK);
 
 	m_NetServer.Update();
 
@@ -1229,6 +1486,7 @@ void CServer::PumpNetwork()
 	}
 	if(g_Config.m_SvFastDownload)
 	{
+		CProfileScope Profile(&m_Profiler, CTickProfiler::PHASE_MAP_DOWNLOAD);
 		for (int i=0;i<MAX_CLIENTS;i++)
 		{
 			if (m_aClients[i].m_State != CClient::STATE_CONNECTING)
@@ -1312,6 +1570,7 @@ int CServer::LoadMap(const char *pMapName)
 
 	// stop recording when we change map
 	m_DemoRecorder.Stop();
+	m_TickRecorder.Stop();
 
 	// reinit snapshot ids
 	m_IDPool.TimeoutIDs();
@@ -1352,6 +1611,9 @@ int CServer::Run()
 	//
 	m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_ConsoleOutputLevel, SendRconLineAuthed, this);
 
+	if(m_aReplayFilename[0])
+		return RunReplay();
+
 	// load map
 	if(!LoadMap(g_Config.m_SvMap))
 	{
@@ -1408,11 +1670,15 @@ int CServer::Run()
 			Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
 		}
 
+		m_Profiler.Reset();
+
 		while(m_RunServer)
 		{
 			int64 t = time_get();
 			int NewTicks = 0;
 
+			m_Profiler.BeginFrame();
+
 			// load new map TODO: don't poll this
 			if(str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload)
 			{
@@ -1453,30 +1719,54 @@ int CServer::Run()
 				m_CurrentGameTick++;
 				NewTicks++;
 
+				// a replay has to get the same random numbers
+				if(m_TickRecorder.IsRecording())
+				{
+					m_TickRecorder.RecordTick(Tick());
+					srand(m_TickRecordSeed+Tick());
+				}
+
 				// apply new input
-				for(int c = 0; c < MAX_CLIENTS; c++)
 				{
-					if(m_aClients[c].m_State == CClient::STATE_EMPTY)
-						continue;
-					for(int i = 0; i < 200; i++)
+					CProfileScope Profile(&m_Profiler, CTickProfiler::PHASE_INPUT);
+					for(int c = 0; c < MAX_CLIENTS; c++)
 					{
-						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
+						if(m_aClients[c].m_State == CClient::STATE_EMPTY)
+							continue;
+						for(int i = 0; i < 200; i++)
 						{
-							if(m_aClients[c].m_State == CClient::STATE_INGAME)
-								GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
+							if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
+							{
+								if(m_aClients[c].m_State == CClient::STATE_INGAME)
+								{
+									m_TickRecorder.RecordInput(c, m_aClients[c].m_aInputs[i].m_aData);
+									GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
+								}
+								break;
+							}
 						}
 					}
 				}
 
-				GameServer()->OnTick();
+				{
+					CProfileScope Profile(&m_Profiler, CTickProfiler::PHASE_TICK);
+					m_InTick = true;
+					GameServer()->OnTick();
+					m_InTick = false;
+				}
+
+				if(m_TickRecorder.IsRecording())
+					m_TickRecorder.RecordTickEnd(WorldHash());
 			}
 
 			// snap game
 			if(NewTicks)
 			{
 				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+				{
 					DoSnapshot();
+					m_TickRecorder.RecordSnapshot();
+				}
 
 				UpdateClientRconCommands();
 			}
@@ -1511,6 +1801,9 @@ int CServer::Run()
 				ReportTime += time_freq()*ReportInterval;
 			}
 
+			if(m_Profiler.EndFrame() && g_Config.m_SvProfileLog)
+				m_Profiler.Log(Console(), Tick());
+
 			// wait for incomming data
 			net_socket_read_wait(m_NetServer.Socket(), 5);
 		}
@@ -1524,6 +1817,7 @@ int CServer::Run()
 		m_Econ.Shutdown();
 	}
 
+	m_TickRecorder.Stop();
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
 
@@ -1532,6 +1826,232 @@ int CServer::Run()
 	return 0;
 }
 
+int CServer::RunReplay()
+{
+	enum
+	{
+		PHASE_INPUT=0,
+		PHASE_TICK,
+		PHASE_SNAP,
+		NUM_PHASES
+	};
+	static const char *s_apPhaseNames[NUM_PHASES] = {"input", "tick", "snap"};
+
+	CTickPlayer Player;
+	if(Player.Load(Storage(), Console(), m_aReplayFilename) != 0)
+		return -1;
+
+	char aBuf[256];
+	if(str_comp(Player.NetVersion(), GameServer()->NetVersion()) != 0)
+	{
+		str_format(aBuf, sizeof(aBuf), "recorded with version '%s', running '%s'", Player.NetVersion(), GameServer()->NetVersion());
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	}
+
+	str_copy(g_Config.m_SvMap, Player.MapName(), sizeof(g_Config.m_SvMap));
+	if(!LoadMap(Player.MapName()))
+	{
+		dbg_msg("replay", "failed to load map. mapname='%s'", Player.MapName());
+		return -1;
+	}
+	if(m_CurrentMapCrc != Player.MapCrc())
+	{
+		str_format(aBuf, sizeof(aBuf), "map crc is %08x, the record was made on %08x", m_CurrentMapCrc, Player.MapCrc());
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	}
+
+	IOHANDLE OutputFile = 0;
+	if(m_aReplayOutput[0])
+	{
+		OutputFile = Storage()->OpenFile(m_aReplayOutput, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!OutputFile)
+		{
+			str_format(aBuf, sizeof(aBuf), "couldn't open '%s' for writing", m_aReplayOutput);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+		}
+		else
+		{
+			str_copy(aBuf, "tick input_us tick_us snap_us hash match\n", sizeof(aBuf));
+			io_write(OutputFile, aBuf, str_length(aBuf));
+		}
+	}
+
+	// the clients only live in the record, nothing goes out to the network
+	m_Replaying = true;
+	m_NetServer.SetCallbacks(NewClientCallback, DelClientCallback, this);
+	GameServer()->OnInit();
+	m_pConsole->StoreCommands(false);
+	m_GameStartTime = time_get();
+
+	int64 aTickTime[NUM_PHASES] = {0};
+	int64 aTotalTime[NUM_PHASES] = {0};
+	int64 aMaxTime[NUM_PHASES] = {0};
+	unsigned TickHash = 0;
+	bool TickMatch = true;
+	bool TickPending = false;
+	int NumTicks = 0;
+	int NumMismatches = 0;
+	int FirstMismatch = -1;
+	int64 StartTime = time_get();
+
+	CTickPlayer::CRecord Record;
+	bool Done = false;
+	while(!Done)
+	{
+		Done = !Player.NextRecord(&Record);
+
+		// a new tick starts, report the last one
+		if(TickPending && (Done || Record.m_Type == CTickRecord::RECORD_TICK))
+		{
+			for(int i = 0; i < NUM_PHASES; i++)
+			{
+				aTotalTime[i] += aTickTime[i];
+				aMaxTime[i] = max(aMaxTime[i], aTickTime[i]);
+			}
+			if(OutputFile)
+			{
+				str_format(aBuf, sizeof(aBuf), "%d %d %d %d %08x %d\n", Tick(),
+					(int)(aTickTime[PHASE_INPUT]*1000000/time_freq()), (int)(aTickTime[PHASE_TICK]*1000000/time_freq()),
+					(int)(aTickTime[PHASE_SNAP]*1000000/time_freq()), TickHash, TickMatch);
+				io_write(OutputFile, aBuf, str_length(aBuf));
+			}
+			for(int i = 0; i < NUM_PHASES; i++)
+				aTickTime[i] = 0;
+			NumTicks++;
+			TickPending = false;
+		}
+		if(Done)
+			break;
+
+		int ClientID = Record.m_ClientID;
+		int64 RecordStart = time_get();
+		int Phase = PHASE_INPUT;
+
+		switch(Record.m_Type)
+		{
+		case CTickRecord::RECORD_TICK:
+			m_CurrentGameTick = Record.m_Tick;
+			srand(Player.Seed()+Tick());
+			TickPending = true;
+			break;
+		case CTickRecord::RECORD_INPUT:
+		case CTickRecord::RECORD_INPUT_SAME:
+			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+				GameServer()->OnClientPredictedInput(ClientID, Record.m_aInput);
+			break;
+		case CTickRecord::RECORD_TICK_END:
+			Phase = PHASE_TICK;
+			m_InTick = true;
+			GameServer()->OnTick();
+			m_InTick = false;
+			aTickTime[Phase] += time_get()-RecordStart;
+			Phase = -1;
+
+			// the hash isn't part of the timings
+			TickHash = WorldHash();
+			TickMatch = TickHash == Record.m_Hash;
+			if(!TickMatch)
+			{
+				if(FirstMismatch < 0)
+					FirstMismatch = Tick();
+				NumMismatches++;
+			}
+			break;
+		case CTickRecord::RECORD_SNAP:
+			Phase = PHASE_SNAP;
+			DoSnapshot();
+			// ack right away so the deltas stay as small as online
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				if(m_aClients[i].m_State == CClient::STATE_INGAME)
+				{
+					m_aClients[i].m_LastAckedSnapshot = Tick();
+					m_aClients[i].m_SnapRate = CClient::SNAPRATE_FULL;
+				}
+			}
+			break;
+		case CTickRecord::RECORD_DIRECT_INPUT:
+			// the game shows the latency, it has to match too
+			m_aClients[ClientID].m_Latency = Record.m_Latency;
+			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+				GameServer()->OnClientDirectInput(ClientID, Record.m_aInput);
+			break;
+		case CTickRecord::RECORD_CONNECT:
+			NewClientCallback(ClientID, this);
+			m_aClients[ClientID].m_State = CClient::STATE_READY;
+			GameServer()->OnClientConnected(ClientID);
+			break;
+		case CTickRecord::RECORD_ENTER:
+			if(m_aClients[ClientID].m_State == CClient::STATE_READY)
+			{
+				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				GameServer()->OnClientEnter(ClientID);
+			}
+			break;
+		case CTickRecord::RECORD_DROP:
+			// the client might already be kicked by the replay itself
+			if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY)
+				DelClientCallback(ClientID, Record.m_pString, this);
+			break;
+		case CTickRecord::RECORD_MESSAGE:
+			if(m_aClients[ClientID].m_State >= CClient::STATE_READY)
+			{
+				CUnpacker Unpacker;
+				Unpacker.Reset(Record.m_pData, Record.m_DataSize);
+				int Msg = Unpacker.GetInt();
+				if(!Unpacker.Error() && (Msg&1) == 0)
+					GameServer()->OnMessage(Msg>>1, &Unpacker, ClientID);
+			}
+			break;
+		case CTickRecord::RECORD_AUTH:
+			m_aClients[ClientID].m_Authed = Record.m_Level;
+			GameServer()->OnSetAuthed(ClientID, Record.m_Level);
+			break;
+		case CTickRecord::RECORD_RCON:
+			if(m_aClients[ClientID].m_Authed)
+			{
+				m_RconClientID = ClientID;
+				m_RconAuthLevel = m_aClients[ClientID].m_Authed;
+				Console()->SetAccessLevel(m_aClients[ClientID].m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : m_aClients[ClientID].m_Authed == AUTHED_MOD ? IConsole::ACCESS_LEVEL_MOD : IConsole::ACCESS_LEVEL_USER);
+				Console()->ExecuteLineFlag(Record.m_pString, CFGFLAG_SERVER, ClientID);
+				Console()->SetAccessLevel(IConsole::ACCESS_LEVEL_ADMIN);
+				m_RconClientID = IServer::RCON_CID_SERV;
+				m_RconAuthLevel = AUTHED_ADMIN;
+			}
+			break;
+		}
+
+		if(Phase >= 0)
+			aTickTime[Phase] += time_get()-RecordStart;
+	}
+
+	float Seconds = (time_get()-StartTime)/(float)time_freq();
+	str_format(aBuf, sizeof(aBuf), "replayed %d ticks in %.2fs, %.1f times real time", NumTicks, Seconds,
+		Seconds > 0 ? NumTicks/(float)SERVER_TICK_SPEED/Seconds : 0.0f);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	for(int i = 0; i < NUM_PHASES; i++)
+	{
+		str_format(aBuf, sizeof(aBuf), "%s: avg=%.3fms max=%.3fms", s_apPhaseNames[i],
+			NumTicks ? aTotalTime[i]*1000.0f/time_freq()/NumTicks : 0.0f, aMaxTime[i]*1000.0f/time_freq());
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	}
+	if(NumMismatches)
+		str_format(aBuf, sizeof(aBuf), "world hash differs in %d ticks, first at tick %d", NumMismatches, FirstMismatch);
+	else
+		str_copy(aBuf, "world hash matches in every tick", sizeof(aBuf));
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+
+	if(OutputFile)
+		io_close(OutputFile);
+
+	GameServer()->OnShutdown();
+	m_pMap->Unload();
+
+	if(m_pCurrentMapData)
+		mem_free(m_pCurrentMapData);
+	return NumMismatches ? 1 : 0;
+}
+
 void CServer::ConKick(IConsole::IResult *pResult, void *pUser)
 {
 	if(pResult->NumArguments() > 1)
@@ -1565,6 +2085,44 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ConNetStats(IConsole::IResult *pResult, void *pUser)
+{
+	char aBuf[256];
+	CServer *pThis = static_cast<CServer *>(pUser);
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pThis->m_aClients[i].m_State == CClient::STATE_EMPTY)
+			continue;
+
+		CNetResendStats Stats;
+		pThis->m_NetServer.ClientResendStats(i, &Stats);
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' rtt=%dms rttvar=%dms rto=%dms vital=%d resent=%d (%d%%) resend_requests=%d timeouts=%d",
+			i, pThis->ClientName(i), Stats.m_Rtt, Stats.m_RttVar, Stats.m_Rto, Stats.m_NumVital, Stats.m_NumResent,
+			Stats.m_NumVital ? Stats.m_NumResent*100/Stats.m_NumVital : 0, Stats.m_NumResendRequests, Stats.m_NumTimeouts);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "Server", aBuf);
+	}
+}
+
+void CServer::ConSnapRates(IConsole::IResult *pResult, void *pUser)
+{
+	char aBuf[256];
+	CServer *pThis = static_cast<CServer *>(pUser);
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CClient *pClient = &pThis->m_aClients[i];
+		if(pClient->m_State != CClient::STATE_INGAME)
+			continue;
+
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' interval=%d snaps/s=%d sent=%dB/s delivered=%dB/s stalls=%d%% resends=%d%% latency=%dms%s",
+			i, pClient->m_aName, pClient->m_SnapInterval, pClient->m_ReportSnaps, pClient->m_ReportBytesSent,
+			pClient->m_ReportBytesDelivered, pClient->m_ReportLoss, pClient->m_ReportResendLoss, pClient->m_Latency,
+			pClient->m_SnapRate == CClient::SNAPRATE_RECOVER ? " recovering" : "");
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "Server", aBuf);
+	}
+}
+
 void CServer::ConShutdown(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_RunServer = 0;
@@ -1615,6 +2173,119 @@ void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
 	((CServer *)pUser)->m_DemoRecorder.Stop();
 }
 
+void CServer::ConRecordTicks(IConsole::IResult *pResult, void *pUser)
+{
+	CServer* pServer = (CServer *)pUser;
+	char aFilename[128];
+
+	// a replay starts with an empty world
+	if(pServer->Tick() != 0)
+	{
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "tick_recorder", "Tick records have to start with the map, give the command on the command line");
+		return;
+	}
+
+	if(pResult->NumArguments())
+		str_format(aFilename, sizeof(aFilename), "ticks/%s.ticks", pResult->GetString(0));
+	else
+	{
+		char aDate[20];
+		str_timestamp(aDate, sizeof(aDate));
+		str_format(aFilename, sizeof(aFilename), "ticks/ticks_%s.ticks", aDate);
+	}
+
+	unsigned Seed = (unsigned)time_get();
+	if(pServer->m_TickRecorder.Start(pServer->Storage(), pServer->Console(), aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_CurrentMapCrc, Seed) == 0)
+		pServer->m_TickRecordSeed = Seed;
+}
+
+void CServer::ConProfile(IConsole::IResult *pResult, void *pUser)
+{
+	((CServer *)pUser)->m_Profiler.Print(((CServer *)pUser)->Console(), pResult->NumArguments() ? pResult->GetInteger(0) : 1);
+}
+
+void CServer::ConSnapCosts(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = (CServer *)pUser;
+	if(!pThis->m_CostAccounting)
+	{
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", "cost accounting is off, enable it with sv_cost_accounting 1");
+		return;
+	}
+
+	int ClientID = pResult->NumArguments() ? pResult->GetInteger(0) : -1;
+	if(ClientID >= MAX_CLIENTS || (ClientID >= 0 && pThis->m_aClients[ClientID].m_State == CClient::STATE_EMPTY))
+	{
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", "invalid client id");
+		return;
+	}
+
+	char aBuf[256];
+	int Seconds = max(1, (pThis->Tick()-pThis->m_CostStartTick)/pThis->TickSpeed());
+	const int64 *pDataRate = ClientID < 0 ? pThis->m_aSnapDataRate : pThis->m_aClients[ClientID].m_aSnapDataRate;
+	const int64 *pDataUpdates = ClientID < 0 ? pThis->m_aSnapDataUpdates : pThis->m_aClients[ClientID].m_aSnapDataUpdates;
+	if(ClientID < 0)
+		str_format(aBuf, sizeof(aBuf), "snapshot data of all clients over %d seconds", Seconds);
+	else
+		str_format(aBuf, sizeof(aBuf), "snapshot data of '%s' (%d) over %d seconds", pThis->ClientName(ClientID), ClientID, Seconds);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+
+	int64 TotalRate = 0;
+	for(int t = 0; t < CSnapshotDelta::MAX_ITEMTYPES; t++)
+	{
+		if(!pDataUpdates[t])
+			continue;
+		TotalRate += pDataRate[t];
+		str_format(aBuf, sizeof(aBuf), "%3d %-20s bytes/s=%-8d items/s=%-6d bytes/item=%d", t, pThis->GameServer()->GetItemName(t),
+			(int)(pDataRate[t]/8/Seconds), (int)(pDataUpdates[t]/Seconds), (int)(pDataRate[t]/8/pDataUpdates[t]));
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+	}
+	str_format(aBuf, sizeof(aBuf), "total bytes/s=%d, before compression", (int)(TotalRate/8/Seconds));
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+
+	if(ClientID >= 0)
+		return;
+
+	// the clients that cost the most come first
+	bool aListed[MAX_CLIENTS] = {false};
+	while(1)
+	{
+		int Worst = -1;
+		int64 WorstRate = 0;
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(aListed[c] || pThis->m_aClients[c].m_State == CClient::STATE_EMPTY)
+				continue;
+			int64 Rate = 0;
+			for(int t = 0; t < CSnapshotDelta::MAX_ITEMTYPES; t++)
+				Rate += pThis->m_aClients[c].m_aSnapDataRate[t];
+			if(Worst == -1 || Rate > WorstRate)
+			{
+				Worst = c;
+				WorstRate = Rate;
+			}
+		}
+		if(Worst == -1)
+			break;
+		aListed[Worst] = true;
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' bytes/s=%d", Worst, pThis->ClientName(Worst), (int)(WorstRate/8/Seconds));
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+	}
+}
+
+void CServer::ConStopRecordTicks(IConsole::IResult *pResult, void *pUser)
+{
+	((CServer *)pUser)->m_TickRecorder.Stop();
+}
+
+void CServer::ConReplayTicks(IConsole::IResult *pResult, void *pUser)
+{
+	CServer* pServer = (CServer *)pUser;
+	str_copy(pServer->m_aReplayFilename, pResult->GetString(0), sizeof(pServer->m_aReplayFilename));
+	if(pResult->NumArguments() > 1)
+		str_copy(pServer->m_aReplayOutput, pResult->GetString(1), sizeof(pServer->m_aReplayOutput));
+}
+
 void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_MapReload = 1;
@@ -1704,12 +2375,19 @@ void CServer::RegisterCommands()
 	// register console commands
 	Console()->Register("kick", "i?r", CFGFLAG_SERVER, ConKick, this, "Kick player with specified id for any reason");
 	Console()->Register("status", "", CFGFLAG_SERVER, ConStatus, this, "List players");
+	Console()->Register("net_stats", "", CFGFLAG_SERVER, ConNetStats, this, "List the round trip times and resends of the connections");
+	Console()->Register("snap_rates", "", CFGFLAG_SERVER, ConSnapRates, this, "List the snapshot interval, data rates and snapshot loss of the clients");
 	Console()->Register("shutdown", "", CFGFLAG_SERVER, ConShutdown, this, "Shut down");
 	Console()->Register("logout", "", CFGFLAG_SERVER, ConLogout, this, "Logout of rcon");
 
 	Console()->Register("record", "?s", CFGFLAG_SERVER|CFGFLAG_STORE, ConRecord, this, "Record to a file");
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
+	Console()->Register("record_ticks", "?s", CFGFLAG_SERVER|CFGFLAG_STORE, ConRecordTicks, this, "Record client inputs and events for an offline replay");
+	Console()->Register("stoprecord_ticks", "", CFGFLAG_SERVER, ConStopRecordTicks, this, "Stop recording client inputs and events");
+	Console()->Register("replay_ticks", "s?s", CFGFLAG_SERVER, ConReplayTicks, this, "Replay a tick record as fast as possible instead of running the server, optionally writing per tick timings to a file (command line only)");
 
+	Console()->Register("profile", "?i", CFGFLAG_SERVER, ConProfile, this, "Show the time spent in each phase of the main loop over the last x seconds (max 59)");
+	Console()->Register("snap_costs", "?i", CFGFLAG_SERVER, ConSnapCosts, this, "Show the snapshot data sent per item type, of all clients or of one client, while sv_cost_accounting is on");
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
@@ -1743,6 +2421,16 @@ void *CServer::SnapNewItem(int Type, int ID, int Size)
 	return ID < 0 ? 0 : m_SnapshotBuilder.NewItem(Type, ID, Size);
 }
 
+int CServer::SnapItemsLeft()
+{
+	return CSnapshotBuilder::MAX_ITEMS-1 - m_SnapshotBuilder.NumItems();
+}
+
+int CServer::SnapSizeLeft()
+{
+	return max(m_SnapBudget - m_SnapshotBuilder.SnapSize(), 0);
+}
+
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
@@ -9,7 +9,9 @@
 #include <engine/shared/demo.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/tickrecord.h>
 #include <engine/shared/network.h>
+#include <engine/server/profiler.h>
 #include <engine/server/register.h>
 #include <engine/shared/console.h>
 #include <base/math.h>
@@ -113,6 +115,14 @@ public:
 			int m_GameTick; // the tick that was chosen for the input
 		};
 
+		class CSnapSent
+		{
+		public:
+			int m_Tick;
+			int m_Size;
+			bool m_Checked; // looked at for an ack stall
+		};
+
 		// connection state info
 		int m_State;
 		int m_Latency;
@@ -122,6 +132,29 @@ public:
 		int m_LastInputTick;
 		CSnapshotStorage m_Snapshots;
 
+		// adaptive snapshot rate, measured over windows of a second
+		int m_SnapInterval; // ticks between two snapshots
+		int m_LastSnapTick;
+		int m_SnapWindowStart;
+		int m_SnapsSent;
+		int m_SnapsAcked;
+		int m_SnapBytesSent;
+		int m_SnapBytesDelivered;
+		int m_SnapsChecked;
+		int m_SnapsStalled; // no ack covered them in time
+		int m_SnapWindowVital; // resend stats of the connection at the window start
+		int m_SnapWindowResent;
+		int m_SnapGoodWindows;
+		CSnapSent m_aSnapsSent[32]; // to find the size of acked snapshots
+		int m_SnapSentIndex;
+
+		// the last finished window, for snap_rates
+		int m_ReportSnaps;
+		int m_ReportBytesSent;
+		int m_ReportBytesDelivered;
+		int m_ReportLoss; // stalled snapshots in percent
+		int m_ReportResendLoss; // resent vital chunks in percent
+
 		CInput m_LatestInput;
 		CInput m_aInputs[200]; // TODO: handle input better
 		int m_CurrentInput;
@@ -135,13 +168,22 @@ public:
 
 		const IConsole::CCommandInfo *m_pRconCmdToSend;
 
+		// snapshot bits and items sent per item type, while sv_cost_accounting is on
+		int64 m_aSnapDataRate[CSnapshotDelta::MAX_ITEMTYPES];
+		int64 m_aSnapDataUpdates[CSnapshotDelta::MAX_ITEMTYPES];
+
 		void Reset();
 	};
 
 	CClient m_aClients[MAX_CLIENTS];
 
 	CSnapshotDelta m_SnapshotDelta;
+	bool m_CostAccounting;
+	int m_CostStartTick;
+	int64 m_aSnapDataRate[CSnapshotDelta::MAX_ITEMTYPES];
+	int64 m_aSnapDataUpdates[CSnapshotDelta::MAX_ITEMTYPES];
 	CSnapshotBuilder m_SnapshotBuilder;
+	int m_SnapBudget; // bytes the snapshot being built may use
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
@@ -166,6 +208,13 @@ public:
 	int m_CurrentMapSize;
 
 	CDemoRecorder m_DemoRecorder;
+	CTickRecorder m_TickRecorder;
+	unsigned m_TickRecordSeed;
+	bool m_InTick;
+	bool m_Replaying;
+	char m_aReplayFilename[128];
+	char m_aReplayOutput[128];
+	CTickProfiler m_Profiler;
 	CRegister m_Register;
 	CMapChecker m_MapChecker;
 
@@ -202,7 +251,12 @@ public:
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
 	int SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System);
 
+	int SnapIntervalBase() const;
+	int SnapIntervalMax() const;
+	void CheckSnapStall(CClient *pClient, CClient::CSnapSent *pSent);
+	void UpdateSnapRate(int ClientID);
 	void DoSnapshot();
+	unsigned WorldHash();
 
 	static int NewClientCallback(int ClientID, void *pUser);
 	static int DelClientCallback(int ClientID, const char *pReason, void *pUser);
@@ -228,12 +282,20 @@ public:
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
 	int Run();
+	int RunReplay();
 
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
 	static void ConStatus(IConsole::IResult *pResult, void *pUser);
+	static void ConNetStats(IConsole::IResult *pResult, void *pUser);
+	static void ConSnapRates(IConsole::IResult *pResult, void *pUser);
 	static void ConShutdown(IConsole::IResult *pResult, void *pUser);
 	static void ConRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConStopRecord(IConsole::IResult *pResult, void *pUser);
+	static void ConRecordTicks(IConsole::IResult *pResult, void *pUser);
+	static void ConStopRecordTicks(IConsole::IResult *pResult, void *pUser);
+	static void ConReplayTicks(IConsole::IResult *pResult, void *pUser);
+	static void ConProfile(IConsole::IResult *pResult, void *pUser);
+	static void ConSnapCosts(IConsole::IResult *pResult, void *pUser);
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -247,6 +309,8 @@ public:
 	virtual int SnapNewID();
 	virtual void SnapFreeID(int ID);
 	virtual void *SnapNewItem(int Type, int ID, int Size);
+	virtual int SnapItemsLeft();
+	virtual int SnapSizeLeft();
 	void SnapSetStaticsize(int ItemType, int Size);
 
 	// DDRace
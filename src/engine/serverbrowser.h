@@ -93,6 +93,9 @@ public:
 	virtual int NumSortedServers() const = 0;
 	virtual const CServerInfo *SortedGet(int Index) const = 0;
 
+	// hint which entries of the sorted list are on screen, their infos get requested first
+	virtual void SetVisibleRange(int First, int Num) = 0;
+
 	virtual bool IsFavorite(const NETADDR &Addr) const = 0;
 	virtual void AddFavorite(const NETADDR &Addr) = 0;
 	virtual void RemoveFavorite(const NETADDR &Addr) = 0;
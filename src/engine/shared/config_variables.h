@@ -18,6 +18,8 @@ MACRO_CONFIG_INT(ConsoleOutputLevel, console_output_level, 0, 0, 2, CFGFLAG_CLIE
 MACRO_CONFIG_INT(ClCpuThrottle, cl_cpu_throttle, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "")
 MACRO_CONFIG_INT(ClEditor, cl_editor, 0, 0, 1, CFGFLAG_CLIENT, "")
 MACRO_CONFIG_INT(ClLoadCountryFlags, cl_load_country_flags, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Load and show country flags")
+MACRO_CONFIG_INT(ClAssetCache, cl_asset_cache, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Keep decoded images and sounds in a cache folder to speed up loading")
+MACRO_CONFIG_INT(ClAssetCacheSize, cl_asset_cache_size, 256, 16, 16384, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Maximum size of the asset cache folder in MiB, the oldest entries are removed first")
 
 MACRO_CONFIG_INT(ClAutoDemoRecord, cl_auto_demo_record, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Automatically record demos")
 MACRO_CONFIG_INT(ClAutoDemoMax, cl_auto_demo_max, 10, 0, 1000, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Maximum number of automatically recorded demos (0 = no limit)")
@@ -74,17 +76,26 @@ MACRO_CONFIG_INT(GfxFinish, gfx_finish, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, ""
 MACRO_CONFIG_INT(GfxAsyncRender, gfx_asyncrender, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Do rendering async from the the update")
 
 MACRO_CONFIG_INT(GfxThreaded, gfx_threaded, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Use the threaded graphics backend")
+MACRO_CONFIG_INT(GfxBatching, gfx_batching, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Collect the draws of a frame and merge those with equal state (threaded backend only)")
+MACRO_CONFIG_INT(GfxNull, gfx_null, 0, 0, 1, CFGFLAG_CLIENT, "Use the null graphics backend that only counts commands (headless, implies gfx_threaded)")
 
 MACRO_CONFIG_INT(InpMousesens, inp_mousesens, 100, 5, 100000, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Mouse sensitivity")
 
 MACRO_CONFIG_STR(SvName, sv_name, 128, "unnamed server", CFGFLAG_SERVER, "Server name")
 MACRO_CONFIG_STR(Bindaddr, bindaddr, 128, "", CFGFLAG_CLIENT|CFGFLAG_SERVER|CFGFLAG_MASTER, "Address to bind the client/server to")
+MACRO_CONFIG_INT(MsRequestRate, ms_request_rate, 100, 0, 100000, CFGFLAG_MASTER, "List packets per second a /24 (ipv6 /64) may request from the master server. 0 to disable the limit")
+MACRO_CONFIG_INT(MsRequestBurst, ms_request_burst, 400, 1, 100000, CFGFLAG_MASTER, "List packets a /24 (ipv6 /64) may request at once from the master server")
+MACRO_CONFIG_INT(MsFloodBantime, ms_flood_bantime, 600, 0, 86400, CFGFLAG_MASTER, "Seconds a range that keeps flooding the master server with requests gets banned. 0 to disable")
 MACRO_CONFIG_INT(SvPort, sv_port, 8303, 0, 0, CFGFLAG_SERVER, "Port to use for the server")
 MACRO_CONFIG_INT(SvExternalPort, sv_external_port, 0, 0, 0, CFGFLAG_SERVER, "External port to report to the master servers")
 MACRO_CONFIG_STR(SvMap, sv_map, 128, "dm1", CFGFLAG_SERVER, "Map to use on the server")
 MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 16, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Maximum number of clients that are allowed on a server")
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 2, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
+MACRO_CONFIG_INT(SvSnapAdaptive, sv_snap_adaptive, 1, 0, 1, CFGFLAG_SERVER, "Lower the snapshot rate of clients whose connection can't keep up")
+MACRO_CONFIG_INT(SvSnapIntervalMax, sv_snap_interval_max, 10, 1, 50, CFGFLAG_SERVER, "Most ticks between two snapshots for clients with a lowered snapshot rate")
+MACRO_CONFIG_INT(SvSnapRateMax, sv_snap_rate_max, 0, 0, 1000000, CFGFLAG_SERVER, "Snapshot bytes per second a client may get, the snapshot rate is lowered above. 0 for no limit")
+MACRO_CONFIG_INT(SvSnapBudget, sv_snap_budget, 0, 0, 65536, CFGFLAG_SERVER, "Snapshot bytes a client may get per snapshot, entities are picked by priority above. 0 for the 64KiB limit")
 MACRO_CONFIG_INT(SvRegister, sv_register, 1, 0, 1, CFGFLAG_SERVER, "Register server with master server for public listing")
 MACRO_CONFIG_STR(SvRconPassword, sv_rcon_password, 32, "", CFGFLAG_SERVER, "Remote console password (full access)")
 MACRO_CONFIG_STR(SvRconModPassword, sv_rcon_mod_password, 32, "", CFGFLAG_SERVER, "Remote console password for moderators (limited access)")
@@ -105,8 +116,11 @@ MACRO_CONFIG_INT(DbgStress, dbg_stress, 0, 0, 0, CFGFLAG_CLIENT|CFGFLAG_SERVER,
 MACRO_CONFIG_INT(DbgStressNetwork, dbg_stress_network, 0, 0, 0, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Stress network")
 MACRO_CONFIG_INT(DbgPref, dbg_pref, 0, 0, 1, CFGFLAG_SERVER, "Performance outputs")
 MACRO_CONFIG_INT(DbgGraphs, dbg_graphs, 0, 0, 1, CFGFLAG_CLIENT, "Performance graphs")
+MACRO_CONFIG_INT(SvProfileLog, sv_profile_log, 0, 0, 1, CFGFLAG_SERVER, "Log the main loop phase timings of every second in one machine readable line")
+MACRO_CONFIG_INT(SvCostAccounting, sv_cost_accounting, 0, 0, 1, CFGFLAG_SERVER, "Account the time used per entity type and owning client and the snapshot data per item type and client")
 MACRO_CONFIG_INT(DbgHitch, dbg_hitch, 0, 0, 0, CFGFLAG_SERVER, "Hitch warnings")
 MACRO_CONFIG_STR(DbgStressServer, dbg_stress_server, 32, "localhost", CFGFLAG_CLIENT, "Server to stress")
+MACRO_CONFIG_STR(DbgBench, dbg_bench, 128, "", CFGFLAG_CLIENT, "Play this demo, report per component frame times and quit")
 MACRO_CONFIG_INT(DbgResizable, dbg_resizable, 0, 0, 0, CFGFLAG_CLIENT, "Enables window resizing")
 
 // DDRace
@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/console.h>
@@ -55,10 +56,11 @@ public:
 		}
 	}
 
-	CEngine(const char *pAppname)
+	CEngine(const char *pAppname, int NumJobThreads)
 	{
 		dbg_logger_stdout();
 		dbg_logger_debugger();
+		dbg_enable_threaded();
 
 		//
 		dbg_msg("engine", "running on %s-%s-%s", CONF_FAMILY_STRING, CONF_PLATFORM_STRING, CONF_ARCH_STRING);
@@ -74,7 +76,10 @@ public:
 		net_init();
 		CNetBase::Init();
 
-		m_JobPool.Init(1);
+		// the threads that wait on jobs help out, so leave a core for them
+		if(NumJobThreads <= 0)
+			NumJobThreads = clamp(thread_num_cpus()-1, 2, (int)CJobPool::MAX_THREADS);
+		m_JobPool.Init(NumJobThreads);
 
 		m_Logging = false;
 	}
@@ -102,15 +107,30 @@ public:
 	{
 		str_copy(pLookup->m_aHostname, pHostname, sizeof(pLookup->m_aHostname));
 		pLookup->m_Nettype = Nettype;
-		AddJob(&pLookup->m_Job, HostLookupThread, pLookup);
+		AddJob(&pLookup->m_Job, HostLookupThread, pLookup, 0);
 	}
 
-	void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData)
+	void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup)
 	{
 		if(g_Config.m_Debug)
 			dbg_msg("engine", "job added");
-		m_JobPool.Add(pJob, pfnFunc, pData);
+		m_JobPool.Add(pJob, pfnFunc, pData, pGroup);
+	}
+
+	void WaitJob(CJob *pJob)
+	{
+		m_JobPool.Wait(pJob);
+	}
+
+	void WaitJobGroup(CJobGroup *pGroup)
+	{
+		m_JobPool.Wait(pGroup);
+	}
+
+	void AddJobContinuation(CJobGroup *pGroup, CJob *pJob, JOBFUNC pfnFunc, void *pData)
+	{
+		m_JobPool.Continue(pGroup, pJob, pfnFunc, pData);
 	}
 };
 
-IEngine *CreateEngine(const char *pAppname) { return new CEngine(pAppname); }
+IEngine *CreateEngine(const char *pAppname, int NumJobThreads) { return new CEngine(pAppname, NumJobThreads); }
@@ -1,75 +1,222 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 #include "jobs.h"
 
 CJobPool::CJobPool()
 {
 	// empty the pool
-	m_Lock = lock_create();
-	m_pFirstJob = 0;
-	m_pLastJob = 0;
+	for(int i = 0; i < MAX_THREADS; i++)
+	{
+		m_aQueues[i].m_Lock = lock_create();
+		m_aQueues[i].m_pFirstJob = 0;
+		m_aQueues[i].m_pLastJob = 0;
+	}
+	m_NumQueues = 1;
+	m_NextQueue = 0;
+
+	semaphore_init(&m_Semaphore);
+	m_NumSleeping = 0;
 }
 
 void CJobPool::WorkerThread(void *pUser)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
+	CWorker *pWorker = (CWorker *)pUser;
+	CJobPool *pPool = pWorker->m_pPool;
 
 	while(1)
 	{
-		CJob *pJob = 0;
-
-		// fetch job from queue
-		lock_wait(pPool->m_Lock);
-		if(pPool->m_pFirstJob)
+		CJob *pJob = pPool->FindJob(pWorker->m_Index);
+		if(!pJob)
 		{
-			pJob = pPool->m_pFirstJob;
-			pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-			if(pPool->m_pFirstJob)
-				pPool->m_pFirstJob->m_pPrev = 0;
-			else
-				pPool->m_pLastJob = 0;
+			// announce the sleep before looking again, so a job added
+			// meanwhile either gets found here or signals the semaphore
+			atomic_inc(&pPool->m_NumSleeping);
+			pJob = pPool->FindJob(pWorker->m_Index);
+			if(!pJob)
+				semaphore_wait(&pPool->m_Semaphore);
+			atomic_dec(&pPool->m_NumSleeping);
 		}
-		lock_release(pPool->m_Lock);
 
-		// do the job if we have one
 		if(pJob)
+			pPool->RunJob(pJob);
+	}
+}
+
+void CJobPool::Unlink(CQueue *pQueue, CJob *pJob)
+{
+	if(pJob->m_pPrev)
+		pJob->m_pPrev->m_pNext = pJob->m_pNext;
+	else
+		pQueue->m_pFirstJob = pJob->m_pNext;
+	if(pJob->m_pNext)
+		pJob->m_pNext->m_pPrev = pJob->m_pPrev;
+	else
+		pQueue->m_pLastJob = pJob->m_pPrev;
+	pJob->m_pPrev = 0;
+	pJob->m_pNext = 0;
+}
+
+CJob *CJobPool::Pop(CQueue *pQueue, bool Back)
+{
+	lock_wait(pQueue->m_Lock);
+	CJob *pJob = Back ? pQueue->m_pLastJob : pQueue->m_pFirstJob;
+	if(pJob)
+		Unlink(pQueue, pJob);
+	lock_release(pQueue->m_Lock);
+	return pJob;
+}
+
+CJob *CJobPool::TakeJob(CJob *pWanted, CJobGroup *pGroup)
+{
+	for(int i = 0; i < m_NumQueues; i++)
+	{
+		CQueue *pQueue = &m_aQueues[i];
+		lock_wait(pQueue->m_Lock);
+		for(CJob *pJob = pQueue->m_pFirstJob; pJob; pJob = pJob->m_pNext)
 		{
-			pJob->m_Status = CJob::STATE_RUNNING;
-			pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
-			pJob->m_Status = CJob::STATE_DONE;
+			if(pJob == pWanted || (pGroup && pJob->m_pGroup == pGroup))
+			{
+				Unlink(pQueue, pJob);
+				lock_release(pQueue->m_Lock);
+				return pJob;
+			}
 		}
-		else
-			thread_sleep(10);
+		lock_release(pQueue->m_Lock);
 	}
+	return 0;
+}
 
+CJob *CJobPool::FindJob(int Home)
+{
+	// own queue in order, then steal the newest jobs of the others
+	CJob *pJob = Pop(&m_aQueues[Home], false);
+	for(int i = 1; !pJob && i < m_NumQueues; i++)
+		pJob = Pop(&m_aQueues[(Home+i)%m_NumQueues], true);
+	return pJob;
+}
+
+void CJobPool::RunJob(CJob *pJob)
+{
+	// the job may be freed as soon as it's marked as done
+	CJobGroup *pGroup = pJob->m_pGroup;
+
+	pJob->m_Status = CJob::STATE_RUNNING;
+	pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
+	// everything the job wrote has to be visible before it's marked as done
+	sync_barrier();
+	pJob->m_Status = CJob::STATE_DONE;
+
+	if(pGroup)
+		ReleaseGroup(pGroup);
+}
+
+void CJobPool::ReleaseGroup(CJobGroup *pGroup)
+{
+	if(atomic_dec(&pGroup->m_Pending) != 0)
+		return;
+
+	if(pGroup->m_pContinuation)
+		Push(pGroup->m_pContinuation);
+
+	// last access, the owner may reuse the group right after
+	sync_barrier();
+	pGroup->m_Done = 1;
 }
 
 int CJobPool::Init(int NumThreads)
 {
+	m_NumQueues = clamp(NumThreads, 1, (int)MAX_THREADS);
+
 	// start threads
-	for(int i = 0; i < NumThreads; i++)
-		thread_create(WorkerThread, this);
+	for(int i = 0; i < m_NumQueues; i++)
+	{
+		m_aWorkers[i].m_pPool = this;
+		m_aWorkers[i].m_Index = i;
+		thread_detach(thread_create(WorkerThread, &m_aWorkers[i]));
+	}
 	return 0;
 }
 
-int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
+void CJobPool::Prepare(CJob *pJob, JOBFUNC pfnFunc, void *pData)
 {
 	mem_zero(pJob, sizeof(CJob));
+	pJob->m_pPool = this;
 	pJob->m_pfnFunc = pfnFunc;
 	pJob->m_pFuncData = pData;
+}
+
+void CJobPool::Push(CJob *pJob)
+{
+	// spread the jobs over the workers
+	CQueue *pQueue = &m_aQueues[(unsigned)atomic_inc(&m_NextQueue)%m_NumQueues];
 
-	lock_wait(m_Lock);
+	lock_wait(pQueue->m_Lock);
 
 	// add job to queue
-	pJob->m_pPrev = m_pLastJob;
-	if(m_pLastJob)
-		m_pLastJob->m_pNext = pJob;
-	m_pLastJob = pJob;
-	if(!m_pFirstJob)
-		m_pFirstJob = pJob;
-
-	lock_release(m_Lock);
+	pJob->m_pPrev = pQueue->m_pLastJob;
+	if(pQueue->m_pLastJob)
+		pQueue->m_pLastJob->m_pNext = pJob;
+	pQueue->m_pLastJob = pJob;
+	if(!pQueue->m_pFirstJob)
+		pQueue->m_pFirstJob = pJob;
+
+	lock_release(pQueue->m_Lock);
+
+	// wake a worker if all are idle or about to be
+	sync_barrier();
+	if(m_NumSleeping > 0)
+		semaphore_signal(&m_Semaphore);
+}
+
+int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup)
+{
+	Prepare(pJob, pfnFunc, pData);
+	if(pGroup)
+	{
+		pJob->m_pGroup = pGroup;
+		atomic_inc(&pGroup->m_Pending);
+	}
+	Push(pJob);
 	return 0;
 }
 
+void CJobPool::Wait(CJob *pJob)
+{
+	// only run the job itself here, any other one could block for long (host lookups)
+	while(pJob->m_Status != CJob::STATE_DONE)
+	{
+		if(pJob->m_Status != CJob::STATE_PENDING || !TakeJob(pJob, 0))
+			thread_yield();
+		else
+			RunJob(pJob);
+	}
+	sync_barrier();
+}
+
+void CJobPool::Wait(CJobGroup *pGroup)
+{
+	// close the group
+	ReleaseGroup(pGroup);
+
+	// help with the jobs of the group only
+	while(!pGroup->m_Done)
+	{
+		CJob *pJob = TakeJob(0, pGroup);
+		if(pJob)
+			RunJob(pJob);
+		else
+			thread_yield();
+	}
+	sync_barrier();
+}
+
+void CJobPool::Continue(CJobGroup *pGroup, CJob *pJob, JOBFUNC pfnFunc, void *pData)
+{
+	Prepare(pJob, pfnFunc, pData);
+	pGroup->m_pContinuation = pJob;
+
+	// close the group, the last job to finish queues the continuation
+	ReleaseGroup(pGroup);
+}
@@ -2,15 +2,19 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+#include <base/system.h>
+
 typedef int (*JOBFUNC)(void *pData);
 
 class CJobPool;
+class CJobGroup;
 
 class CJob
 {
 	friend class CJobPool;
 
 	CJobPool *m_pPool;
+	CJobGroup *m_pGroup;
 	CJob *m_pPrev;
 	CJob *m_pNext;
 
@@ -37,18 +41,82 @@ public:
 	int Result() const {return m_Result; }
 };
 
+// a set of jobs that can be waited on together or followed by a continuation job.
+// the group stays open until CJobPool::Wait or CJobPool::Continue is called on it.
+class CJobGroup
+{
+	friend class CJobPool;
+
+	volatile int m_Pending;
+	volatile int m_Done;
+	CJob *m_pContinuation;
+public:
+	CJobGroup() { Reset(); }
+
+	void Reset()
+	{
+		m_Pending = 1;
+		m_Done = 0;
+		m_pContinuation = 0;
+	}
+
+	bool Done() const { return m_Done != 0; }
+};
+
 class CJobPool
 {
-	LOCK m_Lock;
-	CJob *m_pFirstJob;
-	CJob *m_pLastJob;
+public:
+	enum
+	{
+		MAX_THREADS=16,
+	};
+
+private:
+	// every worker owns a queue, idle workers steal from the others
+	struct CQueue
+	{
+		LOCK m_Lock;
+		CJob *m_pFirstJob;
+		CJob *m_pLastJob;
+	};
+
+	struct CWorker
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+	};
+
+	CQueue m_aQueues[MAX_THREADS];
+	CWorker m_aWorkers[MAX_THREADS];
+	int m_NumQueues;
+	volatile int m_NextQueue;
+
+	SEMAPHORE m_Semaphore;
+	volatile int m_NumSleeping;
 
 	static void WorkerThread(void *pUser);
 
+	void Prepare(CJob *pJob, JOBFUNC pfnFunc, void *pData);
+	void Push(CJob *pJob);
+	void Unlink(CQueue *pQueue, CJob *pJob);
+	CJob *Pop(CQueue *pQueue, bool Back);
+	CJob *FindJob(int Home);
+	// removes pJob or a job of pGroup from the queues, if it's still queued
+	CJob *TakeJob(CJob *pJob, CJobGroup *pGroup);
+	void RunJob(CJob *pJob);
+	void ReleaseGroup(CJobGroup *pGroup);
+
 public:
 	CJobPool();
 
 	int Init(int NumThreads);
-	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
+	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, CJobGroup *pGroup = 0);
+
+	// runs the job or the pending jobs of the group on the calling thread until it's done
+	void Wait(CJob *pJob);
+	void Wait(CJobGroup *pGroup);
+
+	// queues pJob once all jobs of the group are done, without blocking
+	void Continue(CJobGroup *pGroup, CJob *pJob, JOBFUNC pfnFunc, void *pData);
 };
 #endif
@@ -114,6 +114,19 @@ public:
 	int m_Sequence;
 	int64 m_LastSendTime;
 	int64 m_FirstSendTime;
+	int m_NumResends;
+};
+
+class CNetResendStats
+{
+public:
+	int m_Rtt; // smoothed round trip time in ms, -1 before the first sample
+	int m_RttVar; // round trip time variation in ms
+	int m_Rto; // current resend timeout in ms
+	int m_NumVital; // vital chunks sent
+	int m_NumResent; // vital chunks sent again
+	int m_NumResendRequests; // packets from the peer that asked for a resend
+	int m_NumTimeouts; // resends because a chunk was not acked in time
 };
 
 class CNetPacketConstruct
@@ -147,6 +160,12 @@ private:
 	int64 m_LastRecvTime;
 	int64 m_LastSendTime;
 
+	// round trip estimation for the resend timeout, in time_get units
+	int64 m_Srtt;
+	int64 m_RttVar;
+	int64 m_Rto;
+	CNetResendStats m_ResendStats;
+
 	char m_ErrorString[256];
 
 	CNetPacketConstruct m_Construct;
@@ -160,11 +179,12 @@ private:
 	void ResetStats();
 	void SetError(const char *pString);
 	void AckChunks(int Ack);
+	void UpdateRtt(int64 Rtt);
 
 	int QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence);
 	void SendControl(int ControlMsg, const void *pExtra, int ExtraSize);
 	void ResendChunk(CNetChunkResend *pResend);
-	void Resend();
+	void Resend(int64 MinAge);
 
 public:
 	void Init(NETSOCKET Socket);
@@ -189,6 +209,8 @@ public:
 	int64 LastRecvTime() const { return m_LastRecvTime; }
 
 	int AckSequence() const { return m_Ack; }
+
+	void GetResendStats(CNetResendStats *pStats) const;
 };
 
 class CConsoleNetConnection
@@ -277,6 +299,7 @@ public:
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	void ClientResendStats(int ClientID, CNetResendStats *pStats) const { m_aSlots[ClientID].m_Connection.GetResendStats(pStats); }
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 #include "config.h"
 #include "network.h"
@@ -22,6 +23,12 @@ void CNetConnection::Reset()
 	m_Token = -1;
 	mem_zero(&m_PeerAddr, sizeof(m_PeerAddr));
 
+	// no round trip known yet, resend after a second like it always did
+	m_Srtt = 0;
+	m_RttVar = 0;
+	m_Rto = time_freq();
+	mem_zero(&m_ResendStats, sizeof(m_ResendStats));
+
 	m_Buffer.Init();
 
 	mem_zero(&m_Construct, sizeof(m_Construct));
@@ -48,6 +55,7 @@ void CNetConnection::Init(NETSOCKET Socket)
 
 void CNetConnection::AckChunks(int Ack)
 {
+	int64 Rtt = -1;
 	while(1)
 	{
 		CNetChunkResend *pResend = m_Buffer.First();
@@ -55,10 +63,43 @@ void CNetConnection::AckChunks(int Ack)
 			break;
 
 		if(CNetBase::IsSeqInBackroom(pResend->m_Sequence, Ack))
+		{
+			// resent chunks don't tell which send got acked
+			if(!pResend->m_NumResends)
+				Rtt = time_get()-pResend->m_FirstSendTime;
 			m_Buffer.PopFirst();
+		}
 		else
 			break;
 	}
+
+	if(Rtt >= 0)
+		UpdateRtt(Rtt);
+}
+
+void CNetConnection::UpdateRtt(int64 Rtt)
+{
+	// rfc 6298, the clock granularity is a tick as acks come with the next packet of the peer
+	if(!m_Srtt)
+	{
+		m_Srtt = max(Rtt, (int64)1);
+		m_RttVar = Rtt/2;
+	}
+	else
+	{
+		int64 Delta = Rtt > m_Srtt ? Rtt-m_Srtt : m_Srtt-Rtt;
+		m_RttVar = (3*m_RttVar+Delta)/4;
+		m_Srtt = max((7*m_Srtt+Rtt)/8, (int64)1);
+	}
+	m_Rto = clamp(m_Srtt+max(time_freq()/50, 4*m_RttVar), time_freq()/10, time_freq());
+}
+
+void CNetConnection::GetResendStats(CNetResendStats *pStats) const
+{
+	*pStats = m_ResendStats;
+	pStats->m_Rtt = m_Srtt ? (int)(m_Srtt*1000/time_freq()) : -1;
+	pStats->m_RttVar = (int)(m_RttVar*1000/time_freq());
+	pStats->m_Rto = (int)(m_Rto*1000/time_freq());
 }
 
 void CNetConnection::SignalResend()
@@ -120,7 +161,9 @@ int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int
 			pResend->m_pData = (unsigned char *)(pResend+1);
 			pResend->m_FirstSendTime = time_get();
 			pResend->m_LastSendTime = pResend->m_FirstSendTime;
+			pResend->m_NumResends = 0;
 			mem_copy(pResend->m_pData, pData, DataSize);
+			m_ResendStats.m_NumVital++;
 		}
 		else
 		{
@@ -151,12 +194,20 @@ void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 {
 	QueueChunkEx(pResend->m_Flags|NET_CHUNKFLAG_RESEND, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
 	pResend->m_LastSendTime = time_get();
+	pResend->m_NumResends++;
+	m_ResendStats.m_NumResent++;
 }
 
-void CNetConnection::Resend()
+void CNetConnection::Resend(int64 MinAge)
 {
+	// only the chunks that were not (re)sent in the last MinAge, the
+	// others are still on their way
+	int64 Now = time_get();
 	for(CNetChunkResend *pResend = m_Buffer.First(); pResend; pResend = m_Buffer.Next(pResend))
-		ResendChunk(pResend);
+	{
+		if(Now-pResend->m_LastSendTime >= MinAge)
+			ResendChunk(pResend);
+	}
 }
 
 int CNetConnection::Connect(NETADDR *pAddr)
@@ -197,10 +248,6 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 {
 	int64 Now = time_get();
 
-	// check if resend is requested
-	if(pPacket->m_Flags&NET_PACKETFLAG_RESEND)
-		Resend();
-
 	//
 	if(pPacket->m_Flags&NET_PACKETFLAG_CONTROL)
 	{
@@ -283,6 +330,15 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 		AckChunks(pPacket->m_Ack);
 	}
 
+	// check if resend is requested, after the ack so acked chunks are not sent again.
+	// the peer asks with every packet until the gap is filled, so skip what was
+	// sent within the last round trip
+	if(pPacket->m_Flags&NET_PACKETFLAG_RESEND)
+	{
+		m_ResendStats.m_NumResendRequests++;
+		Resend(m_Srtt);
+	}
+
 	return 1;
 }
 
@@ -315,11 +371,16 @@ int CNetConnection::Update()
 			str_format(aBuf, sizeof(aBuf), "Too weak connection (not acked for %d seconds)", g_Config.m_ConnTimeout);
 			SetError(aBuf);
 		}
-		else
+		else if(Now-pResend->m_LastSendTime > time_freq() ||
+			(Now-pResend->m_LastSendTime > m_Rto && m_LastRecvTime > pResend->m_LastSendTime+m_Srtt))
 		{
-			// resend packet if we havn't got it acked in 1 second
-			if(Now-pResend->m_LastSendTime > time_freq())
-				ResendChunk(pResend);
+			// only resend early when the peer sent something after it should have got
+			// the chunk, a quiet peer (loading, keepalives only) just didn't ack yet.
+			// the peer drops everything after a missing chunk, so send all that timed out
+			// and back off in case the link got worse
+			Resend(m_Rto);
+			m_ResendStats.m_NumTimeouts++;
+			m_Rto = min(m_Rto*2, time_freq());
 		}
 	}
 
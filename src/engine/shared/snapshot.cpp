@@ -139,6 +139,15 @@ void CSnapshotDelta::UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
 	}
 }
 
+static int PackedSize(const int *pData, int Num)
+{
+	unsigned char aBuf[16];
+	int Size = 0;
+	for(int i = 0; i < Num; i++)
+		Size += (int)(CVariableInt::Pack(aBuf, pData[i]) - aBuf);
+	return Size;
+}
+
 CSnapshotDelta::CSnapshotDelta()
 {
 	mem_zero(m_aItemSizes, sizeof(m_aItemSizes));
@@ -159,7 +168,7 @@ CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta()
 }
 
 // TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData, int *pDataRate, int *pDataUpdates)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_pData;
@@ -186,6 +195,8 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			// deleted
 			pDelta->m_NumDeletedItems++;
 			*pData = pFromItem->Key();
+			if(pDataRate && pFromItem->Type() < MAX_ITEMTYPES)
+				pDataRate[pFromItem->Type()] += PackedSize(pData, 1)*8;
 			pData++;
 		}
 	}
@@ -207,6 +218,7 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 		ItemSize = pTo->GetItemSize(i); // O(1) .. O(n)
 		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
 		PastIndex = aPastIndecies[i];
+		int *pItemStart = pData;
 
 		if(PastIndex != -1)
 		{
@@ -241,6 +253,13 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			pDelta->m_NumUpdateItems++;
 			Count++;
 		}
+
+		if(pDataRate && pData != pItemStart && pCurItem->Type() < MAX_ITEMTYPES)
+		{
+			pDataRate[pCurItem->Type()] += PackedSize(pItemStart, (int)(pData-pItemStart))*8;
+			if(pDataUpdates)
+				pDataUpdates[pCurItem->Type()]++;
+		}
 	}
 
 	if(0)
@@ -522,7 +541,8 @@ int CSnapshotBuilder::Finish(void *SpnapData)
 
 void *CSnapshotBuilder::NewItem(int Type, int ID, int Size)
 {
-	if(m_DataSize + sizeof(CSnapshotItem) + Size >= CSnapshot::MAX_SIZE ||
+	// the offsets go into the finished snapshot as well
+	if(SnapSize() + sizeof(int) + sizeof(CSnapshotItem) + Size > CSnapshot::MAX_SIZE ||
 		m_NumItems+1 >= MAX_ITEMS)
 	{
 		dbg_assert(m_DataSize < CSnapshot::MAX_SIZE, "too much data");
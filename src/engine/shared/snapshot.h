@@ -59,9 +59,14 @@ public:
 		int m_pData[1];
 	};
 
+	enum
+	{
+		// TODO: strange arbitrary number
+		MAX_ITEMTYPES=64,
+	};
+
 private:
-	// TODO: strange arbitrary number
-	short m_aItemSizes[64];
+	short m_aItemSizes[MAX_ITEMTYPES];
 	int m_aSnapshotDataRate[0xffff];
 	int m_aSnapshotDataUpdates[0xffff];
 	int m_SnapshotCurrent;
@@ -75,7 +80,8 @@ public:
 	int GetDataUpdates(int Index) { return m_aSnapshotDataUpdates[Index]; }
 	void SetStaticsize(int ItemType, int Size);
 	CData *EmptyDelta();
-	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData);
+	// pDataRate and pDataUpdates can take the bits and number of items the delta has per item type
+	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, int *pDataRate = 0, int *pDataUpdates = 0);
 	int UnpackDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, int DataSize);
 };
 
@@ -112,11 +118,13 @@ public:
 
 class CSnapshotBuilder
 {
+public:
 	enum
 	{
 		MAX_ITEMS = 1024
 	};
 
+private:
 	char m_aData[CSnapshot::MAX_SIZE];
 	int m_DataSize;
 
@@ -132,6 +140,10 @@ public:
 	int *GetItemData(int Key);
 
 	int Finish(void *Snapdata);
+
+	int NumItems() const { return m_NumItems; }
+	// size of the snapshot Finish() would make
+	int SnapSize() const { return sizeof(CSnapshot) + sizeof(int)*m_NumItems + m_DataSize; }
 };
 
 
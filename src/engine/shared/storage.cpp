@@ -66,6 +66,7 @@ public:
 			fs_makedir(GetPath(TYPE_SAVE, "demos", aPath, sizeof(aPath)));
 			fs_makedir(GetPath(TYPE_SAVE, "demos/auto", aPath, sizeof(aPath)));
 			fs_makedir(GetPath(TYPE_SAVE, "ghosts", aPath, sizeof(aPath)));
+			fs_makedir(GetPath(TYPE_SAVE, "ticks", aPath, sizeof(aPath)));
 		}
 
 		return m_NumPaths ? 0 : 1;
@@ -0,0 +1,391 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+
+#include "tickrecord.h"
+
+static const unsigned char gs_aHeaderMarker[8] = {'T', 'W', 'T', 'I', 'C', 'K', 'S', 0};
+static const unsigned char gs_ActVersion = 1;
+
+/*
+	Every record is a type byte and a 16 bit size followed by the packed
+	data. Inputs are stored without their trailing zeros.
+*/
+
+CTickRecorder::CTickRecorder()
+{
+	m_File = 0;
+	m_BufferSize = 0;
+}
+
+int CTickRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned MapCrc, unsigned Seed)
+{
+	if(m_File)
+		return -1;
+
+	m_pConsole = pConsole;
+
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "Unable to open '%s' for recording", pFilename);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "tick_recorder", aBuf);
+		return -1;
+	}
+
+	// write header
+	CTickRecord::CHeader Header;
+	mem_zero(&Header, sizeof(Header));
+	mem_copy(Header.m_aMarker, gs_aHeaderMarker, sizeof(Header.m_aMarker));
+	Header.m_Version = gs_ActVersion;
+	str_copy(Header.m_aNetversion, pNetVersion, sizeof(Header.m_aNetversion));
+	str_copy(Header.m_aMapName, pMap, sizeof(Header.m_aMapName));
+	Header.m_aMapCrc[0] = (MapCrc>>24)&0xff;
+	Header.m_aMapCrc[1] = (MapCrc>>16)&0xff;
+	Header.m_aMapCrc[2] = (MapCrc>>8)&0xff;
+	Header.m_aMapCrc[3] = (MapCrc)&0xff;
+	Header.m_aSeed[0] = (Seed>>24)&0xff;
+	Header.m_aSeed[1] = (Seed>>16)&0xff;
+	Header.m_aSeed[2] = (Seed>>8)&0xff;
+	Header.m_aSeed[3] = (Seed)&0xff;
+	str_timestamp(Header.m_aTimestamp, sizeof(Header.m_aTimestamp));
+	io_write(File, &Header, sizeof(Header));
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aValidLastInput[i] = false;
+	m_BufferSize = 0;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "Recording ticks to '%s'", pFilename);
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "tick_recorder", aBuf);
+	m_File = File;
+	return 0;
+}
+
+int CTickRecorder::Stop()
+{
+	if(!m_File)
+		return -1;
+
+	Flush();
+	io_close(m_File);
+	m_File = 0;
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "tick_recorder", "Stopped recording");
+	return 0;
+}
+
+void CTickRecorder::Flush()
+{
+	if(m_BufferSize)
+	{
+		io_write(m_File, m_aBuffer, m_BufferSize);
+		m_BufferSize = 0;
+	}
+}
+
+void CTickRecorder::Write(int Type, const CPacker *pPacker)
+{
+	if(!m_File || pPacker->Error())
+		return;
+
+	int Size = pPacker->Size();
+	if(m_BufferSize+3+Size > (int)sizeof(m_aBuffer))
+		Flush();
+
+	m_aBuffer[m_BufferSize++] = Type;
+	m_aBuffer[m_BufferSize++] = (Size>>8)&0xff;
+	m_aBuffer[m_BufferSize++] = Size&0xff;
+	mem_copy(m_aBuffer+m_BufferSize, pPacker->Data(), Size);
+	m_BufferSize += Size;
+}
+
+void CTickRecorder::AddInput(CPacker *pPacker, const int *pData)
+{
+	int Num = MAX_INPUT_SIZE;
+	while(Num > 0 && pData[Num-1] == 0)
+		Num--;
+
+	pPacker->AddInt(Num);
+	for(int i = 0; i < Num; i++)
+		pPacker->AddInt(pData[i]);
+}
+
+void CTickRecorder::RecordTick(int Tick)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(Tick);
+	Write(CTickRecord::RECORD_TICK, &Packer);
+}
+
+void CTickRecorder::RecordInput(int ClientID, const int *pData)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+
+	// most ticks repeat the input of the tick before
+	if(m_aValidLastInput[ClientID] && mem_comp(m_aaLastInput[ClientID], pData, sizeof(m_aaLastInput[ClientID])) == 0)
+	{
+		Write(CTickRecord::RECORD_INPUT_SAME, &Packer);
+		return;
+	}
+
+	mem_copy(m_aaLastInput[ClientID], pData, sizeof(m_aaLastInput[ClientID]));
+	m_aValidLastInput[ClientID] = true;
+	AddInput(&Packer, pData);
+	Write(CTickRecord::RECORD_INPUT, &Packer);
+}
+
+void CTickRecorder::RecordTickEnd(unsigned Hash)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(Hash);
+	Write(CTickRecord::RECORD_TICK_END, &Packer);
+}
+
+void CTickRecorder::RecordSnapshot()
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Write(CTickRecord::RECORD_SNAP, &Packer);
+}
+
+void CTickRecorder::RecordDirectInput(int ClientID, int Latency, const int *pData)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Latency);
+	AddInput(&Packer, pData);
+	Write(CTickRecord::RECORD_DIRECT_INPUT, &Packer);
+}
+
+void CTickRecorder::RecordClientEvent(int Type, int ClientID)
+{
+	if(!m_File)
+		return;
+
+	if(Type == CTickRecord::RECORD_CONNECT)
+		m_aValidLastInput[ClientID] = false;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+	Write(Type, &Packer);
+}
+
+void CTickRecorder::RecordDrop(int ClientID, const char *pReason)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+	Packer.AddString(pReason, 128);
+	Write(CTickRecord::RECORD_DROP, &Packer);
+}
+
+void CTickRecorder::RecordMessage(int ClientID, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Size);
+	Packer.AddRaw(pData, Size);
+	Write(CTickRecord::RECORD_MESSAGE, &Packer);
+}
+
+void CTickRecorder::RecordAuth(int ClientID, int Level)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Level);
+	Write(CTickRecord::RECORD_AUTH, &Packer);
+}
+
+void CTickRecorder::RecordRcon(int ClientID, const char *pCommand)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(ClientID);
+	Packer.AddString(pCommand, 0);
+	Write(CTickRecord::RECORD_RCON, &Packer);
+}
+
+
+CTickPlayer::CTickPlayer()
+{
+	m_File = 0;
+}
+
+CTickPlayer::~CTickPlayer()
+{
+	Stop();
+}
+
+int CTickPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename)
+{
+	Stop();
+
+	m_File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!m_File)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "could not open '%s'", pFilename);
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "tick_player", aBuf);
+		return -1;
+	}
+
+	// read the header
+	if(io_read(m_File, &m_Header, sizeof(m_Header)) != sizeof(m_Header) ||
+		mem_comp(m_Header.m_aMarker, gs_aHeaderMarker, sizeof(gs_aHeaderMarker)) != 0 || m_Header.m_Version != gs_ActVersion)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "'%s' is not a tick record of version %d", pFilename, gs_ActVersion);
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "tick_player", aBuf);
+		Stop();
+		return -1;
+	}
+	m_Header.m_aNetversion[sizeof(m_Header.m_aNetversion)-1] = 0;
+	m_Header.m_aMapName[sizeof(m_Header.m_aMapName)-1] = 0;
+
+	mem_zero(m_aaLastInput, sizeof(m_aaLastInput));
+	return 0;
+}
+
+void CTickPlayer::Stop()
+{
+	if(m_File)
+	{
+		io_close(m_File);
+		m_File = 0;
+	}
+}
+
+unsigned CTickPlayer::MapCrc() const
+{
+	return (m_Header.m_aMapCrc[0]<<24) | (m_Header.m_aMapCrc[1]<<16) | (m_Header.m_aMapCrc[2]<<8) | m_Header.m_aMapCrc[3];
+}
+
+unsigned CTickPlayer::Seed() const
+{
+	return (m_Header.m_aSeed[0]<<24) | (m_Header.m_aSeed[1]<<16) | (m_Header.m_aSeed[2]<<8) | m_Header.m_aSeed[3];
+}
+
+bool CTickPlayer::GetInput(CUnpacker *pUnpacker, int *pData)
+{
+	int Num = pUnpacker->GetInt();
+	if(Num < 0 || Num > MAX_INPUT_SIZE)
+		return false;
+
+	for(int i = 0; i < Num; i++)
+		pData[i] = pUnpacker->GetInt();
+	for(int i = Num; i < MAX_INPUT_SIZE; i++)
+		pData[i] = 0;
+	return !pUnpacker->Error();
+}
+
+bool CTickPlayer::NextRecord(CRecord *pRecord)
+{
+	if(!m_File)
+		return false;
+
+	unsigned char aChunk[3];
+	if(io_read(m_File, aChunk, sizeof(aChunk)) != sizeof(aChunk))
+		return false;
+
+	int Size = (aChunk[1]<<8) | aChunk[2];
+	if(Size > (int)sizeof(m_aRecordData) || (int)io_read(m_File, m_aRecordData, Size) != Size)
+		return false;
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(m_aRecordData, Size);
+
+	pRecord->m_Type = aChunk[0];
+	pRecord->m_ClientID = -1;
+	pRecord->m_pString = 0;
+	pRecord->m_pData = 0;
+	pRecord->m_DataSize = 0;
+
+	if(pRecord->m_Type == CTickRecord::RECORD_TICK)
+		pRecord->m_Tick = Unpacker.GetInt();
+	else if(pRecord->m_Type == CTickRecord::RECORD_TICK_END)
+		pRecord->m_Hash = (unsigned)Unpacker.GetInt();
+	else if(pRecord->m_Type == CTickRecord::RECORD_SNAP)
+		return true;
+	else
+	{
+		pRecord->m_ClientID = Unpacker.GetInt();
+		if(pRecord->m_ClientID < 0 || pRecord->m_ClientID >= MAX_CLIENTS)
+			return false;
+
+		switch(pRecord->m_Type)
+		{
+		case CTickRecord::RECORD_INPUT:
+			if(!GetInput(&Unpacker, m_aaLastInput[pRecord->m_ClientID]))
+				return false;
+			mem_copy(pRecord->m_aInput, m_aaLastInput[pRecord->m_ClientID], sizeof(pRecord->m_aInput));
+			break;
+		case CTickRecord::RECORD_INPUT_SAME:
+			mem_copy(pRecord->m_aInput, m_aaLastInput[pRecord->m_ClientID], sizeof(pRecord->m_aInput));
+			break;
+		case CTickRecord::RECORD_DIRECT_INPUT:
+			pRecord->m_Latency = Unpacker.GetInt();
+			if(!GetInput(&Unpacker, pRecord->m_aInput))
+				return false;
+			break;
+		case CTickRecord::RECORD_CONNECT:
+			mem_zero(m_aaLastInput[pRecord->m_ClientID], sizeof(m_aaLastInput[pRecord->m_ClientID]));
+			break;
+		case CTickRecord::RECORD_ENTER:
+			break;
+		case CTickRecord::RECORD_DROP:
+		case CTickRecord::RECORD_RCON:
+			pRecord->m_pString = Unpacker.GetString(CUnpacker::SANITIZE_CC);
+			break;
+		case CTickRecord::RECORD_MESSAGE:
+			pRecord->m_DataSize = Unpacker.GetInt();
+			pRecord->m_pData = Unpacker.GetRaw(pRecord->m_DataSize);
+			break;
+		case CTickRecord::RECORD_AUTH:
+			pRecord->m_Level = Unpacker.GetInt();
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return !Unpacker.Error();
+}
@@ -0,0 +1,118 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_TICKRECORD_H
+#define ENGINE_SHARED_TICKRECORD_H
+
+#include <base/system.h>
+
+#include "packer.h"
+#include "protocol.h"
+
+// a tick record holds everything the game server got from its clients,
+// so a session can be run again offline with the same results
+class CTickRecord
+{
+public:
+	enum
+	{
+		RECORD_TICK=1, // tick, the predicted inputs for it follow
+		RECORD_INPUT, // client id, predicted input
+		RECORD_INPUT_SAME, // client id, predicted input is the same as the last one
+		RECORD_TICK_END, // world hash after the tick ran
+		RECORD_SNAP, // snapshots were sent
+		RECORD_DIRECT_INPUT, // client id, latency, input
+		RECORD_CONNECT, // client id
+		RECORD_ENTER, // client id
+		RECORD_DROP, // client id, reason
+		RECORD_MESSAGE, // client id, raw game message
+		RECORD_AUTH, // client id, auth level
+		RECORD_RCON, // client id, command
+
+		MAX_RECORD_SIZE=1024*2,
+	};
+
+	struct CHeader
+	{
+		unsigned char m_aMarker[8];
+		unsigned char m_Version;
+		char m_aNetversion[64];
+		char m_aMapName[64];
+		unsigned char m_aMapCrc[4];
+		unsigned char m_aSeed[4];
+		char m_aTimestamp[20];
+	};
+};
+
+class CTickRecorder
+{
+	class IConsole *m_pConsole;
+	IOHANDLE m_File;
+	int m_aaLastInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+	bool m_aValidLastInput[MAX_CLIENTS];
+	unsigned char m_aBuffer[64*1024];
+	int m_BufferSize;
+
+	void Write(int Type, const CPacker *pPacker);
+	void Flush();
+	void AddInput(CPacker *pPacker, const int *pData);
+public:
+	CTickRecorder();
+
+	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned MapCrc, unsigned Seed);
+	int Stop();
+
+	void RecordTick(int Tick);
+	void RecordInput(int ClientID, const int *pData);
+	void RecordTickEnd(unsigned Hash);
+	void RecordSnapshot();
+	void RecordDirectInput(int ClientID, int Latency, const int *pData);
+	void RecordClientEvent(int Type, int ClientID);
+	void RecordDrop(int ClientID, const char *pReason);
+	void RecordMessage(int ClientID, const void *pData, int Size);
+	void RecordAuth(int ClientID, int Level);
+	void RecordRcon(int ClientID, const char *pCommand);
+
+	bool IsRecording() const { return m_File != 0; }
+};
+
+class CTickPlayer
+{
+public:
+	struct CRecord
+	{
+		int m_Type;
+		int m_ClientID;
+		int m_Tick;
+		unsigned m_Hash;
+		int m_Level;
+		int m_Latency;
+		int m_aInput[MAX_INPUT_SIZE];
+		const char *m_pString;
+		const void *m_pData;
+		int m_DataSize;
+	};
+
+private:
+	IOHANDLE m_File;
+	CTickRecord::CHeader m_Header;
+	int m_aaLastInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+	unsigned char m_aRecordData[CTickRecord::MAX_RECORD_SIZE];
+
+	bool GetInput(CUnpacker *pUnpacker, int *pData);
+public:
+	CTickPlayer();
+	~CTickPlayer();
+
+	int Load(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename);
+	void Stop();
+
+	// returns false when the record ended or is broken
+	bool NextRecord(CRecord *pRecord);
+
+	const char *NetVersion() const { return m_Header.m_aNetversion; }
+	const char *MapName() const { return m_Header.m_aMapName; }
+	unsigned MapCrc() const;
+	unsigned Seed() const;
+};
+
+#endif
@@ -2,13 +2,17 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/math.h>
 #include <base/system.h>
+#include <base/tl/array.h>
 
 #include <engine/console.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/storage.h>
 #include <engine/textrender.h>
 #include <engine/shared/config.h>
 #include <engine/shared/linereader.h>
+#include <game/client/gameclient.h>
+#include <game/client/imageloader.h>
 
 #include "countryflags.h"
 
@@ -23,6 +27,8 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 	}
 
 	char aOrigin[128];
+	array<CCountryFlag> aFlags;
+	array<CImageLoader *> apLoaders;
 	CLineReader LineReader;
 	LineReader.Init(File);
 	char *pLine;
@@ -56,40 +62,51 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 			continue;
 		}
 
-		// load the graphic file
-		char aBuf[128];
-		CImageInfo Info;
+		// add entry, the graphic file is decoded on the job pool
+		CCountryFlag CountryFlag;
+		CountryFlag.m_CountryCode = CountryCode;
+		str_copy(CountryFlag.m_aCountryCodeString, aOrigin, sizeof(CountryFlag.m_aCountryCodeString));
+		CountryFlag.m_Texture = -1;
+		aFlags.add(CountryFlag);
 		if(g_Config.m_ClLoadCountryFlags)
 		{
+			char aBuf[128];
 			str_format(aBuf, sizeof(aBuf), "countryflags/%s.png", aOrigin);
-			if(!Graphics()->LoadPNG(&Info, aBuf, IStorage::TYPE_ALL))
+			CImageLoader *pLoader = new CImageLoader;
+			pLoader->Start(m_pClient->Engine(), Graphics(), aBuf, IStorage::TYPE_ALL);
+			apLoaders.add(pLoader);
+		}
+	}
+	io_close(File);
+
+	// create the textures in index order
+	for(int i = 0; i < aFlags.size(); i++)
+	{
+		CCountryFlag CountryFlag = aFlags[i];
+		if(g_Config.m_ClLoadCountryFlags)
+		{
+			CImageLoader *pLoader = apLoaders[i];
+			if(!pLoader->Wait())
 			{
 				char aMsg[128];
-				str_format(aMsg, sizeof(aMsg), "failed to load '%s'", aBuf);
+				str_format(aMsg, sizeof(aMsg), "failed to load '%s'", pLoader->Filename());
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "countryflags", aMsg);
+				delete pLoader;
 				continue;
 			}
-		}
 
-		// add entry
-		CCountryFlag CountryFlag;
-		CountryFlag.m_CountryCode = CountryCode;
-		str_copy(CountryFlag.m_aCountryCodeString, aOrigin, sizeof(CountryFlag.m_aCountryCodeString));
-		if(g_Config.m_ClLoadCountryFlags)
-		{
-			CountryFlag.m_Texture = Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
-			mem_free(Info.m_pData);
+			CountryFlag.m_Texture = pLoader->Upload(CImageInfo::FORMAT_AUTO, 0);
+			delete pLoader;
 		}
-		else
-			CountryFlag.m_Texture = -1;
+
 		if(g_Config.m_Debug)
 		{
-			str_format(aBuf, sizeof(aBuf), "loaded country flag '%s'", aOrigin);
+			char aBuf[128];
+			str_format(aBuf, sizeof(aBuf), "loaded country flag '%s'", CountryFlag.m_aCountryCodeString);
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "countryflags", aBuf);
 		}
 		m_aCountryFlags.add_unsorted(CountryFlag);
 	}
-	io_close(File);
 	m_aCountryFlags.sort_range();
 
 	// find index of default item
@@ -113,6 +130,8 @@ void CCountryFlags::LoadCountryflagsIndexfile()
 
 void CCountryFlags::OnInit()
 {
+	int64 Start = time_get();
+
 	// load country flags
 	m_aCountryFlags.clear();
 	LoadCountryflagsIndexfile();
@@ -125,6 +144,10 @@ void CCountryFlags::OnInit()
 		mem_zero(DummyEntry.m_aCountryCodeString, sizeof(DummyEntry.m_aCountryCodeString));
 		m_aCountryFlags.add(DummyEntry);
 	}
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "loaded %d country flags in %.2fms", m_aCountryFlags.size(), ((time_get()-Start)*1000)/(float)time_freq());
+	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "countryflags", aBuf);
 }
 
 int CCountryFlags::Num() const
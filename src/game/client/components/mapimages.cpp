@@ -1,9 +1,14 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <engine/assetcache.h>
+#include <engine/console.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/map.h>
 #include <engine/storage.h>
 #include <game/client/component.h>
+#include <game/client/gameclient.h>
+#include <game/client/imageloader.h>
 #include <game/mapitems.h>
 
 #include "mapimages.h"
@@ -17,6 +22,7 @@ CMapImages::CMapImages()
 void CMapImages::OnMapLoad()
 {
 	IMap *pMap = Kernel()->RequestInterface<IMap>();
+	int64 StartTime = time_get();
 
 	// unload all textures
 	for(int i = 0; i < m_Count; i++)
@@ -29,7 +35,8 @@ void CMapImages::OnMapLoad()
 	int Start;
 	pMap->GetType(MAPITEMTYPE_IMAGE, &Start, &m_Count);
 
-	// load new textures
+	// external images are decoded on the job pool while the embedded ones get unpacked here
+	CImageLoader aLoaders[64];
 	for(int i = 0; i < m_Count; i++)
 	{
 		m_aTextures[i] = 0;
@@ -40,15 +47,58 @@ void CMapImages::OnMapLoad()
 			char Buf[256];
 			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
 			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+			aLoaders[i].Start(m_pClient->Engine(), Graphics(), Buf, IStorage::TYPE_ALL);
 		}
-		else
+	}
+
+	// load new textures, the unpacked embedded images are cached per map so rejoining skips the inflate
+	IAssetCache *pAssetCache = Kernel()->RequestInterface<IAssetCache>();
+	for(int i = 0; i < m_Count; i++)
+	{
+		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
+		if(pImg->m_External)
+			continue;
+
+		IAssetCache::CKey Key;
+		unsigned DataSize = pImg->m_Width*pImg->m_Height*4;
+		if(pAssetCache)
+		{
+			unsigned aSource[4] = { (unsigned)Client()->GetCurrentMapCrc(), (unsigned)i, (unsigned)pImg->m_Width, (unsigned)pImg->m_Height };
+			pAssetCache->MakeKey(&Key, aSource, sizeof(aSource), 0);
+
+			int aInfo[IAssetCache::MAX_INFO];
+			unsigned CachedSize;
+			void *pCached = pAssetCache->Load("mapimg", &Key, aInfo, &CachedSize);
+			if(pCached && CachedSize == DataSize)
+			{
+				m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, pCached, CImageInfo::FORMAT_RGBA, 0);
+				mem_free(pCached);
+				continue;
+			}
+			if(pCached)
+				mem_free(pCached);
+		}
+
+		void *pData = pMap->GetData(pImg->m_ImageData);
+		m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, pData, CImageInfo::FORMAT_RGBA, 0);
+		if(pAssetCache)
 		{
-			void *pData = pMap->GetData(pImg->m_ImageData);
-			m_aTextures[i] = Graphics()->LoadTextureRaw(pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, pData, CImageInfo::FORMAT_RGBA, 0);
-			pMap->UnloadData(pImg->m_ImageData);
+			int aInfo[IAssetCache::MAX_INFO] = { pImg->m_Width, pImg->m_Height, CImageInfo::FORMAT_RGBA, 0 };
+			pAssetCache->Store("mapimg", &Key, aInfo, pData, DataSize);
 		}
+		pMap->UnloadData(pImg->m_ImageData);
 	}
+
+	for(int i = 0; i < m_Count; i++)
+	{
+		CMapItemImage *pImg = (CMapItemImage *)pMap->GetItem(Start+i, 0, 0);
+		if(pImg->m_External)
+			m_aTextures[i] = aLoaders[i].Upload(CImageInfo::FORMAT_AUTO, 0);
+	}
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "loaded %d map images in %.2fms", m_Count, ((time_get()-StartTime)*1000)/(float)time_freq());
+	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "mapimages", aBuf);
 }
 
 int CMapImages::GetEntities()
@@ -25,6 +25,16 @@ CMapLayers::CMapLayers(int t)
 	m_CurrentLocalTick = 0;
 	m_LastLocalTick = 0;
 	m_EnvelopeUpdate = false;
+	m_paTileGeometries = 0;
+	m_NumTileGeometries = 0;
+	m_EnvCacheFrame = 0;
+	for(int i = 0; i < ENV_CACHE_SIZE; i++)
+		m_aEnvCache[i].m_Frame = -1;
+}
+
+CMapLayers::~CMapLayers()
+{
+	ClearTileGeometries();
 }
 
 void CMapLayers::OnInit()
@@ -32,6 +42,37 @@ void CMapLayers::OnInit()
 	m_pLayers = Layers();
 }
 
+void CMapLayers::OnMapLoad()
+{
+	// the geometry is built lazily when a layer is rendered the first time
+	ClearTileGeometries();
+	m_EnvCacheFrame++;
+}
+
+void CMapLayers::ClearTileGeometries()
+{
+	delete [] m_paTileGeometries;
+	m_paTileGeometries = 0;
+	m_NumTileGeometries = 0;
+}
+
+CTileGeometry *CMapLayers::TileGeometry(int Layer, const unsigned char *pIndex, const unsigned char *pFlags, int Stride, int w, int h)
+{
+	if(!m_paTileGeometries)
+	{
+		m_NumTileGeometries = m_pLayers->NumLayers();
+		m_paTileGeometries = new CTileGeometry[m_NumTileGeometries];
+	}
+	dbg_assert(Layer >= 0 && Layer < m_NumTileGeometries, "tile geometry layer out of range");
+
+	// the game layers render from their own data or, with entities shown, from
+	// the front, switch, tele or speedup data, so rebuild when the source changes
+	CTileGeometry *pGeometry = &m_paTileGeometries[Layer];
+	if(!pGeometry->IsBuiltFrom(pIndex, pFlags, Stride))
+		pGeometry->Build(pIndex, pFlags, Stride, w, h);
+	return pGeometry;
+}
+
 void CMapLayers::EnvelopeUpdate()
 {
 	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
@@ -55,6 +96,25 @@ void CMapLayers::MapScreenToGroup(float CenterX, float CenterY, CMapItemGroup *p
 void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser)
 {
 	CMapLayers *pThis = (CMapLayers *)pUser;
+
+	unsigned Hash = (unsigned)Env*31 + (unsigned)(int)(TimeOffset*1000.0f);
+	CEnvCacheEntry *pEntry = &pThis->m_aEnvCache[Hash&(ENV_CACHE_SIZE-1)];
+	if(pEntry->m_Frame != pThis->m_EnvCacheFrame || pEntry->m_Env != Env || pEntry->m_TimeOffset != TimeOffset)
+	{
+		pThis->EvalEnvelope(TimeOffset, Env, pEntry->m_aChannels);
+		pEntry->m_Frame = pThis->m_EnvCacheFrame;
+		pEntry->m_Env = Env;
+		pEntry->m_TimeOffset = TimeOffset;
+	}
+
+	pChannels[0] = pEntry->m_aChannels[0];
+	pChannels[1] = pEntry->m_aChannels[1];
+	pChannels[2] = pEntry->m_aChannels[2];
+	pChannels[3] = pEntry->m_aChannels[3];
+}
+
+void CMapLayers::EvalEnvelope(float TimeOffset, int Env, float *pChannels)
+{
 	pChannels[0] = 0;
 	pChannels[1] = 0;
 	pChannels[2] = 0;
@@ -64,55 +124,55 @@ void CMapLayers::EnvelopeEval(float TimeOffset, int Env, float *pChannels, void
 
 	{
 		int Start, Num;
-		pThis->m_pLayers->Map()->GetType(MAPITEMTYPE_ENVPOINTS, &Start, &Num);
+		m_pLayers->Map()->GetType(MAPITEMTYPE_ENVPOINTS, &Start, &Num);
 		if(Num)
-			pPoints = (CEnvPoint *)pThis->m_pLayers->Map()->GetItem(Start, 0, 0);
+			pPoints = (CEnvPoint *)m_pLayers->Map()->GetItem(Start, 0, 0);
 	}
 
 	int Start, Num;
-	pThis->m_pLayers->Map()->GetType(MAPITEMTYPE_ENVELOPE, &Start, &Num);
+	m_pLayers->Map()->GetType(MAPITEMTYPE_ENVELOPE, &Start, &Num);
 
 	if(Env >= Num)
 		return;
 
-	CMapItemEnvelope *pItem = (CMapItemEnvelope *)pThis->m_pLayers->Map()->GetItem(Start+Env, 0, 0);
+	CMapItemEnvelope *pItem = (CMapItemEnvelope *)m_pLayers->Map()->GetItem(Start+Env, 0, 0);
 
 	static float s_Time = 0.0f;
-	static float s_LastLocalTime = pThis->Client()->LocalTime();
-	if(pThis->Client()->State() == IClient::STATE_DEMOPLAYBACK)
+	static float s_LastLocalTime = Client()->LocalTime();
+	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
 	{
-		const IDemoPlayer::CInfo *pInfo = pThis->DemoPlayer()->BaseInfo();
+		const IDemoPlayer::CInfo *pInfo = DemoPlayer()->BaseInfo();
 		
-		if(!pInfo->m_Paused || pThis->m_EnvelopeUpdate)
+		if(!pInfo->m_Paused || m_EnvelopeUpdate)
 		{
-			if(pThis->m_CurrentLocalTick != pInfo->m_CurrentTick)
+			if(m_CurrentLocalTick != pInfo->m_CurrentTick)
 			{
-				pThis->m_LastLocalTick = pThis->m_CurrentLocalTick;
-				pThis->m_CurrentLocalTick = pInfo->m_CurrentTick;
+				m_LastLocalTick = m_CurrentLocalTick;
+				m_CurrentLocalTick = pInfo->m_CurrentTick;
 			}
 
-			s_Time = mix(pThis->m_LastLocalTick / (float)pThis->Client()->GameTickSpeed(),
-						pThis->m_CurrentLocalTick / (float)pThis->Client()->GameTickSpeed(),
-						pThis->Client()->IntraGameTick());
+			s_Time = mix(m_LastLocalTick / (float)Client()->GameTickSpeed(),
+						m_CurrentLocalTick / (float)Client()->GameTickSpeed(),
+						Client()->IntraGameTick());
 		}
 
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, s_Time+TimeOffset, pChannels);
+		RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, s_Time+TimeOffset, pChannels);
 	}
 	else
 	{
-		if(pThis->m_pClient->m_Snap.m_pGameInfoObj && !(pThis->m_pClient->m_Snap.m_pGameInfoObj->m_GameStateFlags&GAMESTATEFLAG_PAUSED))
+		if(m_pClient->m_Snap.m_pGameInfoObj && !(m_pClient->m_Snap.m_pGameInfoObj->m_GameStateFlags&GAMESTATEFLAG_PAUSED))
 		{
 			if(pItem->m_Version < 2 || pItem->m_Synchronized)
 			{
-				s_Time = mix((pThis->Client()->PrevGameTick()-pThis->m_pClient->m_Snap.m_pGameInfoObj->m_RoundStartTick) / (float)pThis->Client()->GameTickSpeed(),
-							(pThis->Client()->GameTick()-pThis->m_pClient->m_Snap.m_pGameInfoObj->m_RoundStartTick) / (float)pThis->Client()->GameTickSpeed(),
-							pThis->Client()->IntraGameTick());
+				s_Time = mix((Client()->PrevGameTick()-m_pClient->m_Snap.m_pGameInfoObj->m_RoundStartTick) / (float)Client()->GameTickSpeed(),
+							(Client()->GameTick()-m_pClient->m_Snap.m_pGameInfoObj->m_RoundStartTick) / (float)Client()->GameTickSpeed(),
+							Client()->IntraGameTick());
 			}
 			else
-				s_Time += pThis->Client()->LocalTime()-s_LastLocalTime;
+				s_Time += Client()->LocalTime()-s_LastLocalTime;
 		}
-		pThis->RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, s_Time+TimeOffset, pChannels);
-		s_LastLocalTime = pThis->Client()->LocalTime();
+		RenderTools()->RenderEvalEnvelope(pPoints+pItem->m_StartPoint, pItem->m_NumPoints, 4, s_Time+TimeOffset, pChannels);
+		s_LastLocalTime = Client()->LocalTime();
 	}
 }
 
@@ -121,6 +181,9 @@ void CMapLayers::OnRender()
 	if(Client()->State() != IClient::STATE_ONLINE && Client()->State() != IClient::STATE_DEMOPLAYBACK)
 		return;
 
+	// envelope values are only reused within a frame
+	m_EnvCacheFrame++;
+
 	CUIRect Screen;
 	Graphics()->GetScreen(&Screen.x, &Screen.y, &Screen.w, &Screen.h);
 
@@ -244,12 +307,13 @@ void CMapLayers::OnRender()
 						Graphics()->TextureSet(m_pClient->m_pMapimages->Get(pTMap->m_Image));
 
 					CTile *pTiles = (CTile *)m_pLayers->Map()->GetData(pTMap->m_Data);
+					CTileGeometry *pGeometry = TileGeometry(pGroup->m_StartLayer+l, &pTiles[0].m_Index, &pTiles[0].m_Flags, sizeof(CTile), pTMap->m_Width, pTMap->m_Height);
 					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-					RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+					RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
 													EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 					Graphics()->BlendNormal();
-					RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+					RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
 													EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 				}
 				else if(pLayer->m_Type == LAYERTYPE_QUADS)
@@ -276,12 +340,13 @@ void CMapLayers::OnRender()
 				Graphics()->TextureSet(m_pClient->m_pMapimages->GetEntities());
 
 				CTile *pFrontTiles = (CTile *)m_pLayers->Map()->GetData(pTMap->m_Front);
+				CTileGeometry *pGeometry = TileGeometry(pGroup->m_StartLayer+l, &pFrontTiles[0].m_Index, &pFrontTiles[0].m_Flags, sizeof(CTile), pTMap->m_Width, pTMap->m_Height);
 				Graphics()->BlendNone();
 				vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-				RenderTools()->RenderTilemap(pFrontTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
 						EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 				Graphics()->BlendNormal();
-				RenderTools()->RenderTilemap(pFrontTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
 						EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
 			}
 			else if((g_Config.m_ClShowEntities && g_Config.m_ClDDRaceCheats) && IsSwitchLayer)
@@ -290,11 +355,12 @@ void CMapLayers::OnRender()
 				Graphics()->TextureSet(m_pClient->m_pMapimages->GetEntities());
 
 				CSwitchTile *pSwitchTiles = (CSwitchTile *)m_pLayers->Map()->GetData(pTMap->m_Switch);
+				CTileGeometry *pGeometry = TileGeometry(pGroup->m_StartLayer+l, &pSwitchTiles[0].m_Type, &pSwitchTiles[0].m_Flags, sizeof(CSwitchTile), pTMap->m_Width, pTMap->m_Height);
 				Graphics()->BlendNone();
 				vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-				RenderTools()->RenderSwitchmap(pSwitchTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, 0, 0, -1, 0);
 				Graphics()->BlendNormal();
-				RenderTools()->RenderSwitchmap(pSwitchTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, 0, 0, -1, 0);
 				RenderTools()->RenderSwitchOverlay(pSwitchTiles, pTMap->m_Width, pTMap->m_Height, 32.0f);
 			}
 			else if((g_Config.m_ClShowEntities && g_Config.m_ClDDRaceCheats) && IsTeleLayer)
@@ -303,11 +369,13 @@ void CMapLayers::OnRender()
 				Graphics()->TextureSet(m_pClient->m_pMapimages->GetEntities());
 
 				CTeleTile *pTeleTiles = (CTeleTile *)m_pLayers->Map()->GetData(pTMap->m_Tele);
+				// these have no flags, every tile is rendered in the transparent pass
+				CTileGeometry *pGeometry = TileGeometry(pGroup->m_StartLayer+l, &pTeleTiles[0].m_Type, 0, sizeof(CTeleTile), pTMap->m_Width, pTMap->m_Height);
 				Graphics()->BlendNone();
 				vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-				RenderTools()->RenderTelemap(pTeleTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, 0, 0, -1, 0);
 				Graphics()->BlendNormal();
-				RenderTools()->RenderTelemap(pTeleTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, 0, 0, -1, 0);
 				RenderTools()->RenderTeleOverlay(pTeleTiles, pTMap->m_Width, pTMap->m_Height, 32.0f);
 			}
 			else if((g_Config.m_ClShowEntities && g_Config.m_ClDDRaceCheats) && IsSpeedupLayer)
@@ -316,11 +384,13 @@ void CMapLayers::OnRender()
 				Graphics()->TextureSet(m_pClient->m_pMapimages->GetEntities());
 
 				CSpeedupTile *pSpeedupTiles = (CSpeedupTile *)m_pLayers->Map()->GetData(pTMap->m_Speedup);
+				// these have no flags, every tile is rendered in the transparent pass
+				CTileGeometry *pGeometry = TileGeometry(pGroup->m_StartLayer+l, &pSpeedupTiles[0].m_Type, 0, sizeof(CSpeedupTile), pTMap->m_Width, pTMap->m_Height);
 				Graphics()->BlendNone();
 				vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-				RenderTools()->RenderSpeedupmap(pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE);
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE, 0, 0, -1, 0);
 				Graphics()->BlendNormal();
-				RenderTools()->RenderSpeedupmap(pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT);
+				RenderTools()->RenderTileGeometry(pGeometry, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT, 0, 0, -1, 0);
 				RenderTools()->RenderSpeedupOverlay(pSpeedupTiles, pTMap->m_Width, pTMap->m_Height, 32.0f);
 			}
 		}
@@ -12,7 +12,32 @@ class CMapLayers : public CComponent
 	int m_LastLocalTick;
 	bool m_EnvelopeUpdate;
 
+	// prebuilt geometry of the tile layers, indexed by layer
+	class CTileGeometry *m_paTileGeometries;
+	int m_NumTileGeometries;
+
+	class CTileGeometry *TileGeometry(int Layer, const unsigned char *pIndex, const unsigned char *pFlags, int Stride, int w, int h);
+	void ClearTileGeometries();
+
+	// envelope values of the current frame, many quads and layers share the same envelope and offset
+	enum
+	{
+		ENV_CACHE_SIZE=256,
+	};
+
+	struct CEnvCacheEntry
+	{
+		int m_Frame;
+		int m_Env;
+		float m_TimeOffset;
+		float m_aChannels[4];
+	};
+
+	CEnvCacheEntry m_aEnvCache[ENV_CACHE_SIZE];
+	int m_EnvCacheFrame;
+
 	void MapScreenToGroup(float CenterX, float CenterY, CMapItemGroup *pGroup, float Zoom = 1.0f);
+	void EvalEnvelope(float TimeOffset, int Env, float *pChannels);
 	static void EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser);
 public:
 	enum
@@ -22,7 +47,9 @@ public:
 	};
 
 	CMapLayers(int Type);
+	~CMapLayers();
 	virtual void OnInit();
+	virtual void OnMapLoad();
 	virtual void OnRender();
 
 	void EnvelopeUpdate();
@@ -207,6 +207,9 @@ void CMenus::RenderServerbrowserServerList(CUIRect View)
 	if(s_ScrollValue < 0) s_ScrollValue = 0;
 	if(s_ScrollValue > 1) s_ScrollValue = 1;
 
+	// let the browser request infos for the servers on screen first
+	ServerBrowser()->SetVisibleRange((int)(s_ScrollValue*ScrollNum), Num);
+
 	// set clipping
 	UI()->ClipEnable(&View);
 
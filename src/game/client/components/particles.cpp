@@ -9,6 +9,14 @@
 #include <game/gamecore.h>
 #include "particles.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CONF_PARTICLES_SSE2 1
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+	#define CONF_PARTICLES_NEON 1
+	#include <arm_neon.h>
+#endif
+
 CParticles::CParticles()
 {
 	OnReset();
@@ -21,18 +29,9 @@ CParticles::CParticles()
 void CParticles::OnReset()
 {
 	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
-	{
-		m_aParticles[i].m_PrevPart = i-1;
-		m_aParticles[i].m_NextPart = i+1;
-	}
-
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES-1].m_NextPart = -1;
-	m_FirstFree = 0;
-
 	for(int i = 0; i < NUM_GROUPS; i++)
-		m_aFirstPart[i] = -1;
+		m_aGroups[i].m_Num = 0;
+	m_NumParticles = 0;
 }
 
 void CParticles::Add(int Group, CParticle *pPart)
@@ -49,31 +48,120 @@ void CParticles::Add(int Group, CParticle *pPart)
 			return;
 	}
 
-	if (m_FirstFree == -1)
+	if(m_NumParticles >= MAX_PARTICLES)
+		return;
+
+	// append to the group
+	CGroup *pGroup = &m_aGroups[Group];
+	int Id = pGroup->m_Num++;
+	m_NumParticles++;
+
+	pGroup->m_aPosX[Id] = pPart->m_Pos.x;
+	pGroup->m_aPosY[Id] = pPart->m_Pos.y;
+	pGroup->m_aVelX[Id] = pPart->m_Vel.x;
+	pGroup->m_aVelY[Id] = pPart->m_Vel.y;
+	pGroup->m_aGravity[Id] = pPart->m_Gravity;
+	pGroup->m_aFriction[Id] = pPart->m_Friction;
+	pGroup->m_aLife[Id] = 0;
+	pGroup->m_aLifeSpan[Id] = pPart->m_LifeSpan;
+	pGroup->m_aRot[Id] = pPart->m_Rot;
+	pGroup->m_aRotspeed[Id] = pPart->m_Rotspeed;
+	pGroup->m_aLook[Id].m_Spr = pPart->m_Spr;
+	pGroup->m_aLook[Id].m_StartSize = pPart->m_StartSize;
+	pGroup->m_aLook[Id].m_EndSize = pPart->m_EndSize;
+	pGroup->m_aLook[Id].m_Color = pPart->m_Color;
+}
+
+void CParticles::Remove(CGroup *pGroup, int Index)
+{
+	int Last = --pGroup->m_Num;
+	m_NumParticles--;
+	if(Index == Last)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
+	pGroup->m_aPosX[Index] = pGroup->m_aPosX[Last];
+	pGroup->m_aPosY[Index] = pGroup->m_aPosY[Last];
+	pGroup->m_aVelX[Index] = pGroup->m_aVelX[Last];
+	pGroup->m_aVelY[Index] = pGroup->m_aVelY[Last];
+	pGroup->m_aGravity[Index] = pGroup->m_aGravity[Last];
+	pGroup->m_aFriction[Index] = pGroup->m_aFriction[Last];
+	pGroup->m_aLife[Index] = pGroup->m_aLife[Last];
+	pGroup->m_aLifeSpan[Index] = pGroup->m_aLifeSpan[Last];
+	pGroup->m_aRot[Index] = pGroup->m_aRot[Last];
+	pGroup->m_aRotspeed[Index] = pGroup->m_aRotspeed[Last];
+	pGroup->m_aLook[Index] = pGroup->m_aLook[Last];
+	m_aTargetX[Index] = m_aTargetX[Last];
+	m_aTargetY[Index] = m_aTargetY[Last];
+	m_aSolid[Index] = m_aSolid[Last];
+}
 
-	// copy data
-	m_aParticles[Id] = *pPart;
+// applies gravity and friction, advances life and rotation and
+// writes the position each particle wants to move to
+void CParticles::Integrate(CGroup *pGroup, float TimePassed, int FrictionCount)
+{
+	int Num = pGroup->m_Num;
+	int i = 0;
 
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
+#if defined(CONF_PARTICLES_SSE2)
+	__m128 Time = _mm_set1_ps(TimePassed);
+	for(; i+4 <= Num; i += 4)
+	{
+		__m128 VelX = _mm_loadu_ps(&pGroup->m_aVelX[i]);
+		__m128 VelY = _mm_add_ps(_mm_loadu_ps(&pGroup->m_aVelY[i]), _mm_mul_ps(_mm_loadu_ps(&pGroup->m_aGravity[i]), Time));
+		__m128 Friction = _mm_loadu_ps(&pGroup->m_aFriction[i]);
+		for(int f = 0; f < FrictionCount; f++)
+		{
+			VelX = _mm_mul_ps(VelX, Friction);
+			VelY = _mm_mul_ps(VelY, Friction);
+		}
+		_mm_storeu_ps(&pGroup->m_aVelX[i], VelX);
+		_mm_storeu_ps(&pGroup->m_aVelY[i], VelY);
+		_mm_storeu_ps(&m_aTargetX[i], _mm_add_ps(_mm_loadu_ps(&pGroup->m_aPosX[i]), _mm_mul_ps(VelX, Time)));
+		_mm_storeu_ps(&m_aTargetY[i], _mm_add_ps(_mm_loadu_ps(&pGroup->m_aPosY[i]), _mm_mul_ps(VelY, Time)));
+		_mm_storeu_ps(&pGroup->m_aLife[i], _mm_add_ps(_mm_loadu_ps(&pGroup->m_aLife[i]), Time));
+		_mm_storeu_ps(&pGroup->m_aRot[i], _mm_add_ps(_mm_loadu_ps(&pGroup->m_aRot[i]), _mm_mul_ps(_mm_loadu_ps(&pGroup->m_aRotspeed[i]), Time)));
+	}
+#elif defined(CONF_PARTICLES_NEON)
+	float32x4_t Time = vdupq_n_f32(TimePassed);
+	for(; i+4 <= Num; i += 4)
+	{
+		float32x4_t VelX = vld1q_f32(&pGroup->m_aVelX[i]);
+		float32x4_t VelY = vaddq_f32(vld1q_f32(&pGroup->m_aVelY[i]), vmulq_f32(vld1q_f32(&pGroup->m_aGravity[i]), Time));
+		float32x4_t Friction = vld1q_f32(&pGroup->m_aFriction[i]);
+		for(int f = 0; f < FrictionCount; f++)
+		{
+			VelX = vmulq_f32(VelX, Friction);
+			VelY = vmulq_f32(VelY, Friction);
+		}
+		vst1q_f32(&pGroup->m_aVelX[i], VelX);
+		vst1q_f32(&pGroup->m_aVelY[i], VelY);
+		vst1q_f32(&m_aTargetX[i], vaddq_f32(vld1q_f32(&pGroup->m_aPosX[i]), vmulq_f32(VelX, Time)));
+		vst1q_f32(&m_aTargetY[i], vaddq_f32(vld1q_f32(&pGroup->m_aPosY[i]), vmulq_f32(VelY, Time)));
+		vst1q_f32(&pGroup->m_aLife[i], vaddq_f32(vld1q_f32(&pGroup->m_aLife[i]), Time));
+		vst1q_f32(&pGroup->m_aRot[i], vaddq_f32(vld1q_f32(&pGroup->m_aRot[i]), vmulq_f32(vld1q_f32(&pGroup->m_aRotspeed[i]), Time)));
+	}
+#endif
 
-	// set some parameters
-	m_aParticles[Id].m_Life = 0;
+	for(; i < Num; i++)
+	{
+		pGroup->m_aVelY[i] += pGroup->m_aGravity[i]*TimePassed;
+		for(int f = 0; f < FrictionCount; f++) // apply friction
+		{
+			pGroup->m_aVelX[i] *= pGroup->m_aFriction[i];
+			pGroup->m_aVelY[i] *= pGroup->m_aFriction[i];
+		}
+		m_aTargetX[i] = pGroup->m_aPosX[i] + pGroup->m_aVelX[i]*TimePassed;
+		m_aTargetY[i] = pGroup->m_aPosY[i] + pGroup->m_aVelY[i]*TimePassed;
+		pGroup->m_aLife[i] += TimePassed;
+		pGroup->m_aRot[i] += TimePassed * pGroup->m_aRotspeed[i];
+	}
 }
 
 void CParticles::Update(float TimePassed)
 {
+	if(TimePassed <= 0.0f)
+		return;
+
 	static float FrictionFraction = 0;
 	FrictionFraction += TimePassed;
 
@@ -89,45 +177,42 @@ void CParticles::Update(float TimePassed)
 
 	for(int g = 0; g < NUM_GROUPS; g++)
 	{
-		int i = m_aFirstPart[g];
-		while(i != -1)
-		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity*TimePassed;
+		CGroup *pGroup = &m_aGroups[g];
+		if(!pGroup->m_Num)
+			continue;
 
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
-
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel*TimePassed;
-			Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
-			m_aParticles[i].m_Vel = Vel* (1.0f/TimePassed);
-
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
+		Integrate(pGroup, TimePassed, FrictionCount);
+		Collision()->CheckPoints(m_aTargetX, m_aTargetY, pGroup->m_Num, m_aSolid);
 
+		int i = 0;
+		while(i < pGroup->m_Num)
+		{
 			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
+			if(pGroup->m_aLife[i] > pGroup->m_aLifeSpan[i])
 			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					m_aFirstPart[g] = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
+				Remove(pGroup, i);
+				continue;
 			}
 
-			i = Next;
+			// move the point, only the ones that hit something need the full collision response
+			if(!m_aSolid[i])
+			{
+				pGroup->m_aPosX[i] = m_aTargetX[i];
+				pGroup->m_aPosY[i] = m_aTargetY[i];
+			}
+			else
+			{
+				vec2 Pos(pGroup->m_aPosX[i], pGroup->m_aPosY[i]);
+				vec2 Vel = vec2(pGroup->m_aVelX[i], pGroup->m_aVelY[i])*TimePassed;
+				Collision()->MovePoint(&Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
+				Vel *= 1.0f/TimePassed;
+				pGroup->m_aPosX[i] = Pos.x;
+				pGroup->m_aPosY[i] = Pos.y;
+				pGroup->m_aVelX[i] = Vel.x;
+				pGroup->m_aVelY[i] = Vel.y;
+			}
+
+			i++;
 		}
 	}
 }
@@ -162,26 +247,24 @@ void CParticles::RenderGroup(int Group)
 	Graphics()->TextureSet(g_pData->m_aImages[IMAGE_PARTICLES].m_Id);
 	Graphics()->QuadsBegin();
 
-	int i = m_aFirstPart[Group];
-	while(i != -1)
+	const CGroup *pGroup = &m_aGroups[Group];
+	for(int i = pGroup->m_Num-1; i >= 0; i--)
 	{
-		RenderTools()->SelectSprite(m_aParticles[i].m_Spr);
-		float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-		vec2 p = m_aParticles[i].m_Pos;
-		float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
+		const CLook *pLook = &pGroup->m_aLook[i];
+		RenderTools()->SelectSprite(pLook->m_Spr);
+		float a = pGroup->m_aLife[i] / pGroup->m_aLifeSpan[i];
+		float Size = mix(pLook->m_StartSize, pLook->m_EndSize, a);
 
-		Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+		Graphics()->QuadsSetRotation(pGroup->m_aRot[i]);
 
 		Graphics()->SetColor(
-			m_aParticles[i].m_Color.r,
-			m_aParticles[i].m_Color.g,
-			m_aParticles[i].m_Color.b,
-			m_aParticles[i].m_Color.a); // pow(a, 0.75f) *
+			pLook->m_Color.r,
+			pLook->m_Color.g,
+			pLook->m_Color.b,
+			pLook->m_Color.a); // pow(a, 0.75f) *
 
-		IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
+		IGraphics::CQuadItem QuadItem(pGroup->m_aPosX[i], pGroup->m_aPosY[i], Size, Size);
 		Graphics()->QuadsDraw(&QuadItem, 1);
-
-		i = m_aParticles[i].m_NextPart;
 	}
 	Graphics()->QuadsEnd();
 	Graphics()->BlendNormal();
@@ -41,11 +41,6 @@ struct CParticle
 	float m_Friction;
 
 	vec4 m_Color;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
 };
 
 class CParticles : public CComponent
@@ -74,12 +69,45 @@ private:
 		MAX_PARTICLES=1024*8,
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	// only needed for rendering
+	struct CLook
+	{
+		int m_Spr;
+		float m_StartSize;
+		float m_EndSize;
+		vec4 m_Color;
+	};
+
+	// structure of arrays per group, the update walks the fields it needs linearly.
+	// particles are unordered, dead ones get replaced by the last one
+	struct CGroup
+	{
+		int m_Num;
+		float m_aPosX[MAX_PARTICLES];
+		float m_aPosY[MAX_PARTICLES];
+		float m_aVelX[MAX_PARTICLES];
+		float m_aVelY[MAX_PARTICLES];
+		float m_aGravity[MAX_PARTICLES];
+		float m_aFriction[MAX_PARTICLES];
+		float m_aLife[MAX_PARTICLES];
+		float m_aLifeSpan[MAX_PARTICLES];
+		float m_aRot[MAX_PARTICLES];
+		float m_aRotspeed[MAX_PARTICLES];
+		CLook m_aLook[MAX_PARTICLES];
+	};
+
+	CGroup m_aGroups[NUM_GROUPS];
+	int m_NumParticles;
+
+	// scratch space for the update
+	float m_aTargetX[MAX_PARTICLES];
+	float m_aTargetY[MAX_PARTICLES];
+	unsigned char m_aSolid[MAX_PARTICLES];
 
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
+	void Integrate(CGroup *pGroup, float TimePassed, int FrictionCount);
+	void Remove(CGroup *pGroup, int Index);
 
 	template<int TGROUP>
 	class CRenderGroup : public CComponent
@@ -5,9 +5,11 @@
 #include <base/system.h>
 #include <base/math.h>
 
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/storage.h>
 #include <engine/shared/config.h>
+#include <game/client/gameclient.h>
 
 #include "skins.h"
 
@@ -18,21 +20,34 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 	if(l < 4 || IsDir || str_comp(pName+l-4, ".png") != 0)
 		return 0;
 
+	// start decoding right away, the directory scan goes on meanwhile
+	CLoadJob *pJob = new CLoadJob;
+	str_copy(pJob->m_aName, pName, sizeof(pJob->m_aName));
+	pJob->m_DirType = DirType;
+	pJob->m_pGraphics = pSelf->Graphics();
+	pJob->m_Loaded = false;
+	pJob->m_pColorData = 0;
+	pSelf->m_apLoadJobs.add(pJob);
+	pSelf->m_pClient->Engine()->AddJob(&pJob->m_Job, LoadSkinJob, pJob, &pSelf->m_LoadGroup);
+
+	return 0;
+}
+
+int CSkins::LoadSkinJob(void *pUser)
+{
+	CLoadJob *pJob = (CLoadJob *)pUser;
+
 	char aBuf[512];
-	str_format(aBuf, sizeof(aBuf), "skins/%s", pName);
+	str_format(aBuf, sizeof(aBuf), "skins/%s", pJob->m_aName);
 	CImageInfo Info;
-	if(!pSelf->Graphics()->LoadPNG(&Info, aBuf, DirType))
-	{
-		str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pName);
-		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+	if(!pJob->m_pGraphics->LoadPNG(&Info, aBuf, pJob->m_DirType))
 		return 0;
-	}
-
-	CSkin Skin;
-	Skin.m_OrgTexture = pSelf->Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
 
 	int BodySize = 96; // body size
-	unsigned char *d = (unsigned char *)Info.m_pData;
+	int Step = Info.m_Format == CImageInfo::FORMAT_RGBA ? 4 : 3;
+	int DataSize = Info.m_Width*Info.m_Height*Step;
+	unsigned char *d = (unsigned char *)mem_alloc(DataSize, 1);
+	mem_copy(d, Info.m_pData, DataSize);
 	int Pitch = Info.m_Width*4;
 
 	// dig out blood color
@@ -49,11 +64,10 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 				}
 			}
 
-		Skin.m_BloodColor = normalize(vec3(aColors[0], aColors[1], aColors[2]));
+		pJob->m_BloodColor = normalize(vec3(aColors[0], aColors[1], aColors[2]));
 	}
 
 	// create colorless version
-	int Step = Info.m_Format == CImageInfo::FORMAT_RGBA ? 4 : 3;
 
 	// make the texture gray scale
 	for(int i = 0; i < Info.m_Width*Info.m_Height; i++)
@@ -99,27 +113,59 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 			d[y*Pitch+x*4+2] = v;
 		}
 
-	Skin.m_ColorTexture = pSelf->Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
-	mem_free(Info.m_pData);
-
-	// set skin data
-	str_copy(Skin.m_aName, pName, min((int)sizeof(Skin.m_aName),l-3));
-	if(g_Config.m_Debug)
-	{
-		str_format(aBuf, sizeof(aBuf), "load skin %s", Skin.m_aName);
-		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-	}
-	pSelf->m_aSkins.add(Skin);
-
+	pJob->m_Info = Info;
+	pJob->m_pColorData = d;
+	pJob->m_Loaded = true;
 	return 0;
 }
 
 
 void CSkins::OnInit()
 {
+	int64 Start = time_get();
+
 	// load skins
 	m_aSkins.clear();
+	m_apLoadJobs.clear();
+	m_LoadGroup.Reset();
 	Storage()->ListDirectory(IStorage::TYPE_ALL, "skins", SkinScan, this);
+
+	// help decoding until all are done, then upload them in scan order
+	m_pClient->Engine()->WaitJobGroup(&m_LoadGroup);
+
+	char aBuf[512];
+	for(int i = 0; i < m_apLoadJobs.size(); i++)
+	{
+		CLoadJob *pJob = m_apLoadJobs[i];
+
+		if(!pJob->m_Loaded)
+		{
+			str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pJob->m_aName);
+			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+			delete pJob;
+			continue;
+		}
+
+		CImageInfo *pInfo = &pJob->m_Info;
+		CSkin Skin;
+		Skin.m_OrgTexture = Graphics()->LoadTextureRaw(pInfo->m_Width, pInfo->m_Height, pInfo->m_Format, pInfo->m_pData, pInfo->m_Format, 0);
+		Skin.m_ColorTexture = Graphics()->LoadTextureRaw(pInfo->m_Width, pInfo->m_Height, pInfo->m_Format, pJob->m_pColorData, pInfo->m_Format, 0);
+		Skin.m_BloodColor = pJob->m_BloodColor;
+		mem_free(pInfo->m_pData);
+		mem_free(pJob->m_pColorData);
+
+		// set skin data
+		str_copy(Skin.m_aName, pJob->m_aName, min((int)sizeof(Skin.m_aName), str_length(pJob->m_aName)-3));
+		if(g_Config.m_Debug)
+		{
+			str_format(aBuf, sizeof(aBuf), "load skin %s", Skin.m_aName);
+			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		}
+		m_aSkins.add(Skin);
+		delete pJob;
+	}
+	m_apLoadJobs.clear();
+
 	if(!m_aSkins.size())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
@@ -130,6 +176,9 @@ void CSkins::OnInit()
 		DummySkin.m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
 		m_aSkins.add(DummySkin);
 	}
+
+	str_format(aBuf, sizeof(aBuf), "loaded %d skins in %.2fms", m_aSkins.size(), ((time_get()-Start)*1000)/(float)time_freq());
+	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "skins", aBuf);
 }
 
 int CSkins::Num()
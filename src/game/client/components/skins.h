@@ -3,7 +3,10 @@
 #ifndef GAME_CLIENT_COMPONENTS_SKINS_H
 #define GAME_CLIENT_COMPONENTS_SKINS_H
 #include <base/vmath.h>
+#include <base/tl/array.h>
 #include <base/tl/sorted_array.h>
+#include <engine/graphics.h>
+#include <engine/shared/jobs.h>
 #include <game/client/component.h>
 
 class CSkins : public CComponent
@@ -29,8 +32,25 @@ public:
 	int Find(const char *pName);
 
 private:
+	// decodes a skin on the job pool, the textures are created on the main thread
+	struct CLoadJob
+	{
+		CJob m_Job;
+		char m_aName[128];
+		int m_DirType;
+		IGraphics *m_pGraphics;
+
+		bool m_Loaded;
+		CImageInfo m_Info;
+		unsigned char *m_pColorData;
+		vec3 m_BloodColor;
+	};
+
 	sorted_array<CSkin> m_aSkins;
+	array<CLoadJob *> m_apLoadJobs;
+	CJobGroup m_LoadGroup;
 
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
+	static int LoadSkinJob(void *pUser);
 };
 #endif
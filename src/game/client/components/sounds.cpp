@@ -17,13 +17,16 @@ struct CUserData
 {
 	CGameClient *m_pGameClient;
 	bool m_Render;
-} g_UserData;
+	// every m_Step-th sound set starting at m_First
+	int m_First;
+	int m_Step;
+} g_aUserData[CSounds::NUM_SOUND_JOBS];
 
 static int LoadSoundsThread(void *pUser)
 {
 	CUserData *pData = static_cast<CUserData *>(pUser);
 
-	for(int s = 0; s < g_pData->m_NumSounds; s++)
+	for(int s = pData->m_First; s < g_pData->m_NumSounds; s += pData->m_Step)
 	{
 		for(int i = 0; i < g_pData->m_aSounds[s].m_NumSounds; i++)
 		{
@@ -38,6 +41,14 @@ static int LoadSoundsThread(void *pUser)
 	return 0;
 }
 
+int CSounds::SoundsLoadedJob(void *pUser)
+{
+	CSounds *pSelf = static_cast<CSounds *>(pUser);
+	if(g_Config.m_Debug)
+		dbg_msg("sounds", "loaded sounds in %.2fms", ((time_get()-pSelf->m_SoundLoadStart)*1000)/(float)time_freq());
+	return 0;
+}
+
 int CSounds::GetSampleId(int SetId)
 {
 	if(!g_Config.m_SndEnable || !Sound()->IsSoundEnabled() || m_WaitForSoundJob || SetId < 0 || SetId >= g_pData->m_NumSounds)
@@ -76,16 +87,28 @@ void CSounds::OnInit()
 	// load sounds
 	if(g_Config.m_ClThreadsoundloading)
 	{
-		g_UserData.m_pGameClient = m_pClient;
-		g_UserData.m_Render = false;
-		m_pClient->Engine()->AddJob(&m_SoundJob, LoadSoundsThread, &g_UserData);
+		// spread the sound sets over several jobs, the continuation
+		// runs once all of them are done
+		m_SoundLoadStart = time_get();
+		m_SoundJobGroup.Reset();
+		for(int i = 0; i < NUM_SOUND_JOBS; i++)
+		{
+			g_aUserData[i].m_pGameClient = m_pClient;
+			g_aUserData[i].m_Render = false;
+			g_aUserData[i].m_First = i;
+			g_aUserData[i].m_Step = NUM_SOUND_JOBS;
+			m_pClient->Engine()->AddJob(&m_aSoundJobs[i], LoadSoundsThread, &g_aUserData[i], &m_SoundJobGroup);
+		}
+		m_pClient->Engine()->AddJobContinuation(&m_SoundJobGroup, &m_SoundsLoadedJob, SoundsLoadedJob, this);
 		m_WaitForSoundJob = true;
 	}
 	else
 	{
-		g_UserData.m_pGameClient = m_pClient;
-		g_UserData.m_Render = true;
-		LoadSoundsThread(&g_UserData);
+		g_aUserData[0].m_pGameClient = m_pClient;
+		g_aUserData[0].m_Render = true;
+		g_aUserData[0].m_First = 0;
+		g_aUserData[0].m_Step = 1;
+		LoadSoundsThread(&g_aUserData[0]);
 		m_WaitForSoundJob = false;
 	}
 }
@@ -110,10 +133,10 @@ void CSounds::OnRender()
 	// check for sound initialisation
 	if(m_WaitForSoundJob)
 	{
-		if(m_SoundJob.Status() == CJob::STATE_DONE)
-			m_WaitForSoundJob = false;
-		else
+		if(m_SoundsLoadedJob.Status() != CJob::STATE_DONE)
 			return;
+		sync_barrier();
+		m_WaitForSoundJob = false;
 	}
 
 	// set listner pos
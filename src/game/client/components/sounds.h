@@ -2,10 +2,19 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_SOUNDS_H
 #define GAME_CLIENT_COMPONENTS_SOUNDS_H
+#include <engine/shared/jobs.h>
 #include <game/client/component.h>
 
 class CSounds : public CComponent
 {
+public:
+	// sound sets are loaded by this many jobs in parallel
+	enum
+	{
+		NUM_SOUND_JOBS = 4,
+	};
+
+private:
 	enum
 	{
 		QUEUE_SIZE = 32,
@@ -17,8 +26,13 @@ class CSounds : public CComponent
 	} m_aQueue[QUEUE_SIZE];
 	int m_QueuePos;
 	int64 m_QueueWaitTime;
-	class CJob m_SoundJob;
+	CJob m_aSoundJobs[NUM_SOUND_JOBS];
+	CJobGroup m_SoundJobGroup;
+	CJob m_SoundsLoadedJob;
+	int64 m_SoundLoadStart;
 	bool m_WaitForSoundJob;
+
+	static int SoundsLoadedJob(void *pUser);
 	
 	int GetSampleId(int SetId);
 
@@ -21,6 +21,7 @@
 #include "render.h"
 
 #include "gameclient.h"
+#include "imageloader.h"
 
 #include "components/binds.h"
 #include "components/broadcast.h"
@@ -93,7 +94,7 @@ static CRaceDemo gs_RaceDemo;
 static CGhost gs_Ghost;
 
 CGameClient::CStack::CStack() { m_Num = 0; }
-void CGameClient::CStack::Add(class CComponent *pComponent) { m_paComponents[m_Num++] = pComponent; }
+void CGameClient::CStack::Add(class CComponent *pComponent, const char *pName) { m_apNames[m_Num] = pName; m_paComponents[m_Num++] = pComponent; }
 
 const char *CGameClient::Version() { return GAME_VERSION; }
 const char *CGameClient::NetVersion() { return GAME_NETVERSION; }
@@ -140,40 +141,40 @@ void CGameClient::OnConsoleInit()
 	m_pGhost = &::gs_Ghost;
 
 	// make a list of all the systems, make sure to add them in the corrent render order
-	m_All.Add(m_pSkins);
-	m_All.Add(m_pCountryFlags);
-	m_All.Add(m_pMapimages);
-	m_All.Add(m_pEffects); // doesn't render anything, just updates effects
-	m_All.Add(m_pParticles);
-	m_All.Add(m_pBinds);
-	m_All.Add(m_pControls);
-	m_All.Add(m_pCamera);
-	m_All.Add(m_pSounds);
-	m_All.Add(m_pVoting);
-	m_All.Add(m_pParticles); // doesn't render anything, just updates all the particles
-	m_All.Add(m_pRaceDemo);
-
-	m_All.Add(&gs_MapLayersBackGround); // first to render
-	m_All.Add(&m_pParticles->m_RenderTrail);
-	m_All.Add(m_pItems);
-	m_All.Add(&gs_Players);
-	m_All.Add(m_pGhost);
-	m_All.Add(&gs_MapLayersForeGround);
-	m_All.Add(&m_pParticles->m_RenderExplosions);
-	m_All.Add(&gs_NamePlates);
-	m_All.Add(&m_pParticles->m_RenderGeneral);
-	m_All.Add(m_pDamageind);
-	m_All.Add(&gs_Hud);
-	m_All.Add(&gs_Spectator);
-	m_All.Add(&gs_Emoticon);
-	m_All.Add(&gs_KillMessages);
-	m_All.Add(m_pChat);
-	m_All.Add(&gs_Broadcast);
-	m_All.Add(&gs_DebugHud);
-	m_All.Add(&gs_Scoreboard);
-	m_All.Add(m_pMotd);
-	m_All.Add(m_pMenus);
-	m_All.Add(m_pGameConsole);
+	m_All.Add(m_pSkins, "skins");
+	m_All.Add(m_pCountryFlags, "countryflags");
+	m_All.Add(m_pMapimages, "mapimages");
+	m_All.Add(m_pEffects, "effects"); // doesn't render anything, just updates effects
+	m_All.Add(m_pParticles, "particles");
+	m_All.Add(m_pBinds, "binds");
+	m_All.Add(m_pControls, "controls");
+	m_All.Add(m_pCamera, "camera");
+	m_All.Add(m_pSounds, "sounds");
+	m_All.Add(m_pVoting, "voting");
+	m_All.Add(m_pParticles, "particles"); // doesn't render anything, just updates all the particles
+	m_All.Add(m_pRaceDemo, "racedemo");
+
+	m_All.Add(&gs_MapLayersBackGround, "maplayers_bg"); // first to render
+	m_All.Add(&m_pParticles->m_RenderTrail, "particles_trail");
+	m_All.Add(m_pItems, "items");
+	m_All.Add(&gs_Players, "players");
+	m_All.Add(m_pGhost, "ghost");
+	m_All.Add(&gs_MapLayersForeGround, "maplayers_fg");
+	m_All.Add(&m_pParticles->m_RenderExplosions, "particles_explosions");
+	m_All.Add(&gs_NamePlates, "nameplates");
+	m_All.Add(&m_pParticles->m_RenderGeneral, "particles_general");
+	m_All.Add(m_pDamageind, "damageind");
+	m_All.Add(&gs_Hud, "hud");
+	m_All.Add(&gs_Spectator, "spectator");
+	m_All.Add(&gs_Emoticon, "emoticon");
+	m_All.Add(&gs_KillMessages, "killmessages");
+	m_All.Add(m_pChat, "chat");
+	m_All.Add(&gs_Broadcast, "broadcast");
+	m_All.Add(&gs_DebugHud, "debughud");
+	m_All.Add(&gs_Scoreboard, "scoreboard");
+	m_All.Add(m_pMotd, "motd");
+	m_All.Add(m_pMenus, "menus");
+	m_All.Add(m_pGameConsole, "console");
 
 	// build the input stack
 	m_Input.Add(&m_pMenus->m_Binder); // this will take over all input when we want to bind a key
@@ -239,6 +240,10 @@ void CGameClient::OnInit()
 	m_UI.SetGraphics(Graphics(), TextRender());
 	m_RenderTools.m_pGraphics = Graphics();
 	m_RenderTools.m_pUI = UI();
+
+	mem_zero(m_aBenchRenderTime, sizeof(m_aBenchRenderTime));
+	mem_zero(m_aBenchRenderTimeMax, sizeof(m_aBenchRenderTimeMax));
+	m_BenchFrames = 0;
 	
 	int64 Start = time_get();
 
@@ -263,16 +268,29 @@ void CGameClient::OnInit()
 	if(!pDefaultFont)
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load font. filename='fonts/DejaVuSans.ttf'");
 
+	// start decoding the textures, they are uploaded after the components are set up
+	CImageLoader *pImageLoaders = new CImageLoader[g_pData->m_NumImages];
+	for(int i = 0; i < g_pData->m_NumImages; i++)
+		pImageLoaders[i].Start(Engine(), Graphics(), g_pData->m_aImages[i].m_pFilename, IStorage::TYPE_ALL);
+
 	// init all components
+	int64 aInitTime[CStack::MAX_COMPONENTS];
 	for(int i = m_All.m_Num-1; i >= 0; --i)
+	{
+		int64 ComponentStart = time_get();
 		m_All.m_paComponents[i]->OnInit();
+		aInitTime[i] = time_get()-ComponentStart;
+	}
 
 	// setup load amount// load textures
+	int64 ImagesStart = time_get();
 	for(int i = 0; i < g_pData->m_NumImages; i++)
 	{
-		g_pData->m_aImages[i].m_Id = Graphics()->LoadTexture(g_pData->m_aImages[i].m_pFilename, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+		g_pData->m_aImages[i].m_Id = pImageLoaders[i].Upload(CImageInfo::FORMAT_AUTO, 0);
 		g_GameClient.m_pMenus->RenderLoading();
 	}
+	delete [] pImageLoaders;
+	int64 ImagesTime = time_get()-ImagesStart;
 
 	for(int i = 0; i < m_All.m_Num; i++)
 		m_All.m_paComponents[i]->OnReset();
@@ -282,6 +300,17 @@ void CGameClient::OnInit()
 	str_format(aBuf, sizeof(aBuf), "initialisation finished after %.2fms", ((End-Start)*1000)/(float)time_freq());
 	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "gameclient", aBuf);
 
+	// startup timing report, only what took a noticeable amount of time
+	for(int i = m_All.m_Num-1; i >= 0; --i)
+	{
+		if(aInitTime[i] < time_freq()/1000)
+			continue;
+		str_format(aBuf, sizeof(aBuf), "  %-22s %.2fms", m_All.m_apNames[i], (aInitTime[i]*1000)/(float)time_freq());
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "gameclient", aBuf);
+	}
+	str_format(aBuf, sizeof(aBuf), "  %-22s %.2fms", "images", (ImagesTime*1000)/(float)time_freq());
+	Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "gameclient", aBuf);
+
 	m_ServerMode = SERVERMODE_PURE;
 
 	m_DDRaceMsgSent = false;
@@ -467,8 +496,24 @@ void CGameClient::OnRender()
 	DispatchInput();
 
 	// render all systems
-	for(int i = 0; i < m_All.m_Num; i++)
-		m_All.m_paComponents[i]->OnRender();
+	if(g_Config.m_DbgBench[0] && Client()->State() == IClient::STATE_DEMOPLAYBACK)
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+		{
+			int64 Start = time_get();
+			m_All.m_paComponents[i]->OnRender();
+			int64 Time = time_get()-Start;
+			m_aBenchRenderTime[i] += Time;
+			if(Time > m_aBenchRenderTimeMax[i])
+				m_aBenchRenderTimeMax[i] = Time;
+		}
+		m_BenchFrames++;
+	}
+	else
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+			m_All.m_paComponents[i]->OnRender();
+	}
 
 	// clear new tick flags
 	m_NewTick = false;
@@ -620,6 +665,28 @@ void CGameClient::OnStateChange(int NewState, int OldState)
 void CGameClient::OnShutdown()
 {
 	m_pRaceDemo->OnShutdown();
+
+	if(m_BenchFrames)
+		BenchReport();
+}
+
+void CGameClient::BenchReport()
+{
+	char aBuf[256];
+	double Freq = (double)time_freq();
+	int64 Total = 0;
+	for(int i = 0; i < m_All.m_Num; i++)
+		Total += m_aBenchRenderTime[i];
+
+	str_format(aBuf, sizeof(aBuf), "component render times over %d frames, %.3fms per frame", m_BenchFrames, Total*1000.0/Freq/m_BenchFrames);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+	for(int i = 0; i < m_All.m_Num; i++)
+	{
+		str_format(aBuf, sizeof(aBuf), "%2d %-22s avg=%.4fms max=%.4fms share=%.1f%%", i, m_All.m_apNames[i],
+			m_aBenchRenderTime[i]*1000.0/Freq/m_BenchFrames, m_aBenchRenderTimeMax[i]*1000.0/Freq,
+			Total ? m_aBenchRenderTime[i]*100.0/Total : 0.0);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bench", aBuf);
+	}
 }
 
 void CGameClient::OnEnterGame() {}
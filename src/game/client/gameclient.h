@@ -23,9 +23,10 @@ class CGameClient : public IGameClient
 		};
 
 		CStack();
-		void Add(class CComponent *pComponent);
+		void Add(class CComponent *pComponent, const char *pName = "");
 
 		class CComponent *m_paComponents[MAX_COMPONENTS];
+		const char *m_apNames[MAX_COMPONENTS];
 		int m_Num;
 	};
 
@@ -60,6 +61,13 @@ class CGameClient : public IGameClient
 
 	int64 m_LastSendInfo;
 
+	// benchmark, time spent in OnRender per component
+	int64 m_aBenchRenderTime[CStack::MAX_COMPONENTS];
+	int64 m_aBenchRenderTimeMax[CStack::MAX_COMPONENTS];
+	int m_BenchFrames;
+
+	void BenchReport();
+
 	static void ConTeam(IConsole::IResult *pResult, void *pUserData);
 	static void ConKill(IConsole::IResult *pResult, void *pUserData);
 
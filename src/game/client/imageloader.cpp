@@ -0,0 +1,62 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/engine.h>
+
+#include "imageloader.h"
+
+CImageLoader::CImageLoader()
+{
+	m_pEngine = 0;
+	m_pGraphics = 0;
+	m_aFilename[0] = 0;
+	m_StorageType = 0;
+	m_Loaded = false;
+	m_Info.m_pData = 0;
+}
+
+CImageLoader::~CImageLoader()
+{
+	Wait();
+	if(m_Info.m_pData)
+		mem_free(m_Info.m_pData);
+}
+
+int CImageLoader::LoadThread(void *pUser)
+{
+	CImageLoader *pSelf = (CImageLoader *)pUser;
+	pSelf->m_Loaded = pSelf->m_pGraphics->LoadPNG(&pSelf->m_Info, pSelf->m_aFilename, pSelf->m_StorageType) != 0;
+	return 0;
+}
+
+void CImageLoader::Start(IEngine *pEngine, IGraphics *pGraphics, const char *pFilename, int StorageType)
+{
+	m_pEngine = pEngine;
+	m_pGraphics = pGraphics;
+	str_copy(m_aFilename, pFilename, sizeof(m_aFilename));
+	m_StorageType = StorageType;
+	m_Loaded = false;
+	m_Info.m_pData = 0;
+	pEngine->AddJob(&m_Job, LoadThread, this);
+}
+
+bool CImageLoader::Wait()
+{
+	if(m_pEngine)
+		m_pEngine->WaitJob(&m_Job);
+	return m_Loaded;
+}
+
+int CImageLoader::Upload(int StoreFormat, int Flags)
+{
+	if(!Wait())
+		return m_pGraphics->LoadTexture(m_aFilename, m_StorageType, StoreFormat, Flags);
+
+	if(StoreFormat == CImageInfo::FORMAT_AUTO)
+		StoreFormat = m_Info.m_Format;
+	int ID = m_pGraphics->LoadTextureRaw(m_Info.m_Width, m_Info.m_Height, m_Info.m_Format, m_Info.m_pData, StoreFormat, Flags);
+	mem_free(m_Info.m_pData);
+	m_Info.m_pData = 0;
+	return ID;
+}
@@ -0,0 +1,38 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_IMAGELOADER_H
+#define GAME_CLIENT_IMAGELOADER_H
+
+#include <engine/graphics.h>
+#include <engine/shared/jobs.h>
+
+// decodes a png on the engine's job pool, the texture gets created on the main thread
+class CImageLoader
+{
+	CJob m_Job;
+	class IEngine *m_pEngine;
+	IGraphics *m_pGraphics;
+	char m_aFilename[512];
+	int m_StorageType;
+
+	bool m_Loaded;
+	CImageInfo m_Info;
+
+	static int LoadThread(void *pUser);
+
+public:
+	CImageLoader();
+	~CImageLoader();
+
+	void Start(class IEngine *pEngine, IGraphics *pGraphics, const char *pFilename, int StorageType);
+	const char *Filename() const { return m_aFilename; }
+
+	// blocks until the image is decoded, returns false if that failed
+	bool Wait();
+	const CImageInfo *Info() const { return &m_Info; }
+
+	// creates the texture, failed images go through IGraphics::LoadTexture to get the usual fallback
+	int Upload(int StoreFormat, int Flags);
+};
+
+#endif
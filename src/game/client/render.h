@@ -4,6 +4,7 @@
 #define GAME_CLIENT_RENDER_H
 
 #include <base/vmath.h>
+#include <engine/graphics.h>
 #include <game/mapitems.h>
 #include "ui.h"
 
@@ -41,6 +42,73 @@ enum
 
 typedef void (*ENVELOPE_EVAL)(float TimeOffset, int Env, float *pChannels, void *pUser);
 
+// prebuilt quads of a static tile layer. the layer is split into square chunks,
+// the quads of a chunk are generated the first time it becomes visible and are
+// only regenerated when the texture shift changes (zoom), so rendering is one
+// submit per visible chunk instead of work per visible tile
+class CTileGeometry
+{
+public:
+	enum
+	{
+		CHUNK_SIZE=32,
+	};
+
+	struct CSourceTile
+	{
+		short m_X;
+		short m_Y;
+		unsigned char m_Index;
+		unsigned char m_Flags;
+	};
+
+	struct CChunk
+	{
+		int m_Start;
+		int m_NumOpaque;
+		int m_NumTransparent;
+
+		// parameters the quads were generated with
+		float m_Scale;
+		float m_Frac;
+		float m_Nudge;
+		IGraphics::CTexturedQuadItem *m_pQuads;
+	};
+
+private:
+	const unsigned char *m_pIndex;
+	const unsigned char *m_pFlags;
+	int m_Stride;
+	int m_Width;
+	int m_Height;
+	int m_ChunksX;
+	int m_ChunksY;
+	CChunk *m_pChunks;
+	CSourceTile *m_pTiles;
+
+public:
+	CTileGeometry();
+	~CTileGeometry();
+
+	// pIndex and pFlags point into an array of tiles Stride bytes apart, pFlags may be 0
+	void Build(const unsigned char *pIndex, const unsigned char *pFlags, int Stride, int w, int h);
+	void Clear();
+
+	bool IsBuilt() const { return m_pChunks != 0; }
+	bool IsBuiltFrom(const unsigned char *pIndex, const unsigned char *pFlags, int Stride) const { return IsBuilt() && m_pIndex == pIndex && m_pFlags == pFlags && m_Stride == Stride; }
+	int Width() const { return m_Width; }
+	int Height() const { return m_Height; }
+	int ChunksX() const { return m_ChunksX; }
+	int ChunksY() const { return m_ChunksY; }
+
+	unsigned char TileIndex(int x, int y) const { return m_pIndex[(y*m_Width+x)*m_Stride]; }
+	unsigned char TileFlags(int x, int y) const { return m_pFlags ? m_pFlags[(y*m_Width+x)*m_Stride] : 0; }
+
+	const CChunk *GetChunk(int cx, int cy, float Scale, float Frac, float Nudge);
+
+	static void TileQuad(IGraphics::CTexturedQuadItem *pQuad, int x, int y, int Index, int Flags, float Scale, float Frac, float Nudge);
+};
+
 class CRenderTools
 {
 public:
@@ -73,6 +141,7 @@ public:
 	static void RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Channels, float Time, float *pResult);
 	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser);
 	void RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
+	void RenderTileGeometry(CTileGeometry *pGeometry, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
 
 	// helpers
 	void MapscreenToWorld(float CenterX, float CenterY, float ParallaxX, float ParallaxY,
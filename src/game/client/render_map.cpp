@@ -32,9 +32,23 @@ void CRenderTools::RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Cha
 	}
 
 	Time = fmod(Time, pPoints[NumPoints-1].m_Time/1000.0f)*1000.0f;
-	for(int i = 0; i < NumPoints-1; i++)
+
+	// the points are sorted by time, find the first one that is not before Time
+	int Low = 1;
+	int High = NumPoints;
+	while(Low < High)
 	{
-		if(Time >= pPoints[i].m_Time && Time <= pPoints[i+1].m_Time)
+		int Mid = (Low+High)/2;
+		if(pPoints[Mid].m_Time < Time)
+			Low = Mid+1;
+		else
+			High = Mid;
+	}
+
+	if(Low < NumPoints)
+	{
+		int i = Low-1;
+		if(Time >= pPoints[i].m_Time)
 		{
 			float Delta = pPoints[i+1].m_Time-pPoints[i].m_Time;
 			float a = (Time-pPoints[i].m_Time)/Delta;
@@ -88,12 +102,62 @@ void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENV
 	if(g_Config.m_ClShowEntities && g_Config.m_ClDDRaceCheats)
 		return;
 
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
 	Graphics()->QuadsBegin();
 	float Conv = 1/255.0f;
 	for(int i = 0; i < NumQuads; i++)
 	{
 		CQuad *q = &pQuads[i];
 
+		float OffsetX = 0;
+		float OffsetY = 0;
+		float Rot = 0;
+
+		// TODO: fix this
+		if(q->m_PosEnv >= 0)
+		{
+			float aChannels[4];
+			pfnEval(q->m_PosEnvOffset/1000.0f, q->m_PosEnv, aChannels, pUser);
+			OffsetX = aChannels[0];
+			OffsetY = aChannels[1];
+			Rot = aChannels[2]/360.0f*pi*2;
+		}
+
+		// skip quads outside of the screen before evaluating their color
+		{
+			float MinX, MinY, MaxX, MaxY;
+			if(Rot != 0)
+			{
+				// a rotated quad stays within the distance of its farthest corner to the pivot
+				float PivotX = fx2f(q->m_aPoints[4].x);
+				float PivotY = fx2f(q->m_aPoints[4].y);
+				float Radius = 0;
+				for(int p = 0; p < 4; p++)
+					Radius = max(Radius, absolute(fx2f(q->m_aPoints[p].x)-PivotX) + absolute(fx2f(q->m_aPoints[p].y)-PivotY));
+				MinX = PivotX-Radius;
+				MaxX = PivotX+Radius;
+				MinY = PivotY-Radius;
+				MaxY = PivotY+Radius;
+			}
+			else
+			{
+				MinX = MaxX = fx2f(q->m_aPoints[0].x);
+				MinY = MaxY = fx2f(q->m_aPoints[0].y);
+				for(int p = 1; p < 4; p++)
+				{
+					MinX = min(MinX, fx2f(q->m_aPoints[p].x));
+					MaxX = max(MaxX, fx2f(q->m_aPoints[p].x));
+					MinY = min(MinY, fx2f(q->m_aPoints[p].y));
+					MaxY = max(MaxY, fx2f(q->m_aPoints[p].y));
+				}
+			}
+
+			if(MaxX+OffsetX < ScreenX0 || MinX+OffsetX > ScreenX1 || MaxY+OffsetY < ScreenY0 || MinY+OffsetY > ScreenY1)
+				continue;
+		}
+
 		float r=1, g=1, b=1, a=1;
 
 		if(q->m_ColorEnv >= 0)
@@ -122,20 +186,6 @@ void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENV
 			fx2f(q->m_aTexcoords[3].x), fx2f(q->m_aTexcoords[3].y)
 		);
 
-		float OffsetX = 0;
-		float OffsetY = 0;
-		float Rot = 0;
-
-		// TODO: fix this
-		if(q->m_PosEnv >= 0)
-		{
-			float aChannels[4];
-			pfnEval(q->m_PosEnvOffset/1000.0f, q->m_PosEnv, aChannels, pUser);
-			OffsetX = aChannels[0];
-			OffsetY = aChannels[1];
-			Rot = aChannels[2]/360.0f*pi*2;
-		}
-
 		IGraphics::CColorVertex Array[4] = {
 			IGraphics::CColorVertex(0, q->m_aColors[0].r*Conv*r, q->m_aColors[0].g*Conv*g, q->m_aColors[0].b*Conv*b, q->m_aColors[0].a*Conv*a),
 			IGraphics::CColorVertex(1, q->m_aColors[1].r*Conv*r, q->m_aColors[1].g*Conv*g, q->m_aColors[1].b*Conv*b, q->m_aColors[1].a*Conv*a),
@@ -776,3 +826,283 @@ void CRenderTools::RenderSwitchmap(CSwitchTile *pSwitchTile, int w, int h, float
 	Graphics()->QuadsEnd();
 	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
 }
+
+CTileGeometry::CTileGeometry()
+{
+	m_pIndex = 0;
+	m_pFlags = 0;
+	m_Stride = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_ChunksX = 0;
+	m_ChunksY = 0;
+	m_pChunks = 0;
+	m_pTiles = 0;
+}
+
+CTileGeometry::~CTileGeometry()
+{
+	Clear();
+}
+
+void CTileGeometry::Clear()
+{
+	if(m_pChunks)
+	{
+		for(int i = 0; i < m_ChunksX*m_ChunksY; i++)
+			delete [] m_pChunks[i].m_pQuads;
+		delete [] m_pChunks;
+	}
+	delete [] m_pTiles;
+
+	m_pChunks = 0;
+	m_pTiles = 0;
+	m_pIndex = 0;
+	m_pFlags = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_ChunksX = 0;
+	m_ChunksY = 0;
+}
+
+void CTileGeometry::Build(const unsigned char *pIndex, const unsigned char *pFlags, int Stride, int w, int h)
+{
+	Clear();
+
+	m_pIndex = pIndex;
+	m_pFlags = pFlags;
+	m_Stride = Stride;
+	m_Width = w;
+	m_Height = h;
+	m_ChunksX = (w+CHUNK_SIZE-1)/CHUNK_SIZE;
+	m_ChunksY = (h+CHUNK_SIZE-1)/CHUNK_SIZE;
+	m_pChunks = new CChunk[m_ChunksX*m_ChunksY];
+
+	// only tiles that are not empty end up in the geometry
+	int NumTiles = 0;
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++)
+			if(TileIndex(x, y))
+				NumTiles++;
+	m_pTiles = new CSourceTile[max(NumTiles, 1)];
+
+	// sort the tiles into their chunks, opaque ones first
+	int Pos = 0;
+	for(int cy = 0; cy < m_ChunksY; cy++)
+		for(int cx = 0; cx < m_ChunksX; cx++)
+		{
+			CChunk *pChunk = &m_pChunks[cy*m_ChunksX+cx];
+			pChunk->m_Start = Pos;
+			pChunk->m_NumOpaque = 0;
+			pChunk->m_NumTransparent = 0;
+			pChunk->m_Scale = 0.0f;
+			pChunk->m_Frac = 0.0f;
+			pChunk->m_Nudge = 0.0f;
+			pChunk->m_pQuads = 0;
+
+			int EndX = min((cx+1)*CHUNK_SIZE, w);
+			int EndY = min((cy+1)*CHUNK_SIZE, h);
+			for(int Pass = 0; Pass < 2; Pass++)
+				for(int y = cy*CHUNK_SIZE; y < EndY; y++)
+					for(int x = cx*CHUNK_SIZE; x < EndX; x++)
+					{
+						unsigned char Index = TileIndex(x, y);
+						if(!Index)
+							continue;
+
+						unsigned char Flags = TileFlags(x, y);
+						bool Opaque = (Flags&TILEFLAG_OPAQUE) != 0;
+						if(Opaque != (Pass == 0))
+							continue;
+
+						m_pTiles[Pos].m_X = x;
+						m_pTiles[Pos].m_Y = y;
+						m_pTiles[Pos].m_Index = Index;
+						m_pTiles[Pos].m_Flags = Flags;
+						Pos++;
+
+						if(Opaque)
+							pChunk->m_NumOpaque++;
+						else
+							pChunk->m_NumTransparent++;
+					}
+		}
+}
+
+const CTileGeometry::CChunk *CTileGeometry::GetChunk(int cx, int cy, float Scale, float Frac, float Nudge)
+{
+	CChunk *pChunk = &m_pChunks[cy*m_ChunksX+cx];
+	int Num = pChunk->m_NumOpaque+pChunk->m_NumTransparent;
+	if(Num == 0)
+		return pChunk;
+
+	if(!pChunk->m_pQuads)
+		pChunk->m_pQuads = new IGraphics::CTexturedQuadItem[Num];
+	else if(pChunk->m_Scale == Scale && pChunk->m_Frac == Frac && pChunk->m_Nudge == Nudge)
+		return pChunk;
+
+	// (re)generate the quads, the texture shift depends on the zoom
+	for(int i = 0; i < Num; i++)
+	{
+		const CSourceTile *pTile = &m_pTiles[pChunk->m_Start+i];
+		TileQuad(&pChunk->m_pQuads[i], pTile->m_X, pTile->m_Y, pTile->m_Index, pTile->m_Flags, Scale, Frac, Nudge);
+	}
+	pChunk->m_Scale = Scale;
+	pChunk->m_Frac = Frac;
+	pChunk->m_Nudge = Nudge;
+	return pChunk;
+}
+
+void CTileGeometry::TileQuad(IGraphics::CTexturedQuadItem *pQuad, int x, int y, int Index, int Flags, float Scale, float Frac, float Nudge)
+{
+	float TexSize = 1024.0f;
+	int tx = Index%16;
+	int ty = Index/16;
+	int Px0 = tx*(1024/16);
+	int Py0 = ty*(1024/16);
+	int Px1 = Px0+(1024/16)-1;
+	int Py1 = Py0+(1024/16)-1;
+
+	float x0 = Nudge + Px0/TexSize+Frac;
+	float y0 = Nudge + Py0/TexSize+Frac;
+	float x1 = Nudge + Px1/TexSize-Frac;
+	float y1 = Nudge + Py0/TexSize+Frac;
+	float x2 = Nudge + Px1/TexSize-Frac;
+	float y2 = Nudge + Py1/TexSize-Frac;
+	float x3 = Nudge + Px0/TexSize+Frac;
+	float y3 = Nudge + Py1/TexSize-Frac;
+
+	if(Flags&TILEFLAG_VFLIP)
+	{
+		x0 = x2;
+		x1 = x3;
+		x2 = x3;
+		x3 = x0;
+	}
+
+	if(Flags&TILEFLAG_HFLIP)
+	{
+		y0 = y3;
+		y2 = y1;
+		y3 = y1;
+		y1 = y0;
+	}
+
+	if(Flags&TILEFLAG_ROTATE)
+	{
+		float Tmp = x0;
+		x0 = x3;
+		x3 = x2;
+		x2 = x1;
+		x1 = Tmp;
+		Tmp = y0;
+		y0 = y3;
+		y3 = y2;
+		y2 = y1;
+		y1 = Tmp;
+	}
+
+	pQuad->m_X = x*Scale;
+	pQuad->m_Y = y*Scale;
+	pQuad->m_Width = Scale;
+	pQuad->m_Height = Scale;
+	pQuad->m_aU[0] = x0; pQuad->m_aV[0] = y0;
+	pQuad->m_aU[1] = x1; pQuad->m_aV[1] = y1;
+	pQuad->m_aU[2] = x2; pQuad->m_aV[2] = y2;
+	pQuad->m_aU[3] = x3; pQuad->m_aV[3] = y3;
+}
+
+void CRenderTools::RenderTileGeometry(CTileGeometry *pGeometry, float Scale, vec4 Color, int RenderFlags,
+									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
+{
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+	// calculate the final pixelsize for the tiles
+	float TilePixelSize = 1024/32.0f;
+	float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
+	float FinalTilesetScale = FinalTileSize/TilePixelSize;
+
+	float r=1, g=1, b=1, a=1;
+	if(ColorEnv >= 0)
+	{
+		float aChannels[4];
+		pfnEval(ColorEnvOffset/1000.0f, ColorEnv, aChannels, pUser);
+		r = aChannels[0];
+		g = aChannels[1];
+		b = aChannels[2];
+		a = aChannels[3];
+	}
+
+	Graphics()->QuadsBegin();
+	Graphics()->SetColor(Color.r*r, Color.g*g, Color.b*b, Color.a*a);
+
+	int StartY = (int)(ScreenY0/Scale)-1;
+	int StartX = (int)(ScreenX0/Scale)-1;
+	int EndY = (int)(ScreenY1/Scale)+1;
+	int EndX = (int)(ScreenX1/Scale)+1;
+
+	// adjust the texture shift according to mipmap level
+	float TexSize = 1024.0f;
+	float Frac = (1.25f/TexSize) * (1/FinalTilesetScale);
+	float Nudge = (0.5f/TexSize) * (1/FinalTilesetScale);
+
+	int w = pGeometry->Width();
+	int h = pGeometry->Height();
+
+	// submit the visible chunks
+	int ChunkX0 = max(StartX, 0)/CTileGeometry::CHUNK_SIZE;
+	int ChunkY0 = max(StartY, 0)/CTileGeometry::CHUNK_SIZE;
+	int ChunkX1 = (min(EndX, w)-1)/CTileGeometry::CHUNK_SIZE;
+	int ChunkY1 = (min(EndY, h)-1)/CTileGeometry::CHUNK_SIZE;
+	if(EndX > 0 && EndY > 0 && StartX < w && StartY < h)
+	{
+		for(int cy = ChunkY0; cy <= ChunkY1; cy++)
+			for(int cx = ChunkX0; cx <= ChunkX1; cx++)
+			{
+				const CTileGeometry::CChunk *pChunk = pGeometry->GetChunk(cx, cy, Scale, Frac, Nudge);
+				if((RenderFlags&LAYERRENDERFLAG_OPAQUE) && pChunk->m_NumOpaque)
+					Graphics()->QuadsDrawTextured(pChunk->m_pQuads, pChunk->m_NumOpaque);
+				if((RenderFlags&LAYERRENDERFLAG_TRANSPARENT) && pChunk->m_NumTransparent)
+					Graphics()->QuadsDrawTextured(pChunk->m_pQuads+pChunk->m_NumOpaque, pChunk->m_NumTransparent);
+			}
+	}
+
+	// the border tiles are stretched outside of the map, those are not cached
+	if(RenderFlags&TILERENDERFLAG_EXTEND)
+	{
+		for(int y = StartY; y < EndY; y++)
+			for(int x = StartX; x < EndX; x++)
+			{
+				if(y >= 0 && y < h && x >= 0 && x < w)
+				{
+					// skip the part that is covered by the chunks
+					x = w-1;
+					continue;
+				}
+
+				int mx = clamp(x, 0, w-1);
+				int my = clamp(y, 0, h-1);
+
+				unsigned char Index = pGeometry->TileIndex(mx, my);
+				if(!Index)
+					continue;
+
+				unsigned char Flags = pGeometry->TileFlags(mx, my);
+				if(Flags&TILEFLAG_OPAQUE)
+				{
+					if(!(RenderFlags&LAYERRENDERFLAG_OPAQUE))
+						continue;
+				}
+				else if(!(RenderFlags&LAYERRENDERFLAG_TRANSPARENT))
+					continue;
+
+				IGraphics::CTexturedQuadItem Quad;
+				CTileGeometry::TileQuad(&Quad, x, y, Index, Flags, Scale, Frac, Nudge);
+				Graphics()->QuadsDrawTextured(&Quad, 1);
+			}
+	}
+
+	Graphics()->QuadsEnd();
+	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
+}
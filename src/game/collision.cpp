@@ -248,6 +248,24 @@ void CCollision::MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, i
 	}
 }
 
+// same test as CheckPoint, but for a whole batch of points without a call per point
+void CCollision::CheckPoints(const float *pX, const float *pY, int Num, unsigned char *pSolid)
+{
+	if(!m_pTiles)
+	{
+		mem_zero(pSolid, Num);
+		return;
+	}
+
+	for(int i = 0; i < Num; i++)
+	{
+		int Nx = clamp(round(pX[i])/32, 0, m_Width-1);
+		int Ny = clamp(round(pY[i])/32, 0, m_Height-1);
+		int Index = m_pTiles[Ny*m_Width+Nx].m_Index;
+		pSolid[i] = Index == COLFLAG_SOLID || Index == (COLFLAG_SOLID|COLFLAG_NOHOOK);
+	}
+}
+
 bool CCollision::TestBox(vec2 Pos, vec2 Size)
 {
 	Size *= 0.5f;
@@ -46,12 +46,15 @@ CInputCount CountInput(int Prev, int Cur)
 MACRO_ALLOC_POOL_ID_IMPL(CCharacter, MAX_CLIENTS)
 
 // Character, "physical" player's part
-CCharacter::CCharacter(CGameWorld *pWorld)
-: CEntity(pWorld, CGameWorld::ENTTYPE_CHARACTER)
+CCharacter::CCharacter(CGameWorld *pWorld, int ClientID)
+: CEntity(pWorld, CGameWorld::ENTTYPE_CHARACTER), m_Core(pWorld->m_aCharacterCores[ClientID])
 {
 	m_ProximityRadius = ms_PhysSize;
 	m_Health = 0;
 	m_Armor = 0;
+
+	// the slot still holds the core of the previous character of this client
+	mem_zero(&m_Core, sizeof(m_Core));
 }
 
 void CCharacter::Reset()
@@ -900,19 +903,24 @@ bool CCharacter::TakeDamage(vec2 Force, int Dmg, int From, int Weapon)
 	return true;
 }
 
+int CCharacter::CostOwner() const
+{
+	return m_pPlayer ? m_pPlayer->GetCID() : -1;
+}
+
 void CCharacter::Snap(int SnappingClient)
 {
 	if(NetworkClipped(SnappingClient))
 		return;
 
 	CCharacter* SnapChar = GameServer()->GetPlayerChar(SnappingClient);
-	CPlayer* SnapPlayer = GameServer()->m_apPlayers[SnappingClient];
+	CPlayer* SnapPlayer = SnappingClient == -1 ? 0 : GameServer()->m_apPlayers[SnappingClient];
 
-	if((SnapPlayer->GetTeam() == TEAM_SPECTATORS || SnapPlayer->m_Paused) && SnapPlayer->m_SpectatorID != -1
+	if(SnapPlayer && (SnapPlayer->GetTeam() == TEAM_SPECTATORS || SnapPlayer->m_Paused) && SnapPlayer->m_SpectatorID != -1
 		&& !CanCollide(SnapPlayer->m_SpectatorID) && !SnapPlayer->m_ShowOthers)
 		return;
 
-	if( SnapPlayer->GetTeam() != TEAM_SPECTATORS && !SnapPlayer->m_Paused && SnapChar && !SnapChar->m_Super
+	if(SnapPlayer && SnapPlayer->GetTeam() != TEAM_SPECTATORS && !SnapPlayer->m_Paused && SnapChar && !SnapChar->m_Super
 		&& !CanCollide(SnappingClient) && !SnapPlayer->m_ShowOthers)
 		return;
 
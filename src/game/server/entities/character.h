@@ -26,7 +26,7 @@ public:
 	//character's size
 	static const int ms_PhysSize = 28;
 
-	CCharacter(CGameWorld *pWorld);
+	CCharacter(CGameWorld *pWorld, int ClientID);
 
 	virtual void Reset();
 	virtual void Destroy();
@@ -34,6 +34,8 @@ public:
 	virtual void TickDefered();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual int CostType() const { return CGameWorld::COSTTYPE_CHARACTER; }
+	virtual int CostOwner() const;
 
 	bool IsGrounded();
 
@@ -126,8 +128,8 @@ private:
 		int m_OldVelAmount;
 	} m_Ninja;
 
-	// the player core for the physics
-	CCharacterCore m_Core;
+	// the player core for the physics, lives in CGameWorld::m_aCharacterCores
+	CCharacterCore &m_Core;
 
 	// info for dead reckoning
 	int m_ReckoningTick; // tick that we are performing dead reckoning From
@@ -233,6 +233,12 @@ void CDragger::Tick()
 
 }
 
+int CDragger::CostOwner() const
+{
+	// the dragged player is the one this is working for
+	return m_Target ? m_Target->GetPlayer()->GetCID() : -1;
+}
+
 void CDragger::Snap(int SnappingClient)
 {
 	if (((CGameControllerDDRace*) GameServer()->m_pController)->m_Teams.GetTeamState(
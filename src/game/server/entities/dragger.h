@@ -23,6 +23,8 @@ public:
 	virtual void Reset();
 	virtual void Tick();
 	virtual void Snap(int snapping_client);
+	virtual int CostType() const { return CGameWorld::COSTTYPE_DRAGGER; }
+	virtual int CostOwner() const;
 };
 
 class CDraggerTeam
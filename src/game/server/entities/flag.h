@@ -24,6 +24,7 @@ public:
 	virtual void Reset();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual int CostType() const { return CGameWorld::COSTTYPE_FLAG; }
 };
 
 #endif
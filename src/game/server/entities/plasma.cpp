@@ -7,6 +7,8 @@
 #include <game/server/gamemodes/DDRace.h>
 #include "plasma.h"
 
+MACRO_ALLOC_POOL_IMPL(CPlasma)
+
 const float ACCEL = 1.1f;
 
 CPlasma::CPlasma(CGameWorld *pGameWorld, vec2 Pos, vec2 Dir, bool Freeze,
@@ -87,7 +89,7 @@ void CPlasma::Snap(int SnappingClient)
 	if (NetworkClipped(SnappingClient))
 		return;
 	CCharacter* SnapChar = GameServer()->GetPlayerChar(SnappingClient);
-	CPlayer* SnapPlayer = GameServer()->m_apPlayers[SnappingClient];
+	CPlayer* SnapPlayer = SnappingClient == -1 ? 0 : GameServer()->m_apPlayers[SnappingClient];
 	int Tick = (Server()->Tick() % Server()->TickSpeed()) % 11;
 
 	if (SnapChar && SnapChar->IsAlive()
@@ -96,13 +98,13 @@ void CPlasma::Snap(int SnappingClient)
 			&& (!Tick))
 		return;
 
-	if((SnapPlayer->GetTeam() == TEAM_SPECTATORS || SnapPlayer->m_Paused) && SnapPlayer->m_SpectatorID != -1
+	if(SnapPlayer && (SnapPlayer->GetTeam() == TEAM_SPECTATORS || SnapPlayer->m_Paused) && SnapPlayer->m_SpectatorID != -1
 		&& GameServer()->GetPlayerChar(SnapPlayer->m_SpectatorID)
 		&& GameServer()->GetPlayerChar(SnapPlayer->m_SpectatorID)->Team() != m_ResponsibleTeam
 		&& !SnapPlayer->m_ShowOthers)
 		return;
 
-	if( SnapPlayer->GetTeam() != TEAM_SPECTATORS && !SnapPlayer->m_Paused && SnapChar
+	if(SnapPlayer && SnapPlayer->GetTeam() != TEAM_SPECTATORS && !SnapPlayer->m_Paused && SnapChar
 		&& SnapChar && SnapChar->Team() != m_ResponsibleTeam
 		&& !SnapPlayer->m_ShowOthers)
 		return;
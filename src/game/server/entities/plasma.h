@@ -8,6 +8,8 @@ class CGun;
 
 class CPlasma: public CEntity
 {
+	MACRO_ALLOC_POOL()
+
 	vec2 m_Core;
 	int m_EvalTick;
 	int m_LifeTime;
@@ -26,6 +28,7 @@ public:
 	virtual void Reset();
 	virtual void Tick();
 	virtual void Snap(int SnappingClient);
+	virtual int CostType() const { return CGameWorld::COSTTYPE_PLASMA; }
 };
 
 #endif
@@ -7,6 +7,8 @@
 #include <engine/shared/config.h>
 #include <game/server/teams.h>
 
+MACRO_ALLOC_POOL_IMPL(CProjectile)
+
 CProjectile::CProjectile
 	(
 		CGameWorld *pGameWorld,
@@ -5,6 +5,8 @@
 
 class CProjectile : public CEntity
 {
+	MACRO_ALLOC_POOL()
+
 public:
 	CProjectile
 	(
@@ -30,6 +32,8 @@ public:
 	virtual void Tick();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual int CostType() const { return CGameWorld::COSTTYPE_PROJECTILE; }
+	virtual int CostOwner() const { return m_Owner; }
 
 private:
 	vec2 m_Direction;
@@ -20,6 +20,7 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType)
 
 	m_pPrevTypeEntity = 0;
 	m_pNextTypeEntity = 0;
+	mem_zero(m_aSnapSkipped, sizeof(m_aSnapSkipped));
 }
 
 CEntity::~CEntity()
@@ -54,3 +55,98 @@ bool CEntity::GameLayerClipped(vec2 CheckPos)
 	return round(CheckPos.x)/32 < -200 || round(CheckPos.x)/32 > GameServer()->Collision()->GetWidth()+200 ||
 			round(CheckPos.y)/32 < -200 || round(CheckPos.y)/32 > GameServer()->Collision()->GetHeight()+200 ? true : false;
 }
+
+//////////////////////////////////////////////////
+// Entity pool
+//////////////////////////////////////////////////
+CEntityPool *CEntityPool::ms_pFirst = 0;
+
+CEntityPool::CEntityPool(const char *pName, int ItemSize)
+{
+	m_pName = pName;
+	m_ItemSize = ItemSize < (int)sizeof(CFreeItem) ? (int)sizeof(CFreeItem) : ItemSize;
+	m_pSlabs = 0;
+	m_NextSlabItem = SLAB_SIZE;
+	m_pFirstFree = 0;
+
+	m_NumSlabs = 0;
+	m_NumActive = 0;
+	m_PeakActive = 0;
+	m_NumAllocs = 0;
+	m_NumReused = 0;
+
+	m_pNext = ms_pFirst;
+	ms_pFirst = this;
+}
+
+CEntityPool::~CEntityPool()
+{
+	// entities still alive at exit keep their memory
+	if(m_NumActive)
+		return;
+
+	while(m_pSlabs)
+	{
+		CSlab *pNext = m_pSlabs->m_pNext;
+		mem_free(m_pSlabs);
+		m_pSlabs = pNext;
+	}
+}
+
+void *CEntityPool::Alloc(size_t Size)
+{
+	dbg_assert((int)Size <= m_ItemSize, "size error");
+
+	void *p;
+	if(m_pFirstFree)
+	{
+		p = m_pFirstFree;
+		m_pFirstFree = m_pFirstFree->m_pNext;
+		m_NumReused++;
+	}
+	else
+	{
+		if(m_NextSlabItem == SLAB_SIZE)
+		{
+			CSlab *pSlab = (CSlab *)mem_alloc(sizeof(CSlab)+SLAB_SIZE*m_ItemSize, sizeof(CSlab));
+			pSlab->m_pNext = m_pSlabs;
+			m_pSlabs = pSlab;
+			m_NextSlabItem = 0;
+			m_NumSlabs++;
+		}
+		p = (char *)(m_pSlabs+1) + m_NextSlabItem*m_ItemSize;
+		m_NextSlabItem++;
+	}
+
+	m_NumAllocs++;
+	m_NumActive++;
+	if(m_NumActive > m_PeakActive)
+		m_PeakActive = m_NumActive;
+
+	mem_zero(p, m_ItemSize);
+	return p;
+}
+
+void CEntityPool::Free(void *p)
+{
+	if(!p)
+		return;
+
+	CFreeItem *pItem = (CFreeItem *)p;
+	pItem->m_pNext = m_pFirstFree;
+	m_pFirstFree = pItem;
+	m_NumActive--;
+}
+
+void CEntityPool::DumpStats(IConsole *pConsole)
+{
+	char aBuf[256];
+	for(CEntityPool *pPool = ms_pFirst; pPool; pPool = pPool->m_pNext)
+	{
+		str_format(aBuf, sizeof(aBuf), "%s: active=%d peak=%d allocs=%.0f reused=%.0f (%d%%) slabs=%d (%dk)",
+			pPool->m_pName, pPool->m_NumActive, pPool->m_PeakActive, (double)pPool->m_NumAllocs, (double)pPool->m_NumReused,
+			pPool->m_NumAllocs ? (int)(pPool->m_NumReused*100/pPool->m_NumAllocs) : 0,
+			pPool->m_NumSlabs, pPool->m_NumSlabs*SLAB_SIZE*pPool->m_ItemSize/1024);
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "entitypool", aBuf);
+	}
+}
@@ -50,6 +50,68 @@
 		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
 	}
 
+/*
+	Class: CEntityPool
+		Slab allocator with a free list for one entity type. Entities
+		that are spawned and destroyed often (projectiles, lasers...)
+		use it through MACRO_ALLOC_POOL() so their memory is reused
+		instead of going through the heap every time. Not thread safe,
+		entities only live in the game thread.
+*/
+class CEntityPool
+{
+	enum
+	{
+		SLAB_SIZE = 64, // entities per slab
+	};
+
+	union CSlab
+	{
+		CSlab *m_pNext;
+		double m_aAlign[2];
+	};
+
+	struct CFreeItem
+	{
+		CFreeItem *m_pNext;
+	};
+
+	static CEntityPool *ms_pFirst;
+	CEntityPool *m_pNext;
+
+	const char *m_pName;
+	int m_ItemSize;
+	CSlab *m_pSlabs;
+	int m_NextSlabItem;
+	CFreeItem *m_pFirstFree;
+
+	int m_NumSlabs;
+	int m_NumActive;
+	int m_PeakActive;
+	int64 m_NumAllocs;
+	int64 m_NumReused;
+
+public:
+	CEntityPool(const char *pName, int ItemSize);
+	~CEntityPool();
+
+	void *Alloc(size_t Size);
+	void Free(void *p);
+
+	static void DumpStats(class IConsole *pConsole);
+};
+
+#define MACRO_ALLOC_POOL() \
+	public: \
+	void *operator new(size_t Size); \
+	void operator delete(void *p); \
+	private:
+
+#define MACRO_ALLOC_POOL_IMPL(POOLTYPE) \
+	static CEntityPool ms_Pool##POOLTYPE(#POOLTYPE, sizeof(POOLTYPE)); \
+	void *POOLTYPE::operator new(size_t Size) { return ms_Pool##POOLTYPE.Alloc(Size); } \
+	void POOLTYPE::operator delete(void *p) { ms_Pool##POOLTYPE.Free(p); }
+
 /*
 	Class: Entity
 		Basic entity class.
@@ -63,6 +125,9 @@ class CEntity
 	CEntity *m_pNextTypeEntity;
 
 	class CGameWorld *m_pGameWorld;
+
+	// snapshots in a row the entity was left out of per client, as they were full
+	unsigned short m_aSnapSkipped[MAX_CLIENTS];
 protected:
 	bool m_MarkedForDestroy;
 	int m_ID;
@@ -124,6 +189,20 @@ public:
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: CostType
+			Returns the entity type the time of this entity is
+			accounted to, one of CGameWorld::COSTTYPE_*.
+	*/
+	virtual int CostType() const { return CGameWorld::COSTTYPE_OTHER; }
+
+	/*
+		Function: CostOwner
+			Returns the client id the time of this entity is
+			accounted to, or -1 if it belongs to the map.
+	*/
+	virtual int CostOwner() const { return -1; }
+
 	/*
 		Function: networkclipped(int snapping_client)
 			Performs a series of test to see if a client can see the
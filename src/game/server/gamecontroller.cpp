@@ -765,8 +765,8 @@ void IGameController::Snap(int SnappingClient)
 	pGameInfoObj->m_RoundCurrent = m_RoundCount+1;
 
 	CCharacter *pChr;
-	CPlayer *pPlayer = GameServer()->m_apPlayers[SnappingClient];
-	if(pPlayer && (pPlayer->m_TimerType == 0 || pPlayer->m_TimerType == 2) && SnappingClient >= 0)
+	CPlayer *pPlayer = SnappingClient >= 0 ? GameServer()->m_apPlayers[SnappingClient] : 0;
+	if(pPlayer && (pPlayer->m_TimerType == 0 || pPlayer->m_TimerType == 2))
 		if((pChr = pPlayer->GetCharacter()))
 			pGameInfoObj->m_RoundStartTick = (pChr->m_DDRaceState == DDRACE_STARTED)?pChr->m_StartTime:m_RoundStartTick;
 }
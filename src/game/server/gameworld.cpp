@@ -1,6 +1,10 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <algorithm>
+
+#include <engine/shared/config.h>
+
 #include "gameworld.h"
 #include "entity.h"
 #include "gamecontext.h"
@@ -17,6 +21,12 @@ CGameWorld::CGameWorld()
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		m_apFirstEntityTypes[i] = 0;
+
+	m_CostAccounting = false;
+	m_CostStartTick = 0;
+	mem_zero(m_aTypeCosts, sizeof(m_aTypeCosts));
+	mem_zero(m_aClientCosts, sizeof(m_aClientCosts));
+	mem_zero(m_aSnapCongested, sizeof(m_aSnapCongested));
 }
 
 CGameWorld::~CGameWorld()
@@ -101,16 +111,216 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 	pEnt->m_pPrevTypeEntity = 0;
 }
 
+const char *CGameWorld::ms_apCostTypeNames[NUM_COSTTYPES] = {
+	"other",
+	"character",
+	"projectile",
+	"laser",
+	"pickup",
+	"flag",
+	"dragger",
+	"door",
+	"gun",
+	"light",
+	"plasma",
+};
+
+CGameWorld::CCostScope::CCostScope(CGameWorld *pWorld, CEntity *pEnt, int Cost)
+{
+	m_pWorld = pWorld->m_CostAccounting ? pWorld : 0;
+	if(!m_pWorld)
+		return;
+
+	// the entity can be gone at the end of the call
+	m_Cost = Cost;
+	m_Type = pEnt->CostType();
+	m_Owner = pEnt->CostOwner();
+	m_Start = time_get();
+}
+
+CGameWorld::CCostScope::~CCostScope()
+{
+	if(!m_pWorld)
+		return;
+
+	int64 Time = time_get()-m_Start;
+	m_pWorld->m_aTypeCosts[m_Type].m_aTime[m_Cost] += Time;
+	m_pWorld->m_aTypeCosts[m_Type].m_aCalls[m_Cost]++;
+	if(m_Owner >= 0 && m_Owner < MAX_CLIENTS)
+	{
+		m_pWorld->m_aClientCosts[m_Owner].m_aTime[m_Cost] += Time;
+		m_pWorld->m_aClientCosts[m_Owner].m_aCalls[m_Cost]++;
+	}
+}
+
+void CGameWorld::PrintCosts(IConsole *pConsole)
+{
+	if(!m_CostAccounting)
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", "cost accounting is off, enable it with sv_cost_accounting 1");
+		return;
+	}
+
+	// summed times are fine even when single calls are shorter than the timer resolution
+	char aBuf[256];
+	int64 Freq = time_freq();
+	int Seconds = max(1, (Server()->Tick()-m_CostStartTick)/Server()->TickSpeed());
+	str_format(aBuf, sizeof(aBuf), "entity costs over %d seconds, calls/s and microseconds/s for tick, tick_defered and snap", Seconds);
+	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+
+	for(int t = 0; t < NUM_COSTTYPES; t++)
+	{
+		const CCost *pCost = &m_aTypeCosts[t];
+		if(!pCost->m_aCalls[COST_TICK] && !pCost->m_aCalls[COST_SNAP])
+			continue;
+		str_format(aBuf, sizeof(aBuf), "%-10s tick=%d/%d defered=%d/%d snap=%d/%d", ms_apCostTypeNames[t],
+			(int)(pCost->m_aCalls[COST_TICK]/Seconds), (int)(pCost->m_aTime[COST_TICK]*1000000/Freq/Seconds),
+			(int)(pCost->m_aCalls[COST_TICK_DEFERED]/Seconds), (int)(pCost->m_aTime[COST_TICK_DEFERED]*1000000/Freq/Seconds),
+			(int)(pCost->m_aCalls[COST_SNAP]/Seconds), (int)(pCost->m_aTime[COST_SNAP]*1000000/Freq/Seconds));
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+	}
+
+	// the clients whose entities cost the most come first
+	bool aListed[MAX_CLIENTS] = {false};
+	while(1)
+	{
+		int Worst = -1;
+		int64 WorstTime = 0;
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			const CCost *pCost = &m_aClientCosts[c];
+			int64 Time = pCost->m_aTime[COST_TICK]+pCost->m_aTime[COST_TICK_DEFERED]+pCost->m_aTime[COST_SNAP];
+			if(aListed[c] || !GameServer()->m_apPlayers[c] || (Worst != -1 && Time <= WorstTime))
+				continue;
+			Worst = c;
+			WorstTime = Time;
+		}
+		if(Worst == -1)
+			break;
+		aListed[Worst] = true;
+
+		const CCost *pCost = &m_aClientCosts[Worst];
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' tick=%d defered=%d snap=%d", Worst, Server()->ClientName(Worst),
+			(int)(pCost->m_aTime[COST_TICK]*1000000/Freq/Seconds), (int)(pCost->m_aTime[COST_TICK_DEFERED]*1000000/Freq/Seconds),
+			(int)(pCost->m_aTime[COST_SNAP]*1000000/Freq/Seconds));
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "costs", aBuf);
+	}
+}
+
 //
-void CGameWorld::Snap(int SnappingClient)
+// how much an entity type is worth a place in a full snapshot
+const int CGameWorld::ms_aSnapImportance[NUM_COSTTYPES] = {
+	30, // other
+	100, // character
+	60, // projectile
+	50, // laser
+	40, // pickup
+	90, // flag
+	20, // dragger
+	10, // door
+	20, // gun
+	10, // light
+	30, // plasma
+};
+
+bool CGameWorld::SnapRoomLeft()
 {
+	return Server()->SnapItemsLeft() > 0 && Server()->SnapSizeLeft() >= SNAP_ENTITY_SIZE;
+}
+
+bool CGameWorld::SnapEntity(CEntity *pEnt, int SnappingClient)
+{
+	if(!SnapRoomLeft())
+	{
+		if(SnappingClient >= 0 && pEnt->m_aSnapSkipped[SnappingClient] < 0xffff)
+			pEnt->m_aSnapSkipped[SnappingClient]++;
+		return false;
+	}
+
+	if(SnappingClient >= 0)
+		pEnt->m_aSnapSkipped[SnappingClient] = 0;
+	CCostScope Cost(this, pEnt, COST_SNAP);
+	pEnt->Snap(SnappingClient);
+	return true;
+}
+
+int CGameWorld::SnapPriority(CEntity *pEnt, int SnappingClient, vec2 ViewPos)
+{
+	int Type = pEnt->CostType();
+	if(Type == COSTTYPE_CHARACTER && pEnt->CostOwner() == SnappingClient)
+		return 0x7fffffff;
+
+	// closer entities first. entities out of sight make no item, so it
+	// doesn't matter where they end up
+	int Distance = (int)distance(ViewPos, pEnt->m_Pos);
+	int64 Priority = (ms_aSnapImportance[Type]<<16)/(512+Distance);
+
+	// every entity that comes and goes is sent in full again, so the ones the
+	// client has stay until one that was left out 8 times catches up with them.
+	// the skip count keeps growing, so every entity gets its turn eventually
+	int Skipped = pEnt->m_aSnapSkipped[SnappingClient];
+	Priority *= Skipped ? Skipped : 8;
+	return (int)min(Priority, (int64)0x7ffffffe);
+}
+
+bool CGameWorld::SnapPrioritized(int SnappingClient)
+{
+	vec2 ViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+
+	m_aSnapOrder.clear();
 	for(int i = 0; i < NUM_ENTTYPES; i++)
-		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
 		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->Snap(SnappingClient);
-			pEnt = m_pNextTraverseEntity;
+			CSnapEntry Entry;
+			Entry.m_Priority = SnapPriority(pEnt, SnappingClient, ViewPos);
+			Entry.m_pEnt = pEnt;
+			m_aSnapOrder.push_back(Entry);
 		}
+	std::sort(m_aSnapOrder.begin(), m_aSnapOrder.end());
+
+	bool Skipped = false;
+	for(unsigned i = 0; i < m_aSnapOrder.size(); i++)
+		if(!SnapEntity(m_aSnapOrder[i].m_pEnt, SnappingClient))
+			Skipped = true;
+	return Skipped;
+}
+
+void CGameWorld::Snap(int SnappingClient)
+{
+	int ItemsLeft = Server()->SnapItemsLeft();
+	int SizeLeft = Server()->SnapSizeLeft();
+	bool Skipped = false;
+
+	if(SnappingClient >= 0 && m_aSnapCongested[SnappingClient])
+		Skipped = SnapPrioritized(SnappingClient);
+	else
+	{
+		for(int i = 0; i < NUM_ENTTYPES; i++)
+			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+			{
+				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+				if(!SnapEntity(pEnt, SnappingClient))
+					Skipped = true;
+				pEnt = m_pNextTraverseEntity;
+			}
+	}
+
+	if(SnappingClient < 0)
+		return;
+
+	// sort by priority from when three quarters of the room are used, until it's below half again
+	int UsedItems = ItemsLeft - Server()->SnapItemsLeft();
+	int UsedSize = SizeLeft - Server()->SnapSizeLeft();
+	int Limit = m_aSnapCongested[SnappingClient] ? 2 : 3;
+	m_aSnapCongested[SnappingClient] = Skipped || UsedItems*4 > ItemsLeft*Limit || UsedSize*4 > SizeLeft*Limit;
+}
+
+void CGameWorld::ResetSnapState(int ClientID)
+{
+	m_aSnapCongested[ClientID] = false;
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+			pEnt->m_aSnapSkipped[ClientID] = 0;
 }
 
 void CGameWorld::Reset()
@@ -149,6 +359,15 @@ void CGameWorld::RemoveEntities()
 
 void CGameWorld::Tick()
 {
+	// start counting from zero when the cost accounting gets turned on
+	if(g_Config.m_SvCostAccounting && !m_CostAccounting)
+	{
+		mem_zero(m_aTypeCosts, sizeof(m_aTypeCosts));
+		mem_zero(m_aClientCosts, sizeof(m_aClientCosts));
+		m_CostStartTick = Server()->Tick();
+	}
+	m_CostAccounting = g_Config.m_SvCostAccounting != 0;
+
 	if(m_ResetRequested)
 		Reset();
 
@@ -161,7 +380,10 @@ void CGameWorld::Tick()
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-				pEnt->Tick();
+				{
+					CCostScope Cost(this, pEnt, COST_TICK);
+					pEnt->Tick();
+				}
 				pEnt = m_pNextTraverseEntity;
 			}
 
@@ -169,7 +391,10 @@ void CGameWorld::Tick()
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-				pEnt->TickDefered();
+				{
+					CCostScope Cost(this, pEnt, COST_TICK_DEFERED);
+					pEnt->TickDefered();
+				}
 				pEnt = m_pNextTraverseEntity;
 			}
 	}
@@ -180,7 +405,11 @@ void CGameWorld::Tick()
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-				pEnt->TickPaused();
+				{
+					// a paused world still spends its tick time here
+					CCostScope Cost(this, pEnt, COST_TICK);
+					pEnt->TickPaused();
+				}
 				pEnt = m_pNextTraverseEntity;
 			}
 	}
@@ -6,6 +6,7 @@
 #include <game/gamecore.h>
 
 #include <list>
+#include <vector>
 
 class CEntity;
 class CCharacter;
@@ -28,10 +29,84 @@ public:
 		NUM_ENTTYPES
 	};
 
+	// finer than the entity types, to tell where the tick time goes
+	enum
+	{
+		COSTTYPE_OTHER = 0,
+		COSTTYPE_CHARACTER,
+		COSTTYPE_PROJECTILE,
+		COSTTYPE_LASER,
+		COSTTYPE_PICKUP,
+		COSTTYPE_FLAG,
+		COSTTYPE_DRAGGER,
+		COSTTYPE_DOOR,
+		COSTTYPE_GUN,
+		COSTTYPE_LIGHT,
+		COSTTYPE_PLASMA,
+		NUM_COSTTYPES,
+
+		COST_TICK = 0,
+		COST_TICK_DEFERED,
+		COST_SNAP,
+		NUM_COSTS
+	};
+
 private:
 	void Reset();
 	void RemoveEntities();
 
+	struct CCost
+	{
+		int64 m_aTime[NUM_COSTS]; // time_get units
+		int64 m_aCalls[NUM_COSTS];
+	};
+
+	// times one entity call while sv_cost_accounting is on
+	class CCostScope
+	{
+		CGameWorld *m_pWorld;
+		int m_Cost;
+		int m_Type;
+		int m_Owner;
+		int64 m_Start;
+	public:
+		CCostScope(CGameWorld *pWorld, CEntity *pEnt, int Cost);
+		~CCostScope();
+	};
+
+	bool m_CostAccounting;
+	int m_CostStartTick;
+	CCost m_aTypeCosts[NUM_COSTTYPES];
+	CCost m_aClientCosts[MAX_CLIENTS];
+
+	static const char *ms_apCostTypeNames[NUM_COSTTYPES];
+
+	enum
+	{
+		// room one entity needs in a snapshot, all of them make one item
+		SNAP_ENTITY_SIZE = 128,
+	};
+
+	struct CSnapEntry
+	{
+		int m_Priority;
+		CEntity *m_pEnt;
+
+		bool operator<(const CSnapEntry &Other) const { return m_Priority > Other.m_Priority; }
+	};
+
+	// clients whose last snapshot was close to the budget get the entities by priority
+	bool m_aSnapCongested[MAX_CLIENTS];
+	std::vector<CSnapEntry> m_aSnapOrder;
+
+	static const int ms_aSnapImportance[NUM_COSTTYPES];
+
+	bool SnapRoomLeft();
+	bool SnapEntity(CEntity *pEnt, int SnappingClient);
+	int SnapPriority(CEntity *pEnt, int SnappingClient, vec2 ViewPos);
+	// returns true if entities were left out
+	bool SnapPrioritized(int SnappingClient);
+
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
@@ -46,6 +121,11 @@ public:
 	bool m_Paused;
 	CWorldCore m_Core;
 
+	// physics state of the characters, indexed by client id. kept
+	// together instead of inside each CCharacter as the core tick looks
+	// at every other character for hooking and collision
+	CCharacterCore m_aCharacterCores[MAX_CLIENTS];
+
 	CGameWorld();
 	~CGameWorld();
 
@@ -130,7 +210,9 @@ public:
 	/*
 		Function: snap
 			Calls snap on all the entities in the world to create
-			the snapshot.
+			the snapshot. When the snapshot of a client runs full,
+			the entities are snapped by priority instead, the ones
+			left out get a higher priority for the next snapshot.
 
 		Arguments:
 			snapping_client - ID of the client which snapshot
@@ -138,6 +220,16 @@ public:
 	*/
 	void Snap(int SnappingClient);
 
+	/*
+		Function: ResetSnapState
+			Forgets the snapshot priorities of a client, so the next
+			client in that slot doesn't inherit them.
+
+		Arguments:
+			client_id - ID of the client that left.
+	*/
+	void ResetSnapState(int ClientID);
+
 	/*
 		Function: tick
 			Calls tick on all the entities in the world to progress
@@ -146,6 +238,14 @@ public:
 	*/
 	void Tick();
 
+	/*
+		Function: PrintCosts
+			Prints the time spent in tick, tick_defered and snap
+			per entity type and per owning client, counted while
+			sv_cost_accounting is on.
+	*/
+	void PrintCosts(class IConsole *pConsole);
+
 	// DDRace
 
 	std::list<class CCharacter *> IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, class CEntity *pNotThis);
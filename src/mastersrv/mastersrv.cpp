@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <base/tl/array.h>
 
 #include <engine/config.h>
 #include <engine/console.h>
@@ -17,9 +19,118 @@
 enum {
 	MTU = 1400,
 	MAX_SERVERS_PER_PACKET=75,
-	MAX_PACKETS=16,
-	MAX_SERVERS=MAX_SERVERS_PER_PACKET*MAX_PACKETS,
-	EXPIRE_TIME = 90
+	EXPIRE_TIME = 90,
+	MAX_LIST_REQUESTS=4096,
+	SEND_BATCH=64,
+	FLOOD_REFUSED=50
+};
+
+// entries with stable ids, found through a hash over their address.
+// the hash doubles its buckets whenever there are more entries than buckets.
+template<class T>
+class CAddrPool
+{
+	array<T> m_aEntries;
+	array<int> m_aNext; // next id in the same bucket or in the free list
+	array<int> m_aUsed;
+	array<int> m_aBuckets;
+	int m_FirstFree;
+	int m_Num;
+	bool m_HashPort;
+
+	int Bucket(const NETADDR *pAddr) const
+	{
+		unsigned Hash = pAddr->type;
+		for(int i = 0; i < 16; i++)
+			Hash = Hash*31 + pAddr->ip[i];
+		if(m_HashPort)
+			Hash = Hash*31 + pAddr->port;
+		Hash ^= Hash>>15;
+		return Hash&(m_aBuckets.size()-1);
+	}
+
+	void Link(int ID)
+	{
+		int b = Bucket(&m_aEntries[ID].m_Address);
+		m_aNext[ID] = m_aBuckets[b];
+		m_aBuckets[b] = ID;
+	}
+
+	void Rehash(int NumBuckets)
+	{
+		m_aBuckets.set_size(NumBuckets);
+		for(int i = 0; i < NumBuckets; i++)
+			m_aBuckets[i] = -1;
+		for(int i = 0; i < m_aEntries.size(); i++)
+			if(m_aUsed[i])
+				Link(i);
+	}
+
+public:
+	// without the port in the hash, all entries of an ip share a bucket
+	CAddrPool(bool HashPort)
+	{
+		m_FirstFree = -1;
+		m_Num = 0;
+		m_HashPort = HashPort;
+		Rehash(256);
+	}
+
+	int Num() const { return m_Num; }
+	int Capacity() const { return m_aEntries.size(); }
+	bool Used(int ID) const { return m_aUsed[ID] != 0; }
+	T *Get(int ID) { return &m_aEntries[ID]; }
+
+	// iterates the entries that share the bucket of an address, ends with -1
+	int First(const NETADDR *pAddr) const { return m_aBuckets[Bucket(pAddr)]; }
+	int Next(int ID) const { return m_aNext[ID]; }
+
+	int Find(const NETADDR *pAddr) const
+	{
+		for(int ID = First(pAddr); ID != -1; ID = Next(ID))
+			if(net_addr_comp(&m_aEntries[ID].m_Address, pAddr) == 0)
+				return ID;
+		return -1;
+	}
+
+	int Add(const NETADDR *pAddr)
+	{
+		int ID = m_FirstFree;
+		if(ID != -1)
+			m_FirstFree = m_aNext[ID];
+		else
+		{
+			T Entry;
+			mem_zero(&Entry, sizeof(Entry));
+			ID = m_aEntries.add(Entry);
+			m_aNext.add(-1);
+			m_aUsed.add(0);
+		}
+
+		mem_zero(&m_aEntries[ID], sizeof(T));
+		m_aEntries[ID].m_Address = *pAddr;
+		m_aUsed[ID] = 1;
+		m_Num++;
+
+		if(m_Num > m_aBuckets.size())
+			Rehash(m_aBuckets.size()*2);
+		else
+			Link(ID);
+		return ID;
+	}
+
+	void Remove(int ID)
+	{
+		int *pLink = &m_aBuckets[Bucket(&m_aEntries[ID].m_Address)];
+		while(*pLink != ID)
+			pLink = &m_aNext[*pLink];
+		*pLink = m_aNext[ID];
+
+		m_aUsed[ID] = 0;
+		m_aNext[ID] = m_FirstFree;
+		m_FirstFree = ID;
+		m_Num--;
+	}
 };
 
 struct CCheckServer
@@ -31,18 +142,25 @@ struct CCheckServer
 	int64 m_TryTime;
 };
 
-static CCheckServer m_aCheckServers[MAX_SERVERS];
-static int m_NumCheckServers = 0;
+// the alternative address only differs in the port, so hash the ip alone
+static CAddrPool<CCheckServer> m_CheckServers(false);
 
 struct CServerEntry
 {
 	enum ServerType m_Type;
 	NETADDR m_Address;
 	int64 m_Expire;
+	int m_Slot; // position in the list packets of its type
+
+	// all servers expire after the same time, so the least recently
+	// updated one is always the next to expire
+	int m_PrevExpire;
+	int m_NextExpire;
 };
 
-static CServerEntry m_aServers[MAX_SERVERS];
-static int m_NumServers = 0;
+static CAddrPool<CServerEntry> m_Servers(true);
+static int m_FirstExpire = -1;
+static int m_LastExpire = -1;
 
 struct CPacketData
 {
@@ -53,7 +171,7 @@ struct CPacketData
 	} m_Data;
 };
 
-CPacketData m_aPackets[MAX_PACKETS];
+array<CPacketData> m_aPackets;
 static int m_NumPackets = 0;
 
 // legacy code
@@ -66,9 +184,47 @@ struct CPacketDataLegacy
 	} m_Data;
 };
 
-CPacketDataLegacy m_aPacketsLegacy[MAX_PACKETS];
+array<CPacketDataLegacy> m_aPacketsLegacy;
 static int m_NumPacketsLegacy = 0;
 
+// server ids in packet order and the packets that have to be rebuilt, per server type
+static array<int> m_aServerSlots[NUM_SERVERTYPES];
+static array<int> m_aDirtyPackets[NUM_SERVERTYPES];
+
+// bumped whenever the list packets change
+static int m_ListVersion = 0;
+
+// list responses are sent a few packets at a time from the main loop
+struct CListRequest
+{
+	NETADDR m_Address;
+	bool m_Legacy;
+	int m_NextPacket;
+	int m_Version;
+};
+
+static array<CListRequest> m_aListRequests;
+
+// token bucket per /24 (ipv6 /64), counted in list packets
+struct CRequestBucket
+{
+	NETADDR m_Address;
+	float m_Tokens;
+	int64 m_LastTime;
+	int m_NumRefused;
+};
+
+static CAddrPool<CRequestBucket> m_RequestBuckets(true);
+
+// flood bans are given again after the bans got reloaded from master.cfg
+struct CFloodBan
+{
+	CNetRange m_Range;
+	int64 m_Expires;
+};
+
+static array<CFloodBan> m_aFloodBans;
+
 
 struct CCountPacketData
 {
@@ -88,83 +244,258 @@ static CNetClient m_NetOp; // main
 
 IConsole *m_pConsole;
 
+void MarkPacketDirty(ServerType Type, int Slot)
+{
+	int Packet = Slot/MAX_SERVERS_PER_PACKET;
+	while(m_aDirtyPackets[Type].size() <= Packet)
+		m_aDirtyPackets[Type].add(0);
+	m_aDirtyPackets[Type][Packet] = 1;
+}
+
+void BuildPacket(int Packet)
+{
+	CPacketData *pPacket = &m_aPackets[Packet];
+	const array<int> &rSlots = m_aServerSlots[SERVERTYPE_NORMAL];
+	int First = Packet*MAX_SERVERS_PER_PACKET;
+	int Num = min(rSlots.size()-First, (int)MAX_SERVERS_PER_PACKET);
+
+	// copy header
+	mem_copy(pPacket->m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
+
+	for(int i = 0; i < Num; i++)
+	{
+		const CServerEntry *pCurrent = m_Servers.Get(rSlots[First+i]);
+
+		// copy server addresses
+		if(pCurrent->m_Address.type == NETTYPE_IPV6)
+		{
+			mem_copy(pPacket->m_Data.m_aServers[i].m_aIp, pCurrent->m_Address.ip, sizeof(pPacket->m_Data.m_aServers[i].m_aIp));
+		}
+		else
+		{
+			static char IPV4Mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
+
+			mem_copy(pPacket->m_Data.m_aServers[i].m_aIp, IPV4Mapping, sizeof(IPV4Mapping));
+			pPacket->m_Data.m_aServers[i].m_aIp[12] = pCurrent->m_Address.ip[0];
+			pPacket->m_Data.m_aServers[i].m_aIp[13] = pCurrent->m_Address.ip[1];
+			pPacket->m_Data.m_aServers[i].m_aIp[14] = pCurrent->m_Address.ip[2];
+			pPacket->m_Data.m_aServers[i].m_aIp[15] = pCurrent->m_Address.ip[3];
+		}
+
+		pPacket->m_Data.m_aServers[i].m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
+		pPacket->m_Data.m_aServers[i].m_aPort[1] = pCurrent->m_Address.port&0xff;
+	}
+
+	pPacket->m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*Num;
+}
+
+void BuildPacketLegacy(int Packet)
+{
+	CPacketDataLegacy *pPacket = &m_aPacketsLegacy[Packet];
+	const array<int> &rSlots = m_aServerSlots[SERVERTYPE_LEGACY];
+	int First = Packet*MAX_SERVERS_PER_PACKET;
+	int Num = min(rSlots.size()-First, (int)MAX_SERVERS_PER_PACKET);
+
+	// copy header
+	mem_copy(pPacket->m_Data.m_aHeader, SERVERBROWSE_LIST_LEGACY, sizeof(SERVERBROWSE_LIST_LEGACY));
+
+	for(int i = 0; i < Num; i++)
+	{
+		const CServerEntry *pCurrent = m_Servers.Get(rSlots[First+i]);
+
+		// copy server addresses
+		mem_copy(pPacket->m_Data.m_aServers[i].m_aIp, pCurrent->m_Address.ip, sizeof(pPacket->m_Data.m_aServers[i].m_aIp));
+		// 0.5 has the port in little endian on the network
+		pPacket->m_Data.m_aServers[i].m_aPort[0] = pCurrent->m_Address.port&0xff;
+		pPacket->m_Data.m_aServers[i].m_aPort[1] = (pCurrent->m_Address.port>>8)&0xff;
+	}
+
+	pPacket->m_Size = sizeof(SERVERBROWSE_LIST_LEGACY) + sizeof(CMastersrvAddrLegacy)*Num;
+}
+
 void BuildPackets()
 {
-	CServerEntry *pCurrent = &m_aServers[0];
-	int ServersLeft = m_NumServers;
-	m_NumPackets = 0;
-	m_NumPacketsLegacy = 0;
-	int PacketIndex = 0;
-	int PacketIndexLegacy = 0;
-	while(ServersLeft-- && (m_NumPackets + m_NumPacketsLegacy) < MAX_PACKETS)
+	int OldNumPackets = m_NumPackets;
+	int OldNumPacketsLegacy = m_NumPacketsLegacy;
+	bool Changed = false;
+
+	// only the packets whose servers changed get rebuilt
+	m_NumPackets = (m_aServerSlots[SERVERTYPE_NORMAL].size()+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET;
+	while(m_aPackets.size() < m_NumPackets)
+	{
+		CPacketData Packet;
+		mem_zero(&Packet, sizeof(Packet));
+		m_aPackets.add(Packet);
+	}
+	for(int i = 0; i < m_aDirtyPackets[SERVERTYPE_NORMAL].size(); i++)
+	{
+		if(m_aDirtyPackets[SERVERTYPE_NORMAL][i] && i < m_NumPackets)
+		{
+			BuildPacket(i);
+			Changed = true;
+		}
+		m_aDirtyPackets[SERVERTYPE_NORMAL][i] = 0;
+	}
+
+	m_NumPacketsLegacy = (m_aServerSlots[SERVERTYPE_LEGACY].size()+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET;
+	while(m_aPacketsLegacy.size() < m_NumPacketsLegacy)
+	{
+		CPacketDataLegacy Packet;
+		mem_zero(&Packet, sizeof(Packet));
+		m_aPacketsLegacy.add(Packet);
+	}
+	for(int i = 0; i < m_aDirtyPackets[SERVERTYPE_LEGACY].size(); i++)
+	{
+		if(m_aDirtyPackets[SERVERTYPE_LEGACY][i] && i < m_NumPacketsLegacy)
+		{
+			BuildPacketLegacy(i);
+			Changed = true;
+		}
+		m_aDirtyPackets[SERVERTYPE_LEGACY][i] = 0;
+	}
+
+	if(Changed || OldNumPackets != m_NumPackets || OldNumPacketsLegacy != m_NumPacketsLegacy)
+		m_ListVersion++;
+}
+
+void AddListRequest(const NETADDR *pAddr, bool Legacy)
+{
+	if(m_aListRequests.size() >= MAX_LIST_REQUESTS)
+	{
+		dbg_msg("mastersrv", "error: too many pending list requests");
+		return;
+	}
+
+	CListRequest Request;
+	Request.m_Address = *pAddr;
+	Request.m_Legacy = Legacy;
+	Request.m_NextPacket = 0;
+	Request.m_Version = m_ListVersion;
+	m_aListRequests.add(Request);
+}
+
+void SendListPackets()
+{
+	CNetChunk p;
+	p.m_ClientID = -1;
+	p.m_Flags = NETSENDFLAG_CONNLESS;
+
+	// one packet per request and pass, so a long list doesn't hold up the others
+	int Budget = SEND_BATCH;
+	while(Budget > 0 && m_aListRequests.size())
 	{
-		if(pCurrent->m_Type == SERVERTYPE_NORMAL)
+		for(int i = 0; Budget > 0 && i < m_aListRequests.size();)
 		{
-			if(PacketIndex % MAX_SERVERS_PER_PACKET == 0)
+			CListRequest *pRequest = &m_aListRequests[i];
+
+			// a server moved between packets, start over to not miss it
+			if(pRequest->m_Version != m_ListVersion)
 			{
-				PacketIndex = 0;
-				m_NumPackets++;
+				pRequest->m_Version = m_ListVersion;
+				pRequest->m_NextPacket = 0;
 			}
 
-			// copy header
-			mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
-
-			// copy server addresses
-			if(pCurrent->m_Address.type == NETTYPE_IPV6)
+			int NumPackets = pRequest->m_Legacy ? m_NumPacketsLegacy : m_NumPackets;
+			if(pRequest->m_NextPacket < NumPackets)
 			{
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, pCurrent->m_Address.ip,
-					sizeof(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp));
+				p.m_Address = pRequest->m_Address;
+				if(pRequest->m_Legacy)
+				{
+					p.m_DataSize = m_aPacketsLegacy[pRequest->m_NextPacket].m_Size;
+					p.m_pData = &m_aPacketsLegacy[pRequest->m_NextPacket].m_Data;
+				}
+				else
+				{
+					p.m_DataSize = m_aPackets[pRequest->m_NextPacket].m_Size;
+					p.m_pData = &m_aPackets[pRequest->m_NextPacket].m_Data;
+				}
+				m_NetOp.Send(&p);
+				pRequest->m_NextPacket++;
+				Budget--;
 			}
+
+			if(pRequest->m_NextPacket >= NumPackets)
+				m_aListRequests.remove_index_fast(i);
 			else
-			{
-				static char IPV4Mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
+				i++;
+		}
+	}
+}
 
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, IPV4Mapping, sizeof(IPV4Mapping));
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[12] = pCurrent->m_Address.ip[0];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[13] = pCurrent->m_Address.ip[1];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[14] = pCurrent->m_Address.ip[2];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[15] = pCurrent->m_Address.ip[3];
-			}
+// the range of addresses that shares a request bucket
+void GetRequestPrefix(const NETADDR *pAddr, NETADDR *pPrefix, CNetRange *pRange)
+{
+	int Start = pAddr->type == NETTYPE_IPV4 ? 3 : 8;
+	int Length = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
 
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[1] = pCurrent->m_Address.port&0xff;
+	*pPrefix = *pAddr;
+	pPrefix->port = 0;
+	mem_zero(&pPrefix->ip[Start], Length-Start);
 
-			PacketIndex++;
+	pRange->m_LB = *pPrefix;
+	pRange->m_UB = *pPrefix;
+	for(int i = Start; i < Length; i++)
+		pRange->m_UB.ip[i] = 0xff;
+}
 
-			m_aPackets[m_NumPackets-1].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*PacketIndex;
+bool AllowRequest(const NETADDR *pAddr, int Cost)
+{
+	if(!g_Config.m_MsRequestRate)
+		return true;
 
-			pCurrent++;
-		}
-		else if(pCurrent->m_Type == SERVERTYPE_LEGACY)
-		{
-			if(PacketIndexLegacy % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndexLegacy = 0;
-				m_NumPacketsLegacy++;
-			}
+	NETADDR Prefix;
+	CNetRange Range;
+	GetRequestPrefix(pAddr, &Prefix, &Range);
 
-			// copy header
-			mem_copy(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aHeader, SERVERBROWSE_LIST_LEGACY, sizeof(SERVERBROWSE_LIST_LEGACY));
+	int64 Now = time_get();
+	int ID = m_RequestBuckets.Find(&Prefix);
+	CRequestBucket *pBucket;
+	if(ID == -1)
+	{
+		pBucket = m_RequestBuckets.Get(m_RequestBuckets.Add(&Prefix));
+		pBucket->m_Tokens = g_Config.m_MsRequestBurst;
+		pBucket->m_LastTime = Now;
+		pBucket->m_NumRefused = 0;
+	}
+	else
+		pBucket = m_RequestBuckets.Get(ID);
 
-			// copy server addresses
-			mem_copy(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aIp, pCurrent->m_Address.ip,
-				sizeof(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aIp));
-			// 0.5 has the port in little endian on the network
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aPort[0] = pCurrent->m_Address.port&0xff;
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aPort[1] = (pCurrent->m_Address.port>>8)&0xff;
+	pBucket->m_Tokens = min(pBucket->m_Tokens + (Now-pBucket->m_LastTime)*g_Config.m_MsRequestRate/(float)time_freq(), (float)g_Config.m_MsRequestBurst);
+	pBucket->m_LastTime = Now;
 
-			PacketIndexLegacy++;
+	// a request may overdraw the bucket, the next one waits until it's paid off
+	if(pBucket->m_Tokens > 0.0f)
+	{
+		pBucket->m_Tokens -= Cost;
+		pBucket->m_NumRefused = 0;
+		return true;
+	}
 
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Size = sizeof(SERVERBROWSE_LIST_LEGACY) + sizeof(CMastersrvAddrLegacy)*PacketIndexLegacy;
+	if(++pBucket->m_NumRefused >= FLOOD_REFUSED && g_Config.m_MsFloodBantime)
+	{
+		m_NetBan.BanRange(&Range, g_Config.m_MsFloodBantime, "request flood");
+		m_RequestBuckets.Remove(m_RequestBuckets.Find(&Prefix));
 
-			pCurrent++;
-		}
-		else
-		{
-			*pCurrent = m_aServers[m_NumServers-1];
-			m_NumServers--;
-			dbg_msg("mastersrv", "error: server of invalid type, dropping it");
-		}
+		CFloodBan FloodBan;
+		FloodBan.m_Range = Range;
+		FloodBan.m_Expires = Now+g_Config.m_MsFloodBantime*time_freq();
+		m_aFloodBans.add(FloodBan);
+	}
+	return false;
+}
+
+void PurgeRequestBuckets()
+{
+	// buckets that are full again are the same as no bucket
+	int64 Now = time_get();
+	for(int i = 0; i < m_RequestBuckets.Capacity(); i++)
+	{
+		if(!m_RequestBuckets.Used(i))
+			continue;
+
+		CRequestBucket *pBucket = m_RequestBuckets.Get(i);
+		if(pBucket->m_Tokens + (Now-pBucket->m_LastTime)*g_Config.m_MsRequestRate/(float)time_freq() >= g_Config.m_MsRequestBurst)
+			m_RequestBuckets.Remove(i);
 	}
 }
 
@@ -206,87 +537,131 @@ void SendCheck(NETADDR *pAddr)
 
 void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type)
 {
-	// add server
-	if(m_NumCheckServers == MAX_SERVERS)
-	{
-		dbg_msg("mastersrv", "error: mastersrv is full");
+	// a server that repeats its heartbeat is already being checked
+	if(m_CheckServers.Find(pInfo) != -1)
 		return;
-	}
 
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
 	char aAltAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pAlt, aAltAddrStr, sizeof(aAltAddrStr), true);
 	dbg_msg("mastersrv", "checking: %s (%s)", aAddrStr, aAltAddrStr);
-	m_aCheckServers[m_NumCheckServers].m_Address = *pInfo;
-	m_aCheckServers[m_NumCheckServers].m_AltAddress = *pAlt;
-	m_aCheckServers[m_NumCheckServers].m_TryCount = 0;
-	m_aCheckServers[m_NumCheckServers].m_TryTime = 0;
-	m_aCheckServers[m_NumCheckServers].m_Type = Type;
-	m_NumCheckServers++;
+
+	// add server
+	CCheckServer *pCheck = m_CheckServers.Get(m_CheckServers.Add(pInfo));
+	pCheck->m_AltAddress = *pAlt;
+	pCheck->m_TryCount = 0;
+	pCheck->m_TryTime = 0;
+	pCheck->m_Type = Type;
+}
+
+void UnlinkExpire(int ID)
+{
+	CServerEntry *pEntry = m_Servers.Get(ID);
+	if(pEntry->m_PrevExpire != -1)
+		m_Servers.Get(pEntry->m_PrevExpire)->m_NextExpire = pEntry->m_NextExpire;
+	else
+		m_FirstExpire = pEntry->m_NextExpire;
+	if(pEntry->m_NextExpire != -1)
+		m_Servers.Get(pEntry->m_NextExpire)->m_PrevExpire = pEntry->m_PrevExpire;
+	else
+		m_LastExpire = pEntry->m_PrevExpire;
+}
+
+void LinkExpire(int ID)
+{
+	CServerEntry *pEntry = m_Servers.Get(ID);
+	pEntry->m_Expire = time_get()+time_freq()*EXPIRE_TIME;
+	pEntry->m_PrevExpire = m_LastExpire;
+	pEntry->m_NextExpire = -1;
+	if(m_LastExpire != -1)
+		m_Servers.Get(m_LastExpire)->m_NextExpire = ID;
+	else
+		m_FirstExpire = ID;
+	m_LastExpire = ID;
 }
 
 void AddServer(NETADDR *pInfo, ServerType Type)
 {
 	// see if server already exists in list
-	for(int i = 0; i < m_NumServers; i++)
+	int ID = m_Servers.Find(pInfo);
+	if(ID != -1)
 	{
-		if(net_addr_comp(&m_aServers[i].m_Address, pInfo) == 0)
-		{
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "updated: %s", aAddrStr);
-			m_aServers[i].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-			return;
-		}
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
+		dbg_msg("mastersrv", "updated: %s", aAddrStr);
+		UnlinkExpire(ID);
+		LinkExpire(ID);
+		return;
 	}
 
-	// add server
-	if(m_NumServers == MAX_SERVERS)
+	if(Type != SERVERTYPE_NORMAL && Type != SERVERTYPE_LEGACY)
 	{
-		dbg_msg("mastersrv", "error: mastersrv is full");
+		dbg_msg("mastersrv", "error: server of invalid type, dropping it");
 		return;
 	}
 
+	// add server
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
 	dbg_msg("mastersrv", "added: %s", aAddrStr);
-	m_aServers[m_NumServers].m_Address = *pInfo;
-	m_aServers[m_NumServers].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-	m_aServers[m_NumServers].m_Type = Type;
-	m_NumServers++;
+	ID = m_Servers.Add(pInfo);
+	CServerEntry *pEntry = m_Servers.Get(ID);
+	pEntry->m_Type = Type;
+	pEntry->m_Slot = m_aServerSlots[Type].add(ID);
+	MarkPacketDirty(Type, pEntry->m_Slot);
+	LinkExpire(ID);
+}
+
+void RemoveServer(int ID)
+{
+	CServerEntry *pEntry = m_Servers.Get(ID);
+	array<int> &rSlots = m_aServerSlots[pEntry->m_Type];
+
+	// the last server of the type takes over the slot
+	int Last = rSlots.size()-1;
+	MarkPacketDirty(pEntry->m_Type, pEntry->m_Slot);
+	MarkPacketDirty(pEntry->m_Type, Last);
+	rSlots[pEntry->m_Slot] = rSlots[Last];
+	m_Servers.Get(rSlots[Last])->m_Slot = pEntry->m_Slot;
+	rSlots.set_size(Last);
+
+	UnlinkExpire(ID);
+	m_Servers.Remove(ID);
 }
 
 void UpdateServers()
 {
 	int64 Now = time_get();
 	int64 Freq = time_freq();
-	for(int i = 0; i < m_NumCheckServers; i++)
+	for(int i = 0; i < m_CheckServers.Capacity(); i++)
 	{
-		if(Now > m_aCheckServers[i].m_TryTime+Freq)
+		if(!m_CheckServers.Used(i))
+			continue;
+
+		CCheckServer *pCheck = m_CheckServers.Get(i);
+		if(Now > pCheck->m_TryTime+Freq)
 		{
-			if(m_aCheckServers[i].m_TryCount == 10)
+			if(pCheck->m_TryCount == 10)
 			{
 				char aAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
+				net_addr_str(&pCheck->m_Address, aAddrStr, sizeof(aAddrStr), true);
 				char aAltAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
+				net_addr_str(&pCheck->m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
 				dbg_msg("mastersrv", "check failed: %s (%s)", aAddrStr, aAltAddrStr);
 
 				// FAIL!!
-				SendError(&m_aCheckServers[i].m_Address);
-				m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers-1];
-				m_NumCheckServers--;
-				i--;
+				SendError(&pCheck->m_Address);
+				m_CheckServers.Remove(i);
 			}
 			else
 			{
-				m_aCheckServers[i].m_TryCount++;
-				m_aCheckServers[i].m_TryTime = Now;
-				if(m_aCheckServers[i].m_TryCount&1)
-					SendCheck(&m_aCheckServers[i].m_Address);
+				pCheck->m_TryCount++;
+				pCheck->m_TryTime = Now;
+				if(pCheck->m_TryCount&1)
+					SendCheck(&pCheck->m_Address);
 				else
-					SendCheck(&m_aCheckServers[i].m_AltAddress);
+					SendCheck(&pCheck->m_AltAddress);
 			}
 		}
 	}
@@ -295,20 +670,13 @@ void UpdateServers()
 void PurgeServers()
 {
 	int64 Now = time_get();
-	int i = 0;
-	while(i < m_NumServers)
+	while(m_FirstExpire != -1 && m_Servers.Get(m_FirstExpire)->m_Expire < Now)
 	{
-		if(m_aServers[i].m_Expire < Now)
-		{
-			// remove server
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(&m_aServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "expired: %s", aAddrStr);
-			m_aServers[i] = m_aServers[m_NumServers-1];
-			m_NumServers--;
-		}
-		else
-			i++;
+		// remove server
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(&m_Servers.Get(m_FirstExpire)->m_Address, aAddrStr, sizeof(aAddrStr), true);
+		dbg_msg("mastersrv", "expired: %s", aAddrStr);
+		RemoveServer(m_FirstExpire);
 	}
 }
 
@@ -316,6 +684,20 @@ void ReloadBans()
 {
 	m_NetBan.UnbanAll();
 	m_pConsole->ExecuteFile("master.cfg");
+
+	// give the flood bans that are still running again, with the time they have left
+	int64 Now = time_get();
+	for(int i = 0; i < m_aFloodBans.size(); )
+	{
+		int Seconds = (int)((m_aFloodBans[i].m_Expires-Now)/time_freq());
+		if(Seconds <= 0)
+		{
+			m_aFloodBans.remove_index_fast(i);
+			continue;
+		}
+		m_NetBan.BanRange(&m_aFloodBans[i].m_Range, Seconds, "request flood");
+		i++;
+	}
 }
 
 int main(int argc, const char **argv) // ignore_convention
@@ -413,7 +795,11 @@ int main(int argc, const char **argv) // ignore_convention
 			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETCOUNT) &&
 				mem_comp(Packet.m_pData, SERVERBROWSE_GETCOUNT, sizeof(SERVERBROWSE_GETCOUNT)) == 0)
 			{
-				dbg_msg("mastersrv", "count requested, responding with %d", m_NumServers);
+				if(!AllowRequest(&Packet.m_Address, 1))
+					continue;
+
+				int NumServers = min(m_Servers.Num(), 0xffff);
+				dbg_msg("mastersrv", "count requested, responding with %d", NumServers);
 
 				CNetChunk p;
 				p.m_ClientID = -1;
@@ -421,14 +807,18 @@ int main(int argc, const char **argv) // ignore_convention
 				p.m_Flags = NETSENDFLAG_CONNLESS;
 				p.m_DataSize = sizeof(m_CountData);
 				p.m_pData = &m_CountData;
-				m_CountData.m_High = (m_NumServers>>8)&0xff;
-				m_CountData.m_Low = m_NumServers&0xff;
+				m_CountData.m_High = (NumServers>>8)&0xff;
+				m_CountData.m_Low = NumServers&0xff;
 				m_NetOp.Send(&p);
 			}
 			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETCOUNT_LEGACY) &&
 				mem_comp(Packet.m_pData, SERVERBROWSE_GETCOUNT_LEGACY, sizeof(SERVERBROWSE_GETCOUNT_LEGACY)) == 0)
 			{
-				dbg_msg("mastersrv", "count requested, responding with %d", m_NumServers);
+				if(!AllowRequest(&Packet.m_Address, 1))
+					continue;
+
+				int NumServers = min(m_Servers.Num(), 0xffff);
+				dbg_msg("mastersrv", "count requested, responding with %d", NumServers);
 
 				CNetChunk p;
 				p.m_ClientID = -1;
@@ -436,48 +826,34 @@ int main(int argc, const char **argv) // ignore_convention
 				p.m_Flags = NETSENDFLAG_CONNLESS;
 				p.m_DataSize = sizeof(m_CountData);
 				p.m_pData = &m_CountDataLegacy;
-				m_CountDataLegacy.m_High = (m_NumServers>>8)&0xff;
-				m_CountDataLegacy.m_Low = m_NumServers&0xff;
+				m_CountDataLegacy.m_High = (NumServers>>8)&0xff;
+				m_CountDataLegacy.m_Low = NumServers&0xff;
 				m_NetOp.Send(&p);
 			}
 			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETLIST) &&
 				mem_comp(Packet.m_pData, SERVERBROWSE_GETLIST, sizeof(SERVERBROWSE_GETLIST)) == 0)
 			{
-				// someone requested the list
-				dbg_msg("mastersrv", "requested, responding with %d m_aServers", m_NumServers);
-
-				CNetChunk p;
-				p.m_ClientID = -1;
-				p.m_Address = Packet.m_Address;
-				p.m_Flags = NETSENDFLAG_CONNLESS;
+				if(!AllowRequest(&Packet.m_Address, max(m_NumPackets, 1)))
+					continue;
 
-				for(int i = 0; i < m_NumPackets; i++)
-				{
-					p.m_DataSize = m_aPackets[i].m_Size;
-					p.m_pData = &m_aPackets[i].m_Data;
-					m_NetOp.Send(&p);
-				}
+				// someone requested the list
+				dbg_msg("mastersrv", "requested, responding with %d m_aServers", m_aServerSlots[SERVERTYPE_NORMAL].size());
+				AddListRequest(&Packet.m_Address, false);
 			}
 			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETLIST_LEGACY) &&
 				mem_comp(Packet.m_pData, SERVERBROWSE_GETLIST_LEGACY, sizeof(SERVERBROWSE_GETLIST_LEGACY)) == 0)
 			{
-				// someone requested the list
-				dbg_msg("mastersrv", "requested, responding with %d m_aServers", m_NumServers);
-
-				CNetChunk p;
-				p.m_ClientID = -1;
-				p.m_Address = Packet.m_Address;
-				p.m_Flags = NETSENDFLAG_CONNLESS;
+				if(!AllowRequest(&Packet.m_Address, max(m_NumPacketsLegacy, 1)))
+					continue;
 
-				for(int i = 0; i < m_NumPacketsLegacy; i++)
-				{
-					p.m_DataSize = m_aPacketsLegacy[i].m_Size;
-					p.m_pData = &m_aPacketsLegacy[i].m_Data;
-					m_NetOp.Send(&p);
-				}
+				// someone requested the list
+				dbg_msg("mastersrv", "requested, responding with %d m_aServers", m_aServerSlots[SERVERTYPE_LEGACY].size());
+				AddListRequest(&Packet.m_Address, true);
 			}
 		}
 
+		SendListPackets();
+
 		// process m_aPackets
 		while(m_NetChecker.Recv(&Packet))
 		{
@@ -490,14 +866,14 @@ int main(int argc, const char **argv) // ignore_convention
 			{
 				Type = SERVERTYPE_INVALID;
 				// remove it from checking
-				for(int i = 0; i < m_NumCheckServers; i++)
+				for(int i = m_CheckServers.First(&Packet.m_Address); i != -1; i = m_CheckServers.Next(i))
 				{
-					if(net_addr_comp(&m_aCheckServers[i].m_Address, &Packet.m_Address) == 0 ||
-						net_addr_comp(&m_aCheckServers[i].m_AltAddress, &Packet.m_Address) == 0)
+					CCheckServer *pCheck = m_CheckServers.Get(i);
+					if(net_addr_comp(&pCheck->m_Address, &Packet.m_Address) == 0 ||
+						net_addr_comp(&pCheck->m_AltAddress, &Packet.m_Address) == 0)
 					{
-						Type = m_aCheckServers[i].m_Type;
-						m_NumCheckServers--;
-						m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers];
+						Type = pCheck->m_Type;
+						m_CheckServers.Remove(i);
 						break;
 					}
 				}
@@ -525,6 +901,8 @@ int main(int argc, const char **argv) // ignore_convention
 			PurgeServers();
 			UpdateServers();
 			BuildPackets();
+			PurgeRequestBuckets();
+			m_NetBan.Update();
 		}
 
 		// be nice to the CPU
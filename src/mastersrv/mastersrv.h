@@ -8,7 +8,8 @@ enum ServerType
 {
 	SERVERTYPE_INVALID = -1,
 	SERVERTYPE_NORMAL,
-	SERVERTYPE_LEGACY
+	SERVERTYPE_LEGACY,
+	NUM_SERVERTYPES
 };
 
 struct CMastersrvAddr
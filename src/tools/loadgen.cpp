@@ -0,0 +1,691 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <stdio.h> // sscanf
+#include <stdlib.h> // rand
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/array.h>
+#include <engine/config.h>
+#include <engine/message.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/linereader.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+#include <game/version.h>
+#include <game/generated/protocol.h>
+
+/*
+	loadgen - connects a number of headless clients to a game server, lets
+	them play with random or scripted inputs and reports snapshot rate, loss,
+	delay and ping once per second.
+
+	One process runs at most MAX_CLIENTS bots, start several for more. The
+	server has to allow that many clients per ip (sv_max_clients_per_ip).
+
+	An input script has one step per line, the steps are played in a loop:
+		<duration in ms> <direction> <jump> <hook> <fire> <target x> <target y>
+*/
+
+struct CScriptStep
+{
+	int m_Duration;
+	int m_Direction;
+	int m_Jump;
+	int m_Hook;
+	int m_Fire;
+	int m_TargetX;
+	int m_TargetY;
+};
+
+struct CStats
+{
+	int m_NumSnaps;
+	int m_NumLostSnaps;
+	int m_NumBadSnaps;
+	int64 m_SnapDelaySum;
+	int64 m_SnapDelayMax;
+
+	int m_NumPings;
+	int64 m_PingSum;
+	int64 m_PingMax;
+
+	int m_NumInputTimings;
+	int m_NumLateInputs;
+	int m_InputTimeLeftSum;
+
+	void Reset() { mem_zero(this, sizeof(*this)); }
+
+	void Add(const CStats &Other)
+	{
+		m_NumSnaps += Other.m_NumSnaps;
+		m_NumLostSnaps += Other.m_NumLostSnaps;
+		m_NumBadSnaps += Other.m_NumBadSnaps;
+		m_SnapDelaySum += Other.m_SnapDelaySum;
+		m_SnapDelayMax = max(m_SnapDelayMax, Other.m_SnapDelayMax);
+		m_NumPings += Other.m_NumPings;
+		m_PingSum += Other.m_PingSum;
+		m_PingMax = max(m_PingMax, Other.m_PingMax);
+		m_NumInputTimings += Other.m_NumInputTimings;
+		m_NumLateInputs += Other.m_NumLateInputs;
+		m_InputTimeLeftSum += Other.m_InputTimeLeftSum;
+	}
+};
+
+static NETADDR s_ServerAddr;
+static const char *s_pPassword = "";
+static bool s_DownloadMap = true;
+static array<CScriptStep> s_aScript;
+
+static CNetObjHandler s_NetObjHandler;
+static CSnapshotDelta s_SnapshotDelta;
+
+static CStats s_Stats; // since the last report
+static CStats s_TotalStats;
+
+static float ToMs(int64 Time) { return Time*1000.0f/time_freq(); }
+
+class CBot
+{
+	enum
+	{
+		STATE_OFFLINE=0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_ENTERING,
+		STATE_ONLINE,
+	};
+
+	int m_ID;
+	CNetClient m_Net;
+	int m_State;
+	int64 m_ConnectTime;
+
+	// map download, the data is thrown away
+	int m_MapCrc;
+	int m_MapChunk;
+
+	// snapshots
+	CSnapshotStorage m_SnapshotStorage;
+	char m_aSnapshotIncomingData[CSnapshot::MAX_SIZE];
+	unsigned m_SnapshotParts;
+	int m_CurrentRecvTick;
+	int m_AckGameTick;
+	int m_SnapInterval;
+	int m_LastSnapTick;
+	int64 m_LastSnapTime;
+	int64 m_SnapBaseTime; // local time of tick 0 at the lowest delay seen so far
+
+	// inputs
+	CNetObj_PlayerInput m_Input;
+	int m_PredTick;
+	int m_InputAhead;
+	int64 m_NextInputChange;
+	int m_ScriptStep;
+
+	int64 m_PingTime;
+
+	void SendMsg(CMsgPacker *pMsg, int Flags, bool System)
+	{
+		CNetChunk Packet;
+		mem_zero(&Packet, sizeof(Packet));
+		Packet.m_ClientID = 0;
+		Packet.m_pData = pMsg->Data();
+		Packet.m_DataSize = pMsg->Size();
+
+		// the message id carries the system flag, same as in the client
+		*((unsigned char*)Packet.m_pData) <<= 1;
+		if(System)
+			*((unsigned char*)Packet.m_pData) |= 1;
+
+		if(Flags&MSGFLAG_VITAL)
+			Packet.m_Flags |= NETSENDFLAG_VITAL;
+		if(Flags&MSGFLAG_FLUSH)
+			Packet.m_Flags |= NETSENDFLAG_FLUSH;
+		m_Net.Send(&Packet);
+	}
+
+	void SendReady()
+	{
+		CMsgPacker Msg(NETMSG_READY);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+
+	void RequestMapChunk()
+	{
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
+		Msg.AddInt(m_MapChunk);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+
+	void SetInput(int Direction, int Jump, int Hook, int Fire, int TargetX, int TargetY)
+	{
+		m_Input.m_Direction = Direction;
+		m_Input.m_Jump = Jump;
+		m_Input.m_Hook = Hook;
+		// the fire counter counts presses and releases
+		if((m_Input.m_Fire&1) != (Fire ? 1 : 0))
+			m_Input.m_Fire++;
+		m_Input.m_TargetX = TargetX;
+		m_Input.m_TargetY = TargetY;
+		m_Input.m_PlayerFlags = PLAYERFLAG_PLAYING;
+	}
+
+	void UpdateInput(int64 Now)
+	{
+		if(Now < m_NextInputChange)
+			return;
+
+		if(s_aScript.size())
+		{
+			const CScriptStep *pStep = &s_aScript[m_ScriptStep];
+			SetInput(pStep->m_Direction, pStep->m_Jump, pStep->m_Hook, pStep->m_Fire, pStep->m_TargetX, pStep->m_TargetY);
+			m_NextInputChange = Now + pStep->m_Duration*time_freq()/1000;
+			m_ScriptStep = (m_ScriptStep+1)%s_aScript.size();
+		}
+		else
+		{
+			SetInput(rand()%3-1, rand()%10 == 0, rand()%5 == 0, rand()%3 == 0, rand()%601-300, rand()%601-300);
+			m_NextInputChange = Now + (200+rand()%600)*time_freq()/1000;
+		}
+	}
+
+	void SendInput(int64 Now)
+	{
+		if(m_State != STATE_ONLINE || m_LastSnapTick < 0)
+			return;
+
+		// aim for the tick the server will be at when the input arrives
+		int PredTick = m_LastSnapTick + (int)((Now-m_LastSnapTime)*SERVER_TICK_SPEED/time_freq()) + m_InputAhead;
+		if(PredTick <= m_PredTick)
+			return;
+		m_PredTick = PredTick;
+
+		UpdateInput(Now);
+
+		CMsgPacker Msg(NETMSG_INPUT);
+		Msg.AddInt(m_AckGameTick);
+		Msg.AddInt(m_PredTick);
+		Msg.AddInt(sizeof(m_Input));
+		const int *pData = (const int *)&m_Input;
+		for(unsigned i = 0; i < sizeof(m_Input)/4; i++)
+			Msg.AddInt(pData[i]);
+		SendMsg(&Msg, MSGFLAG_FLUSH, true);
+	}
+
+	void OnSnapshot(int GameTick, int64 Now)
+	{
+		s_Stats.m_NumSnaps++;
+
+		// the smallest tick step seen is the snapshot rate, bigger steps are lost snapshots
+		if(m_LastSnapTick >= 0 && GameTick > m_LastSnapTick)
+		{
+			int Step = GameTick-m_LastSnapTick;
+			if(m_SnapInterval == 0 || Step < m_SnapInterval)
+				m_SnapInterval = Step;
+			s_Stats.m_NumLostSnaps += Step/m_SnapInterval-1;
+		}
+
+		// delay relative to the fastest snapshot so far
+		int64 BaseTime = Now - GameTick*time_freq()/SERVER_TICK_SPEED;
+		if(m_SnapBaseTime == 0 || BaseTime < m_SnapBaseTime)
+			m_SnapBaseTime = BaseTime;
+		int64 Delay = BaseTime-m_SnapBaseTime;
+		s_Stats.m_SnapDelaySum += Delay;
+		s_Stats.m_SnapDelayMax = max(s_Stats.m_SnapDelayMax, Delay);
+
+		m_LastSnapTick = GameTick;
+		m_LastSnapTime = Now;
+	}
+
+	void ProcessSnapshot(int Msg, CUnpacker *pUnpacker, int64 Now)
+	{
+		int NumParts = 1;
+		int Part = 0;
+		int GameTick = pUnpacker->GetInt();
+		int DeltaTick = GameTick-pUnpacker->GetInt();
+		int PartSize = 0;
+		int Crc = 0;
+
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = pUnpacker->GetInt();
+			Part = pUnpacker->GetInt();
+		}
+
+		if(Msg != NETMSG_SNAPEMPTY)
+		{
+			Crc = pUnpacker->GetInt();
+			PartSize = pUnpacker->GetInt();
+		}
+
+		const char *pData = (const char *)pUnpacker->GetRaw(PartSize);
+		if(pUnpacker->Error() || Part < 0 || Part >= NumParts || NumParts > 32 || PartSize < 0 || PartSize > MAX_SNAPSHOT_PACKSIZE)
+			return;
+
+		if(GameTick < m_CurrentRecvTick)
+			return;
+		if(GameTick != m_CurrentRecvTick)
+		{
+			m_SnapshotParts = 0;
+			m_CurrentRecvTick = GameTick;
+		}
+
+		mem_copy(m_aSnapshotIncomingData + Part*MAX_SNAPSHOT_PACKSIZE, pData, PartSize);
+		m_SnapshotParts |= 1<<Part;
+		if(m_SnapshotParts != (unsigned)((1<<NumParts)-1))
+			return;
+		m_SnapshotParts = 0;
+
+		// find the snapshot the server used as delta
+		static CSnapshot Emptysnap;
+		CSnapshot *pDeltaShot = &Emptysnap;
+		Emptysnap.Clear();
+		if(DeltaTick >= 0 && m_SnapshotStorage.Get(DeltaTick, 0, &pDeltaShot, 0) < 0)
+		{
+			// force the server to resync
+			s_Stats.m_NumBadSnaps++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		unsigned char aDeltaData[CSnapshot::MAX_SIZE];
+		unsigned char aSnapData[CSnapshot::MAX_SIZE];
+		CSnapshot *pSnap = (CSnapshot *)aSnapData;
+		void *pDeltaData = s_SnapshotDelta.EmptyDelta();
+		int DeltaSize = sizeof(int)*3;
+		int CompleteSize = (NumParts-1)*MAX_SNAPSHOT_PACKSIZE + PartSize;
+		if(CompleteSize)
+		{
+			DeltaSize = CVariableInt::Decompress(m_aSnapshotIncomingData, CompleteSize, aDeltaData);
+			if(DeltaSize < 0)
+			{
+				s_Stats.m_NumBadSnaps++;
+				return;
+			}
+			pDeltaData = aDeltaData;
+		}
+
+		int SnapSize = s_SnapshotDelta.UnpackDelta(pDeltaShot, pSnap, pDeltaData, DeltaSize);
+		if(SnapSize < 0 || (Msg != NETMSG_SNAPEMPTY && pSnap->Crc() != Crc))
+		{
+			s_Stats.m_NumBadSnaps++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		// keep the snapshots the server may still use as delta
+		int PurgeTick = DeltaTick;
+		if(m_AckGameTick >= 0 && m_AckGameTick < PurgeTick)
+			PurgeTick = m_AckGameTick;
+		m_SnapshotStorage.PurgeUntil(PurgeTick);
+		m_SnapshotStorage.Add(GameTick, Now, SnapSize, pSnap, 0);
+
+		m_AckGameTick = GameTick;
+		OnSnapshot(GameTick, Now);
+	}
+
+	void ProcessPacket(CNetChunk *pPacket, int64 Now)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+
+		int Msg = Unpacker.GetInt();
+		int Sys = Msg&1;
+		Msg >>= 1;
+		if(Unpacker.Error())
+			return;
+
+		if(Sys)
+		{
+			if(Msg == NETMSG_MAP_CHANGE)
+			{
+				Unpacker.GetString();
+				m_MapCrc = Unpacker.GetInt();
+				Unpacker.GetInt();
+				m_MapChunk = 0;
+				m_State = STATE_LOADING;
+				if(s_DownloadMap)
+					RequestMapChunk();
+				else
+					SendReady();
+			}
+			else if(Msg == NETMSG_MAP_DATA)
+			{
+				int Last = Unpacker.GetInt();
+				int MapCrc = Unpacker.GetInt();
+				int Chunk = Unpacker.GetInt();
+				if(Unpacker.Error() || MapCrc != m_MapCrc || Chunk != m_MapChunk)
+					return;
+
+				if(Last)
+					SendReady();
+				else
+				{
+					m_MapChunk++;
+					RequestMapChunk();
+				}
+			}
+			else if(Msg == NETMSG_CON_READY)
+			{
+				CNetMsg_Cl_StartInfo StartInfo;
+				char aName[MAX_NAME_LENGTH];
+				str_format(aName, sizeof(aName), "bot%d", m_ID);
+				StartInfo.m_pName = aName;
+				StartInfo.m_pClan = "loadgen";
+				StartInfo.m_Country = -1;
+				StartInfo.m_pSkin = "default";
+				StartInfo.m_UseCustomColor = 0;
+				StartInfo.m_ColorBody = 0;
+				StartInfo.m_ColorFeet = 0;
+				CMsgPacker Packer(StartInfo.MsgID());
+				StartInfo.Pack(&Packer);
+				SendMsg(&Packer, MSGFLAG_VITAL|MSGFLAG_FLUSH, false);
+				m_State = STATE_ENTERING;
+			}
+			else if(Msg == NETMSG_PING)
+			{
+				CMsgPacker Msg(NETMSG_PING_REPLY);
+				SendMsg(&Msg, 0, true);
+			}
+			else if(Msg == NETMSG_PING_REPLY)
+			{
+				int64 Ping = Now-m_PingTime;
+				s_Stats.m_NumPings++;
+				s_Stats.m_PingSum += Ping;
+				s_Stats.m_PingMax = max(s_Stats.m_PingMax, Ping);
+			}
+			else if(Msg == NETMSG_INPUTTIMING)
+			{
+				Unpacker.GetInt();
+				int TimeLeft = Unpacker.GetInt();
+				if(Unpacker.Error())
+					return;
+
+				s_Stats.m_NumInputTimings++;
+				s_Stats.m_InputTimeLeftSum += TimeLeft;
+
+				// keep the inputs 20-100ms ahead of the server
+				if(TimeLeft < 0)
+					s_Stats.m_NumLateInputs++;
+				if(TimeLeft < 20)
+					m_InputAhead++;
+				else if(TimeLeft > 100 && m_InputAhead > 1)
+					m_InputAhead--;
+			}
+			else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+			{
+				if(m_State >= STATE_ENTERING)
+					ProcessSnapshot(Msg, &Unpacker, Now);
+			}
+		}
+		else if(Msg == NETMSGTYPE_SV_READYTOENTER)
+		{
+			CMsgPacker Msg(NETMSG_ENTERGAME);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+			m_State = STATE_ONLINE;
+			dbg_msg("loadgen", "bot %d entered the game after %.0fms", m_ID, ToMs(Now-m_ConnectTime));
+		}
+	}
+
+public:
+	CBot()
+	{
+		m_State = STATE_OFFLINE;
+	}
+
+	bool Online() const { return m_State == STATE_ONLINE; }
+	bool Offline() const { return m_State == STATE_OFFLINE; }
+
+	bool Connect(int ID)
+	{
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = s_ServerAddr.type;
+		if(!m_Net.Open(BindAddr, 0))
+			return false;
+
+		m_ID = ID;
+		m_State = STATE_CONNECTING;
+		m_ConnectTime = time_get();
+		m_SnapshotStorage.Init();
+		m_SnapshotParts = 0;
+		m_CurrentRecvTick = 0;
+		m_AckGameTick = -1;
+		m_SnapInterval = 0;
+		m_LastSnapTick = -1;
+		m_LastSnapTime = 0;
+		m_SnapBaseTime = 0;
+		mem_zero(&m_Input, sizeof(m_Input));
+		m_PredTick = 0;
+		m_InputAhead = 3;
+		m_NextInputChange = 0;
+		m_ScriptStep = 0;
+		m_PingTime = 0;
+
+		m_Net.Connect(&s_ServerAddr);
+		return true;
+	}
+
+	void Disconnect()
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+		m_Net.Disconnect("loadgen done");
+		m_Net.Update();
+		m_Net.Close();
+		m_SnapshotStorage.PurgeAll();
+		m_State = STATE_OFFLINE;
+	}
+
+	void Update(int64 Now)
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+
+		m_Net.Update();
+		if(m_Net.State() == NETSTATE_OFFLINE)
+		{
+			dbg_msg("loadgen", "bot %d dropped: %s", m_ID, m_Net.ErrorString());
+			m_Net.Close();
+			m_SnapshotStorage.PurgeAll();
+			m_State = STATE_OFFLINE;
+			return;
+		}
+
+		// send the info once the connection is up
+		if(m_State == STATE_CONNECTING && m_Net.State() == NETSTATE_ONLINE && m_ConnectTime)
+		{
+			CMsgPacker Msg(NETMSG_INFO);
+			Msg.AddString(GAME_NETVERSION, 128);
+			Msg.AddString(s_pPassword, 128);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+			m_State = STATE_LOADING;
+		}
+
+		CNetChunk Packet;
+		while(m_Net.Recv(&Packet))
+		{
+			if(Packet.m_ClientID != -1)
+				ProcessPacket(&Packet, Now);
+		}
+
+		// ping once a second
+		if(m_State == STATE_ONLINE && Now > m_PingTime+time_freq())
+		{
+			m_PingTime = Now;
+			CMsgPacker Msg(NETMSG_PING);
+			SendMsg(&Msg, MSGFLAG_FLUSH, true);
+		}
+
+		SendInput(Now);
+	}
+};
+
+static bool LoadScript(const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return false;
+
+	CLineReader LineReader;
+	LineReader.Init(File);
+	char *pLine;
+	while((pLine = LineReader.Get()))
+	{
+		CScriptStep Step;
+		if(pLine[0] == '#' || sscanf(pLine, "%d %d %d %d %d %d %d", &Step.m_Duration, &Step.m_Direction, &Step.m_Jump,
+			&Step.m_Hook, &Step.m_Fire, &Step.m_TargetX, &Step.m_TargetY) != 7)
+			continue;
+		Step.m_Duration = max(Step.m_Duration, 1);
+		s_aScript.add(Step);
+	}
+	io_close(File);
+	return s_aScript.size() > 0;
+}
+
+static void PrintStats(const char *pPrefix, const CStats *pStats, int NumOnline, float Seconds)
+{
+	int NumExpected = pStats->m_NumSnaps+pStats->m_NumLostSnaps;
+	dbg_msg("loadgen", "%s online=%d snaps/s=%.1f loss=%.2f%% bad=%d delay avg=%.1fms max=%.1fms ping avg=%.1fms max=%.1fms input timeleft=%.1fms late=%d",
+		pPrefix, NumOnline,
+		pStats->m_NumSnaps/Seconds,
+		NumExpected ? pStats->m_NumLostSnaps*100.0f/NumExpected : 0.0f,
+		pStats->m_NumBadSnaps,
+		pStats->m_NumSnaps ? ToMs(pStats->m_SnapDelaySum)/pStats->m_NumSnaps : 0.0f,
+		ToMs(pStats->m_SnapDelayMax),
+		pStats->m_NumPings ? ToMs(pStats->m_PingSum)/pStats->m_NumPings : 0.0f,
+		ToMs(pStats->m_PingMax),
+		pStats->m_NumInputTimings ? pStats->m_InputTimeLeftSum/(float)pStats->m_NumInputTimings : 0.0f,
+		pStats->m_NumLateInputs);
+}
+
+static int Run(int NumBots, int Seconds, int ConnectDelay)
+{
+	static CBot s_aBots[MAX_CLIENTS];
+
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		s_SnapshotDelta.SetStaticsize(i, s_NetObjHandler.GetObjSize(i));
+
+	int64 Start = time_get();
+	int64 End = Seconds ? Start+Seconds*time_freq() : 0;
+	int64 NextConnect = Start;
+	int64 NextReport = Start+time_freq();
+	int64 LastReport = Start;
+	int NumStarted = 0;
+
+	while(!End || time_get() < End)
+	{
+		int64 Now = time_get();
+
+		// ramp up the bots one by one
+		if(NumStarted < NumBots && Now >= NextConnect)
+		{
+			if(!s_aBots[NumStarted].Connect(NumStarted))
+			{
+				dbg_msg("loadgen", "couldn't open socket for bot %d", NumStarted);
+				return -1;
+			}
+			NumStarted++;
+			NextConnect = Now+ConnectDelay*time_freq()/1000;
+		}
+
+		int NumOnline = 0, NumAlive = 0;
+		for(int i = 0; i < NumStarted; i++)
+		{
+			s_aBots[i].Update(Now);
+			NumOnline += s_aBots[i].Online();
+			NumAlive += !s_aBots[i].Offline();
+		}
+
+		if(Now >= NextReport)
+		{
+			PrintStats("last second:", &s_Stats, NumOnline, (Now-LastReport)/(float)time_freq());
+			s_TotalStats.Add(s_Stats);
+			s_Stats.Reset();
+			LastReport = Now;
+			NextReport = Now+time_freq();
+		}
+
+		if(NumStarted == NumBots && NumAlive == 0)
+		{
+			dbg_msg("loadgen", "all bots are offline");
+			break;
+		}
+
+		thread_sleep(1);
+	}
+
+	s_TotalStats.Add(s_Stats);
+	int NumOnline = 0;
+	for(int i = 0; i < NumStarted; i++)
+	{
+		NumOnline += s_aBots[i].Online();
+		s_aBots[i].Disconnect();
+	}
+	PrintStats("total:", &s_TotalStats, NumOnline, (time_get()-Start)/(float)time_freq());
+	return 0;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	int NumBots = 8;
+	int Seconds = 60;
+	int ConnectDelay = 200;
+	const char *pAddress = 0;
+
+	dbg_logger_stdout();
+
+	// the network code reads its timeouts from the config
+	CreateConfig()->Reset();
+
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc) // ignore_convention
+			NumBots = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-t") == 0 && i+1 < argc) // ignore_convention
+			Seconds = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-r") == 0 && i+1 < argc) // ignore_convention
+			ConnectDelay = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-p") == 0 && i+1 < argc) // ignore_convention
+			s_pPassword = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-s") == 0 && i+1 < argc) // ignore_convention
+		{
+			if(!LoadScript(argv[++i])) // ignore_convention
+			{
+				dbg_msg("loadgen", "couldn't load input script '%s'", argv[i]); // ignore_convention
+				return -1;
+			}
+		}
+		else if(str_comp(argv[i], "-m") == 0) // ignore_convention
+			s_DownloadMap = false;
+		else
+			pAddress = argv[i]; // ignore_convention
+	}
+
+	if(!pAddress)
+	{
+		dbg_msg("loadgen", "usage: loadgen [-n bots] [-t seconds] [-r connect delay ms] [-p password] [-s input script] [-m] <server address>");
+		dbg_msg("loadgen", "  -t 0 runs until interrupted, -m skips the map download");
+		return -1;
+	}
+
+	if(NumBots < 1 || NumBots > MAX_CLIENTS)
+	{
+		dbg_msg("loadgen", "one process runs 1 to %d bots, start more processes for more", (int)MAX_CLIENTS);
+		return -1;
+	}
+
+	net_init();
+	CNetBase::Init();
+	if(net_host_lookup(pAddress, &s_ServerAddr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("loadgen", "couldn't resolve '%s'", pAddress);
+		return -1;
+	}
+	if(s_ServerAddr.port == 0)
+		s_ServerAddr.port = 8303;
+
+	srand(time_get());
+	return Run(NumBots, Seconds, max(ConnectDelay, 0));
+}